@@ -0,0 +1,417 @@
+// ============================================
+// Startup auto-tuner: threads, tile size and packet width
+// ============================================
+//
+// The fastest thread count, tile size and packet (SIMD) width for the
+// tiled CPU renderers and the binned star splat differ between machines: core count, SMT, cache
+// sizes and whether the build has AVX-512 for the 16-wide packets. The
+// first run on a host micro-benchmarks the candidates on a reduced
+// frame of the caller's scene and stores the winners in a per-host,
+// per-kernel cache file, bh_tune-<host>-<kernel>.cfg ("key = value",
+// like scene.cfg). Later runs load the file and start at once.
+//
+// The kernel is the tracer that will use the settings: "march" is the
+// packet ray march (renderTiledPacket, the poster / farm tiles, a
+// TRACE_MARCH GeodesicCache), "lut" and "kerr" a full GeodesicCache
+// trace with that tracer. Only the march has packets, so the others
+// tune tile size and threads. "splat" is splatGalaxyStarsTiled on the
+// caller's sim and view, where tile size 0 (the serial splat, one
+// thread) is a candidate too: binning costs two extra passes over the
+// stars, which only pays with cores to spare.
+//
+// The search is coordinate-wise rather than the full cross product
+// (a few seconds, not a minute): packet width at all threads with
+// 32-pixel tiles, then tile size, then thread count. Each candidate is
+// the best of TUNE_REPEATS frames after one warm-up, and only replaces
+// the current choice if it is TUNE_MIN_GAIN faster, so timing noise
+// doesn't move a host off the defaults. Calibration takes seconds, so
+// interactive callers run it off their UI thread.
+//
+// The cache is discarded and the host re-tuned when the CPU model,
+// core count, build ISA or TUNE_VERSION differ from what it recorded.
+// A new binary built with a different -march re-tunes, and so does a
+// node that got new hardware under the same hostname.
+
+#pragma once
+
+#include "bh_raymarch_cpu.hpp"
+#include "galaxy_frame_cpu.hpp"
+#include "geodesic_cache.hpp"
+#include "scene_config.hpp"   // sceneTrim
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+// Bump when the candidates or the kernels they time change
+const int TUNE_VERSION = 2;
+const int TUNE_REPEATS = 2;
+const int TUNE_WIDTH   = 640;    // calibration frame
+const int TUNE_HEIGHT  = 360;
+const double TUNE_MIN_GAIN = 0.03;   // a candidate must beat the best by this much
+const int TUNE_SPLAT_REPEATS = 10;   // splat frames take milliseconds, so take more
+const char* const TUNE_SPLAT_KERNEL = "splat";
+
+struct TunedSettings {
+    int    threads     = 0;    // 0 = not tuned
+    int    tileSize    = 32;   // 0 = serial (splat only)
+    int    packetWidth = 8;    // 8 or 16 rays per packet
+    double frameMs     = 0.0;  // calibration frame with the winners
+    bool   fromCache   = false;
+};
+
+// ----------------------
+// Host identity
+// ----------------------
+struct HostSignature {
+    std::string host;
+    std::string cpu;
+    int         cores = 0;
+    std::string isa;
+};
+
+inline std::string tuneHostName() {
+    char name[256] = "";
+#ifdef _WIN32
+    const char* env = std::getenv("COMPUTERNAME");
+    if (env) std::snprintf(name, sizeof(name), "%s", env);
+#else
+    if (gethostname(name, sizeof(name) - 1) != 0) name[0] = '\0';
+#endif
+    std::string out;
+    for (const char* c = name; *c; ++c) {
+        bool keep = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') ||
+                    (*c >= '0' && *c <= '9') || *c == '-' || *c == '_';
+        out += keep ? *c : '_';
+    }
+    return out.empty() ? "localhost" : out;
+}
+
+// "model name" from /proc/cpuinfo, empty where there is none
+inline std::string tuneCpuModel() {
+    std::ifstream in("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 10, "model name") != 0) continue;
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) return sceneTrim(line.substr(colon + 1));
+    }
+    return "";
+}
+
+// Widest vector ISA this binary was compiled for
+inline const char* tuneBuildIsa() {
+#if defined(__AVX512F__)
+    return "avx512";
+#elif defined(__AVX2__)
+    return "avx2";
+#elif defined(__AVX__)
+    return "avx";
+#elif defined(__ARM_NEON)
+    return "neon";
+#else
+    return "sse2";
+#endif
+}
+
+inline HostSignature currentHost() {
+    HostSignature h;
+    h.host  = tuneHostName();
+    h.cpu   = tuneCpuModel();
+    h.cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    h.isa   = tuneBuildIsa();
+    return h;
+}
+
+inline const char* tuneKernelName(GeodesicTracer tracer) {
+    switch (tracer) {
+    case TRACE_SCHWARZSCHILD_LUT: return "lut";
+    case TRACE_KERR:              return "kerr";
+    default:                      return "march";
+    }
+}
+
+inline std::string tuneCachePath(const std::string& dir, const HostSignature& h, const std::string& kernel) {
+    return (dir.empty() ? std::string(".") : dir) + "/bh_tune-" + h.host + "-" + kernel + ".cfg";
+}
+
+// ----------------------
+// Cache file
+// ----------------------
+inline bool loadTunedSettings(const std::string& path, const HostSignature& h, const std::string& kernelName,
+                              TunedSettings& out) {
+    std::ifstream in(path);
+    if (!in) return false;
+
+    TunedSettings t;
+    std::string cpu, isa, kernel;
+    int cores = 0, version = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key   = sceneTrim(line.substr(0, eq));
+        std::string value = sceneTrim(line.substr(eq + 1));
+
+        if (key == "version")          version       = std::atoi(value.c_str());
+        else if (key == "cpu")         cpu           = value;
+        else if (key == "cores")       cores         = std::atoi(value.c_str());
+        else if (key == "isa")         isa           = value;
+        else if (key == "kernel")      kernel        = value;
+        else if (key == "threads")     t.threads     = std::atoi(value.c_str());
+        else if (key == "tileSize")    t.tileSize    = std::atoi(value.c_str());
+        else if (key == "packetWidth") t.packetWidth = std::atoi(value.c_str());
+        else if (key == "frameMs")     t.frameMs     = std::atof(value.c_str());
+    }
+
+    const int minTile = kernelName == TUNE_SPLAT_KERNEL ? 0 : 8;
+    bool valid = version == TUNE_VERSION && cpu == h.cpu && cores == h.cores && isa == h.isa &&
+                 kernel == kernelName &&
+                 t.threads >= 1 && t.tileSize >= minTile && (t.packetWidth == 8 || t.packetWidth == 16);
+    if (!valid) return false;
+    t.fromCache = true;
+    out = t;
+    return true;
+}
+
+inline bool saveTunedSettings(const std::string& path, const HostSignature& h, const std::string& kernel,
+                              const TunedSettings& t) {
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    std::fprintf(f, "# CPU renderer settings tuned for %s; delete to re-tune\n", h.host.c_str());
+    std::fprintf(f, "version = %d\n", TUNE_VERSION);
+    std::fprintf(f, "kernel = %s\n", kernel.c_str());
+    std::fprintf(f, "cpu = %s\n", h.cpu.c_str());
+    std::fprintf(f, "cores = %d\n", h.cores);
+    std::fprintf(f, "isa = %s\n", h.isa.c_str());
+    std::fprintf(f, "threads = %d\n", t.threads);
+    std::fprintf(f, "tileSize = %d\n", t.tileSize);
+    std::fprintf(f, "packetWidth = %d\n", t.packetWidth);
+    std::fprintf(f, "frameMs = %.3f\n", t.frameMs);
+    return std::fclose(f) == 0;
+}
+
+// ----------------------
+// Calibration
+// ----------------------
+inline double renderTiledTuned(const RayMarchParams& p, std::vector<float>& rgb, int tileSize,
+                               int threads, int packetWidth) {
+    std::vector<TileWorkerStats> stats;
+    return packetWidth == 16 ? renderTiledPacket<16>(p, rgb, tileSize, threads, stats)
+                             : renderTiledPacket<8>(p, rgb, tileSize, threads, stats);
+}
+
+// One frame of the tuned kernel with settings s, in seconds. cache
+// carries the Schwarzschild table between calls (built on the warm-up)
+inline double tuneFrameSeconds(const RayMarchParams& p, GeodesicTracer tracer, const TunedSettings& s,
+                               std::vector<float>& rgb, GeodesicCache& cache) {
+    if (tracer == TRACE_MARCH) return renderTiledTuned(p, rgb, s.tileSize, s.threads, s.packetWidth);
+
+    cache.tracer      = tracer;
+    cache.packetWidth = s.packetWidth;
+    cache.progressive = false;
+    cache.invalidate();
+    auto t0 = std::chrono::steady_clock::now();
+    cache.update(p, s.tileSize, s.threads);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Thread counts worth trying: powers of two below the core count, the
+// core count itself and half of it (SMT siblings share a core's
+// vector units, so all logical cores is not always fastest)
+inline std::vector<int> tuneThreadCandidates(int cores) {
+    std::vector<int> c;
+    for (int t = 1; t < cores; t *= 2) c.push_back(t);
+    if (cores > 2) c.push_back(cores / 2);
+    c.push_back(cores);
+    std::sort(c.begin(), c.end());
+    c.erase(std::unique(c.begin(), c.end()), c.end());
+    return c;
+}
+
+// Times the kernel's candidates on p at TUNE_WIDTH x TUNE_HEIGHT;
+// prints each one when verbose
+inline TunedSettings tuneRayMarch(RayMarchParams p, GeodesicTracer tracer, int cores, bool verbose) {
+    p.resolutionX = static_cast<float>(TUNE_WIDTH);
+    p.resolutionY = static_cast<float>(TUNE_HEIGHT);
+    std::vector<float> rgb(static_cast<size_t>(TUNE_WIDTH) * TUNE_HEIGHT * 3);
+    GeodesicCache cache;
+
+    TunedSettings best;
+    best.threads = std::max(1, cores);
+
+    auto timeFrame = [&](const TunedSettings& s) {
+        tuneFrameSeconds(p, tracer, s, rgb, cache);   // warm-up
+        double ms = 1e30;
+        for (int r = 0; r < TUNE_REPEATS; ++r) {
+            ms = std::min(ms, tuneFrameSeconds(p, tracer, s, rgb, cache) * 1000.0);
+        }
+        if (verbose) {
+            std::printf("  packet %2d  tile %3d  threads %3d  %8.2f ms\n", s.packetWidth, s.tileSize,
+                        s.threads, ms);
+        }
+        return ms;
+    };
+    auto tryCandidate = [&](TunedSettings s) {
+        double ms = timeFrame(s);
+        if (ms < best.frameMs * (1.0 - TUNE_MIN_GAIN)) {
+            best = s;
+            best.frameMs = ms;
+        }
+    };
+
+    best.frameMs = timeFrame(best);
+    TunedSettings s = best;
+    if (tracer == TRACE_MARCH) {
+        s.packetWidth = 16;
+        tryCandidate(s);
+    }
+
+    const int tiles[] = { 16, 64, 128 };
+    const int bestWidth = best.packetWidth;
+    for (int tile : tiles) {
+        s = best;
+        s.packetWidth = bestWidth;
+        s.tileSize = tile;
+        tryCandidate(s);
+    }
+
+    const TunedSettings before = best;
+    for (int t : tuneThreadCandidates(cores)) {
+        if (t == before.threads) continue;
+        s = before;
+        s.threads = t;
+        tryCandidate(s);
+    }
+    return best;
+}
+
+// Cached settings for this host and kernel, or tune and cache them
+// (force: always re-tune). The tuned scene is the caller's, so it
+// should look like the frames the settings will be used for.
+inline TunedSettings loadOrTuneRayMarch(const std::string& dir, const RayMarchParams& p,
+                                        GeodesicTracer tracer, bool force, bool verbose) {
+    HostSignature h = currentHost();
+    std::string path = tuneCachePath(dir, h, tuneKernelName(tracer));
+
+    TunedSettings t;
+    if (!force && loadTunedSettings(path, h, tuneKernelName(tracer), t)) return t;
+
+    if (verbose) {
+        std::printf("tuning CPU %s kernel for %s (%s, %d threads, %s)\n", tuneKernelName(tracer),
+                    h.host.c_str(), h.cpu.empty() ? "unknown CPU" : h.cpu.c_str(), h.cores,
+                    h.isa.c_str());
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    t = tuneRayMarch(p, tracer, h.cores, verbose);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    bool saved = saveTunedSettings(path, h, tuneKernelName(tracer), t);
+    if (verbose) {
+        std::printf("tuned in %.1f s: packet %d, tile %d, %d threads (%.2f ms / %dx%d frame)%s%s\n",
+                    seconds, t.packetWidth, t.tileSize, t.threads, t.frameMs, TUNE_WIDTH, TUNE_HEIGHT,
+                    saved ? ", saved to " : ", cannot write ", path.c_str());
+    }
+    return t;
+}
+
+// ----------------------
+// Star splat
+// ----------------------
+// One splatGalaxyStarsTiled frame of sim at view into a cleared
+// w x h buffer, in seconds
+inline double tuneSplatSeconds(const GalaxySim& sim, const GalaxyProjection& view, int w, int h,
+                               const TunedSettings& s, std::vector<std::uint8_t>& rgb) {
+    rgb.assign(static_cast<size_t>(w) * h * 3, 0);
+    auto t0 = std::chrono::steady_clock::now();
+    splatGalaxyStarsTiled(sim, view, w, h, rgb.data(), s.tileSize, s.threads);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Serial first, then tile sizes at all cores, then thread counts for
+// the winning tile (when it isn't the serial splat)
+inline TunedSettings tuneGalaxySplat(const GalaxySim& sim, const GalaxyProjection& view, int w, int h,
+                                     int cores, bool verbose) {
+    std::vector<std::uint8_t> rgb;
+    TunedSettings best;
+    best.threads  = 1;
+    best.tileSize = 0;
+
+    auto timeFrame = [&](const TunedSettings& s) {
+        tuneSplatSeconds(sim, view, w, h, s, rgb);   // warm-up
+        double ms = 1e30;
+        for (int r = 0; r < TUNE_SPLAT_REPEATS; ++r) {
+            ms = std::min(ms, tuneSplatSeconds(sim, view, w, h, s, rgb) * 1000.0);
+        }
+        if (verbose) std::printf("  tile %3d  threads %3d  %8.3f ms\n", s.tileSize, s.threads, ms);
+        return ms;
+    };
+    auto tryCandidate = [&](const TunedSettings& s) {
+        double ms = timeFrame(s);
+        if (ms < best.frameMs * (1.0 - TUNE_MIN_GAIN)) {
+            best = s;
+            best.frameMs = ms;
+        }
+    };
+
+    best.frameMs = timeFrame(best);
+    const int tiles[] = { 32, 64, 128, 256 };
+    for (int tile : tiles) {
+        TunedSettings s;
+        s.tileSize = tile;
+        s.threads  = std::max(1, cores);
+        tryCandidate(s);
+    }
+    if (best.tileSize == 0) return best;
+
+    const TunedSettings before = best;
+    for (int t : tuneThreadCandidates(cores)) {
+        if (t == before.threads) continue;
+        TunedSettings s = before;
+        s.threads = t;
+        tryCandidate(s);
+    }
+    return best;
+}
+
+// Cached splat settings for this host, or tune on sim and cache them
+// (force: always re-tune). As with the ray march, the sim and view
+// should look like the frames the settings will be used for: the star
+// count decides whether binning pays.
+inline TunedSettings loadOrTuneGalaxySplat(const std::string& dir, const GalaxySim& sim,
+                                           const GalaxyProjection& view, int w, int h, bool force,
+                                           bool verbose) {
+    HostSignature host = currentHost();
+    std::string path = tuneCachePath(dir, host, TUNE_SPLAT_KERNEL);
+
+    TunedSettings t;
+    if (!force && loadTunedSettings(path, host, TUNE_SPLAT_KERNEL, t)) return t;
+
+    if (verbose) {
+        std::printf("tuning CPU splat for %s (%s, %d threads, %s), %zu stars at %dx%d\n",
+                    host.host.c_str(), host.cpu.empty() ? "unknown CPU" : host.cpu.c_str(), host.cores,
+                    host.isa.c_str(), sim.posX.size(), w, h);
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    t = tuneGalaxySplat(sim, view, w, h, host.cores, verbose);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    bool saved = saveTunedSettings(path, host, TUNE_SPLAT_KERNEL, t);
+    if (verbose) {
+        std::printf("tuned in %.1f s: tile %d%s, %d threads (%.3f ms / frame)%s%s\n", seconds,
+                    t.tileSize, t.tileSize == 0 ? " (serial)" : "", t.threads, t.frameMs,
+                    saved ? ", saved to " : ", cannot write ", path.c_str());
+    }
+    return t;
+}
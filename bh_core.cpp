@@ -0,0 +1,328 @@
+// ============================================
+// bh_core: C API over the header-only CPU modules (see bh_core.h)
+// ============================================
+//
+// Thin wrappers: argument checks, struct translation, and a catch at
+// every entry point so no exception unwinds into C. The work itself is
+// galaxy_sim.hpp, galaxy_frame_cpu.hpp and bh_raymarch_cpu.hpp, the
+// same code the viewers and bh_cpu run.
+
+#include "bh_core.h"
+
+#include "bh_raymarch_cpu.hpp"
+#include "galaxy_frame_cpu.hpp"
+#include "galaxy_sim.hpp"
+
+#include <algorithm>
+#include <new>
+#include <thread>
+#include <vector>
+
+struct bh_galaxy {
+    GalaxySim sim;
+};
+
+namespace {
+
+// Frame sizes past this are a caller bug (or an overflowing size_t
+// on 32-bit), not a picture
+const int32_t BH_CORE_MAX_DIM = 1 << 15;
+
+bool validSize(int32_t width, int32_t height) {
+    return width > 0 && height > 0 && width <= BH_CORE_MAX_DIM && height <= BH_CORE_MAX_DIM;
+}
+
+int hardwareThreads(int32_t threads) {
+    if (threads > 0) return threads;
+    int hw = static_cast<int>(std::thread::hardware_concurrency());
+    return hw > 0 ? hw : 4;
+}
+
+// Runs fn, turning exceptions into status codes
+template <class Fn>
+int guarded(Fn fn) {
+    try {
+        return fn();
+    } catch (const std::bad_alloc&) {
+        return BH_ERR_NO_MEMORY;
+    } catch (...) {
+        return BH_ERR_INTERNAL;
+    }
+}
+
+void toSimParams(const bh_galaxy_params& in, SimParams& P) {
+    P.G              = in.G;
+    P.M_bh           = in.m_bh;
+    P.softening      = in.softening;
+    P.v0             = in.v0;
+    P.r_core         = in.r_core;
+    P.dt             = in.dt;
+    P.integrator     = in.integrator == BH_INTEGRATOR_LEAPFROG ? SIM_LEAPFROG : SIM_EULER;
+    P.viscosityBase  = in.viscosity_base;
+    P.viscosityCore  = in.viscosity_core;
+    P.heatScale      = in.heat_scale;
+    P.brightnessCool = in.brightness_cool;
+    P.horizonRadius  = in.horizon_radius;
+    P.respawnRMin    = in.respawn_r_min;
+    P.respawnRMax    = in.respawn_r_max;
+    P.threeD         = in.three_d ? 1 : 0;
+    P.thickness      = in.thickness;
+    P.verticalRestoring = in.vertical_restoring;
+}
+
+void fromSimParams(const SimParams& P, bh_galaxy_params& out) {
+    out.G               = P.G;
+    out.m_bh            = P.M_bh;
+    out.softening       = P.softening;
+    out.v0              = P.v0;
+    out.r_core          = P.r_core;
+    out.dt              = P.dt;
+    out.integrator      = P.integrator;
+    out.viscosity_base  = P.viscosityBase;
+    out.viscosity_core  = P.viscosityCore;
+    out.heat_scale      = P.heatScale;
+    out.brightness_cool = P.brightnessCool;
+    out.horizon_radius  = P.horizonRadius;
+    out.respawn_r_min   = P.respawnRMin;
+    out.respawn_r_max   = P.respawnRMax;
+    out.three_d         = P.threeD;
+    out.thickness       = P.thickness;
+    out.vertical_restoring = P.verticalRestoring;
+}
+
+LensWarpParams toLensParams(const bh_lens_params& in) {
+    LensWarpParams p;
+    p.centerX      = in.center_x;
+    p.centerY      = in.center_y;
+    p.lensStrength = in.lens_strength;
+    p.ringRadius   = in.ring_radius;
+    p.ringWidth    = in.ring_width;
+    p.ringBoost    = in.ring_boost;
+    p.dopplerBoost = in.doppler_boost;
+    for (int c = 0; c < 3; ++c) p.tint[c] = in.tint[c];
+    p.verticalWarpStrength = in.vertical_warp_strength;
+    p.verticalWarpFalloff  = in.vertical_warp_falloff;
+    p.shearStrength        = in.shear_strength;
+    p.ringEccentricity     = in.ring_eccentricity;
+    return p;
+}
+
+RayMarchParams toRayMarchParams(const bh_raymarch_params& in, int32_t width, int32_t height) {
+    RayMarchParams p;
+    p.resolutionX     = static_cast<float>(width);
+    p.resolutionY     = static_cast<float>(height);
+    p.time            = in.time;
+    p.camPos          = Vec3(in.cam_pos[0], in.cam_pos[1], in.cam_pos[2]);
+    p.camTarget       = Vec3(in.cam_target[0], in.cam_target[1], in.cam_target[2]);
+    p.fovFactor       = in.fov_factor;
+    p.bhRadius        = in.bh_radius;
+    p.diskInner       = in.disk_inner;
+    p.diskOuter       = in.disk_outer;
+    p.diskHeight      = in.disk_height;
+    p.diskRotation    = in.disk_rotation;
+    p.diskTilt        = in.disk_tilt;
+    p.gravStrength    = in.grav_strength;
+    p.stepSize        = in.step_size;
+    p.stepTolerance   = in.step_tolerance;
+    p.influenceRadius = in.influence_radius;
+    p.diskColorBase   = Vec3(in.disk_color_base[0], in.disk_color_base[1], in.disk_color_base[2]);
+    return p;
+}
+
+} // namespace
+
+extern "C" {
+
+int bh_core_abi_version(void) { return BH_CORE_ABI_VERSION; }
+
+const char* bh_core_status_string(int status) {
+    switch (status) {
+    case BH_OK:            return "ok";
+    case BH_ERR_ARGUMENT:  return "invalid argument";
+    case BH_ERR_NO_MEMORY: return "out of memory";
+    case BH_ERR_INTERNAL:  return "internal error";
+    default:               return "unknown status";
+    }
+}
+
+// ----------------------
+// Galaxy
+// ----------------------
+void bh_galaxy_default_params(bh_galaxy_params* out) {
+    if (out) fromSimParams(SimParams(), *out);
+}
+
+int bh_galaxy_create(const bh_galaxy_params* params, int32_t count, uint32_t seed, bh_galaxy** out) {
+    if (!out || count < 0) return BH_ERR_ARGUMENT;
+    *out = nullptr;
+    return guarded([&] {
+        bh_galaxy* g = new bh_galaxy;
+        if (params) toSimParams(*params, g->sim.P);
+        if (seed != 0) g->sim.seed(seed);
+        try {
+            g->sim.init(count);
+        } catch (...) {
+            delete g;
+            throw;
+        }
+        *out = g;
+        return BH_OK;
+    });
+}
+
+void bh_galaxy_destroy(bh_galaxy* g) { delete g; }
+
+int bh_galaxy_get_params(const bh_galaxy* g, bh_galaxy_params* out) {
+    if (!g || !out) return BH_ERR_ARGUMENT;
+    fromSimParams(g->sim.P, *out);
+    return BH_OK;
+}
+
+int bh_galaxy_set_params(bh_galaxy* g, const bh_galaxy_params* params) {
+    if (!g || !params) return BH_ERR_ARGUMENT;
+    toSimParams(*params, g->sim.P);
+    return BH_OK;
+}
+
+int bh_galaxy_reset(bh_galaxy* g, int32_t count, uint32_t seed) {
+    if (!g || count < 0) return BH_ERR_ARGUMENT;
+    return guarded([&] {
+        if (seed != 0) g->sim.seed(seed);
+        g->sim.init(count);
+        return BH_OK;
+    });
+}
+
+int bh_galaxy_resize(bh_galaxy* g, int32_t count) {
+    if (!g || count < 0) return BH_ERR_ARGUMENT;
+    return guarded([&] {
+        g->sim.resize(count);
+        return BH_OK;
+    });
+}
+
+int bh_galaxy_step(bh_galaxy* g, int32_t steps) {
+    if (!g || steps < 0) return BH_ERR_ARGUMENT;
+    for (int32_t i = 0; i < steps; ++i) g->sim.step();
+    return BH_OK;
+}
+
+int bh_galaxy_state_view(bh_galaxy* g, bh_galaxy_state* out) {
+    if (!g || !out) return BH_ERR_ARGUMENT;
+    GalaxySim& s = g->sim;
+    out->pos_x      = s.posX.data();
+    out->pos_y      = s.posY.data();
+    out->vel_x      = s.velX.data();
+    out->vel_y      = s.velY.data();
+    out->brightness = s.brightness.data();
+    out->pos_z      = s.threeD ? s.posZ.data() : nullptr;
+    out->vel_z      = s.threeD ? s.velZ.data() : nullptr;
+    out->count      = static_cast<int32_t>(s.posX.size());
+    out->captured   = s.captured;
+    return BH_OK;
+}
+
+int bh_galaxy_splat(const bh_galaxy* g, uint8_t* rgb, int32_t width, int32_t height,
+                    float scale, float tilt, float yaw) {
+    if (!g || !rgb || !validSize(width, height)) return BH_ERR_ARGUMENT;
+    splatGalaxyStars(g->sim, GalaxyProjection(width / 2.0f, height / 2.0f, scale, tilt, yaw),
+                     width, height, rgb);
+    return BH_OK;
+}
+
+// ----------------------
+// Lens warp
+// ----------------------
+void bh_lens_default_params(bh_lens_params* out, int32_t width, int32_t height) {
+    if (!out) return;
+    LensWarpParams p;
+    out->center_x      = width / 2.0f;
+    out->center_y      = height / 2.0f;
+    out->lens_strength = p.lensStrength;
+    out->ring_radius   = p.ringRadius;
+    out->ring_width    = p.ringWidth;
+    out->ring_boost    = p.ringBoost;
+    out->doppler_boost = p.dopplerBoost;
+    for (int c = 0; c < 3; ++c) out->tint[c] = p.tint[c];
+    out->vertical_warp_strength = p.verticalWarpStrength;
+    out->vertical_warp_falloff  = p.verticalWarpFalloff;
+    out->shear_strength         = p.shearStrength;
+    out->ring_eccentricity      = p.ringEccentricity;
+}
+
+int bh_lens_warp(const bh_lens_params* params, const uint8_t* src, uint8_t* dst,
+                 int32_t width, int32_t height, int32_t threads) {
+    if (!params || !src || !dst || src == dst || !validSize(width, height) || threads < 0) {
+        return BH_ERR_ARGUMENT;
+    }
+    return guarded([&] {
+        const LensWarpParams p = toLensParams(*params);
+
+        // Bands of rows on the tile scheduler; the cost is flat enough
+        // that equal bands would do, but this is the one pool we have
+        const int band = 16;
+        std::vector<RenderTile> tiles;
+        for (int y = 0; y < height; y += band) {
+            RenderTile t;
+            t.x0 = 0;
+            t.x1 = width;
+            t.y0 = y;
+            t.y1 = std::min(height, y + band);
+            tiles.push_back(t);
+        }
+        std::vector<TileWorkerStats> stats;
+        runTilesWorkStealing(tiles, hardwareThreads(threads),
+            [&](const RenderTile& t, int) { lensWarpRowsCPU(p, src, dst, width, height, t.y0, t.y1); },
+            stats);
+        return BH_OK;
+    });
+}
+
+// ----------------------
+// Ray marcher
+// ----------------------
+void bh_raymarch_default_params(bh_raymarch_params* out) {
+    if (!out) return;
+    RayMarchParams p;
+    out->time = p.time;
+    out->cam_pos[0] = p.camPos.x;
+    out->cam_pos[1] = p.camPos.y;
+    out->cam_pos[2] = p.camPos.z;
+    out->cam_target[0] = p.camTarget.x;
+    out->cam_target[1] = p.camTarget.y;
+    out->cam_target[2] = p.camTarget.z;
+    out->fov_factor       = p.fovFactor;
+    out->bh_radius        = p.bhRadius;
+    out->disk_inner       = p.diskInner;
+    out->disk_outer       = p.diskOuter;
+    out->disk_height      = p.diskHeight;
+    out->disk_rotation    = p.diskRotation;
+    out->disk_tilt        = p.diskTilt;
+    out->grav_strength    = p.gravStrength;
+    out->step_size        = p.stepSize;
+    out->step_tolerance   = p.stepTolerance;
+    out->influence_radius = p.influenceRadius;
+    out->disk_color_base[0] = p.diskColorBase.x;
+    out->disk_color_base[1] = p.diskColorBase.y;
+    out->disk_color_base[2] = p.diskColorBase.z;
+}
+
+int bh_raymarch_render(const bh_raymarch_params* params, float* rgb, int32_t width, int32_t height,
+                       int32_t threads, int32_t tile_size, int32_t packet_width, double* seconds) {
+    if (!params || !rgb || !validSize(width, height) || threads < 0 || tile_size < 0 ||
+        (packet_width != 8 && packet_width != 16)) {
+        return BH_ERR_ARGUMENT;
+    }
+    return guarded([&] {
+        const RayMarchParams p = toRayMarchParams(*params, width, height);
+        const int tile = tile_size > 0 ? tile_size : 32;
+        std::vector<TileWorkerStats> stats;
+        double s = packet_width == 16
+            ? renderTiledPacket<16>(p, rgb, tile, hardwareThreads(threads), stats)
+            : renderTiledPacket<8>(p, rgb, tile, hardwareThreads(threads), stats);
+        if (seconds) *seconds = s;
+        return BH_OK;
+    });
+}
+
+} // extern "C"
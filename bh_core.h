@@ -0,0 +1,190 @@
+/* ============================================
+ * bh_core: simulation / render core as a C library
+ * ============================================
+ *
+ * The galaxy simulation, the CPU lens warp and the CPU ray marcher
+ * behind a plain C ABI, for orchestration services and analysis
+ * scripts (ctypes, cffi, the Python extension). Nothing is marshalled:
+ *
+ *   - Images are written into buffers the caller owns. The ray marcher
+ *     writes float RGB in [0, 1]. The lens warp and star splat read and
+ *     write 8-bit RGB. Rows run top-down and are tightly packed.
+ *   - Galaxy state is read and written in place. bh_galaxy_state hands
+ *     out pointers to the simulation's own SoA arrays.
+ *
+ * Conventions: functions return BH_OK or a negative BH_ERR_* code, and
+ * no C++ exception crosses the boundary. Parameter structs are plain
+ * data. Fill them with the *_default_params function, then change the
+ * fields you need. Defaults are the viewers' built-in scene: fixed step,
+ * no influence skip. The shipped scene.cfg opts in to step_tolerance
+ * 0.01 and influence_radius 10; set those to match it. A handle
+ * may be used from one thread at a time. Different handles may be used
+ * concurrently.
+ *
+ * Build (shared library):
+ *   g++ -std=c++17 -O3 -march=native -fno-math-errno -fopenmp-simd -pthread
+ *       -fPIC -shared -fvisibility=hidden -DBH_CORE_BUILD bh_core.cpp -o libbh_core.so
+ */
+
+#ifndef BH_CORE_H
+#define BH_CORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  if defined(BH_CORE_BUILD)
+#    define BH_CORE_API __declspec(dllexport)
+#  else
+#    define BH_CORE_API __declspec(dllimport)
+#  endif
+#else
+#  define BH_CORE_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped when a signature or a struct layout changes */
+#define BH_CORE_ABI_VERSION 2
+
+enum {
+    BH_OK             =  0,
+    BH_ERR_ARGUMENT   = -1,   /* null pointer, size out of range */
+    BH_ERR_NO_MEMORY  = -2,
+    BH_ERR_INTERNAL   = -3
+};
+
+BH_CORE_API int         bh_core_abi_version(void);
+BH_CORE_API const char* bh_core_status_string(int status);
+
+/* ----------------------
+ * Galaxy simulation
+ * ---------------------- */
+enum {
+    BH_INTEGRATOR_EULER    = 0,   /* semi-implicit Euler, one force eval */
+    BH_INTEGRATOR_LEAPFROG = 1    /* kick-drift-kick, two force evals */
+};
+
+typedef struct bh_galaxy_params {
+    float   G;
+    float   m_bh;
+    float   softening;
+    float   v0;               /* halo flat-curve velocity */
+    float   r_core;           /* halo core radius */
+    float   dt;
+    int32_t integrator;       /* BH_INTEGRATOR_* */
+    float   viscosity_base;
+    float   viscosity_core;
+    float   heat_scale;
+    float   brightness_cool;
+    float   horizon_radius;   /* 0: no capture */
+    float   respawn_r_min;
+    float   respawn_r_max;
+    int32_t three_d;          /* 1: z position / velocity; read at create / reset */
+    float   thickness;        /* 3D: stars start within +-thickness of the plane */
+    float   vertical_restoring; /* 3D: disk self-gravity, a_z -= this * z */
+} bh_galaxy_params;
+
+/* Views of the simulation's arrays, `count` floats each. Valid until
+ * the next bh_galaxy_reset / bh_galaxy_resize / bh_galaxy_destroy */
+typedef struct bh_galaxy_state {
+    float*   pos_x;
+    float*   pos_y;
+    float*   vel_x;
+    float*   vel_y;
+    float*   brightness;
+    float*   pos_z;           /* NULL in 2D mode */
+    float*   vel_z;
+    int32_t  count;
+    uint64_t captured;        /* stars swallowed since the last reset */
+} bh_galaxy_state;
+
+typedef struct bh_galaxy bh_galaxy;
+
+BH_CORE_API void bh_galaxy_default_params(bh_galaxy_params* out);
+
+/* params may be NULL (defaults). seed 0 seeds from the OS. */
+BH_CORE_API int  bh_galaxy_create(const bh_galaxy_params* params, int32_t count, uint32_t seed,
+                                  bh_galaxy** out);
+BH_CORE_API void bh_galaxy_destroy(bh_galaxy* g);
+
+BH_CORE_API int  bh_galaxy_get_params(const bh_galaxy* g, bh_galaxy_params* out);
+BH_CORE_API int  bh_galaxy_set_params(bh_galaxy* g, const bh_galaxy_params* params);
+
+/* Fresh disk of `count` stars, generator re-seeded when seed != 0 */
+BH_CORE_API int  bh_galaxy_reset(bh_galaxy* g, int32_t count, uint32_t seed);
+/* Star count without a reseed: the survivors keep their orbits */
+BH_CORE_API int  bh_galaxy_resize(bh_galaxy* g, int32_t count);
+BH_CORE_API int  bh_galaxy_step(bh_galaxy* g, int32_t steps);
+BH_CORE_API int  bh_galaxy_state_view(bh_galaxy* g, bh_galaxy_state* out);
+
+/* The viewer's star pass into rgb (width * height * 3 bytes, drawn
+ * over what is there): one pixel per star, centered, `scale` pixels
+ * per sim unit, added with 8-bit saturation. tilt (0 face-on, pi/2
+ * edge-on) and yaw (about the disk axis) are in radians */
+BH_CORE_API int  bh_galaxy_splat(const bh_galaxy* g, uint8_t* rgb, int32_t width, int32_t height,
+                                 float scale, float tilt, float yaw);
+
+/* ----------------------
+ * Lens warp (lensing.frag on the CPU)
+ * ---------------------- */
+typedef struct bh_lens_params {
+    float center_x;           /* black hole in pixels, row 0 = top */
+    float center_y;
+    float lens_strength;
+    float ring_radius;
+    float ring_width;
+    float ring_boost;
+    float doppler_boost;
+    float tint[3];
+    float vertical_warp_strength;
+    float vertical_warp_falloff;
+    float shear_strength;
+    float ring_eccentricity;
+} bh_lens_params;
+
+/* Defaults, centered in a width x height frame */
+BH_CORE_API void bh_lens_default_params(bh_lens_params* out, int32_t width, int32_t height);
+
+/* src -> dst, both width * height * 3 bytes; they must not overlap.
+ * Rows are split over `threads` (0 = all cores) */
+BH_CORE_API int  bh_lens_warp(const bh_lens_params* params, const uint8_t* src, uint8_t* dst,
+                              int32_t width, int32_t height, int32_t threads);
+
+/* ----------------------
+ * Ray marcher (bh_raymarch.frag on the CPU, thin disk)
+ * ---------------------- */
+typedef struct bh_raymarch_params {
+    float time;
+    float cam_pos[3];
+    float cam_target[3];
+    float fov_factor;         /* tan(fov / 2) */
+    float bh_radius;
+    float disk_inner;
+    float disk_outer;
+    float disk_height;
+    float disk_rotation;
+    float disk_tilt;          /* radians */
+    float grav_strength;
+    float step_size;
+    float step_tolerance;     /* > 0: adaptive step */
+    float influence_radius;   /* > 0: skip / early escape */
+    float disk_color_base[3];
+} bh_raymarch_params;
+
+BH_CORE_API void bh_raymarch_default_params(bh_raymarch_params* out);
+
+/* Full frame into rgb (width * height * 3 floats). threads 0 = all
+ * cores, tile_size 0 = 32, packet_width 8 or 16. *seconds (may be
+ * NULL) gets the wall time */
+BH_CORE_API int  bh_raymarch_render(const bh_raymarch_params* params, float* rgb,
+                                    int32_t width, int32_t height, int32_t threads,
+                                    int32_t tile_size, int32_t packet_width, double* seconds);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BH_CORE_H */
@@ -0,0 +1,415 @@
+// ============================================
+// bhcore: Python bindings for the galaxy simulation
+// ============================================
+//
+// Build (next to bh_core.cpp, with the Python headers):
+//   g++ -std=c++17 -O3 -march=native -fno-math-errno -fopenmp-simd -pthread
+//       -fPIC -shared -fvisibility=hidden -DBH_CORE_BUILD $(python3-config --includes)
+//       bh_core.cpp bh_core_py.cpp -o bhcore$(python3-config --extension-suffix)
+//
+// Usage:
+//   import bhcore, numpy as np
+//   g = bhcore.Galaxy(1000000, seed=1)
+//   x = np.asarray(g.pos_x)        # float32 view of the sim's memory, no copy
+//   g.step(10)                     # GIL released while it runs
+//   g.set_params(dt=0.005, integrator=bhcore.LEAPFROG)
+//   d = bhcore.Galaxy(100000, three_d=True)   # adds pos_z / vel_z
+//
+// pos_x, pos_y, (pos_z,) vel_x, vel_y, (vel_z,) and brightness are writable memoryviews
+// over the simulation's own arrays (buffer protocol, format "f"); the
+// z views are empty for a 2D galaxy.
+// They see every step without a copy. While any of them is alive,
+// reset() and resize() raise BufferError, because those reallocate the
+// arrays. Release the views first (del, or memoryview.release()).
+//
+// step() drops the GIL, so an ensemble of galaxies stepped from a
+// thread pool runs in parallel. Each galaxy has its own generator. A
+// galaxy that is stepping refuses other mutating calls with
+// RuntimeError. Reading its arrays meanwhile returns whatever is there.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "bh_core.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+struct GalaxyObject {
+    PyObject_HEAD
+    bh_galaxy* galaxy;
+    Py_ssize_t exports;   // live buffers over the arrays
+    int        busy;      // in step() with the GIL released
+};
+
+// One array of a galaxy, as a buffer exporter; memoryviews are made
+// over it so they keep the galaxy alive
+struct ArrayObject {
+    PyObject_HEAD
+    GalaxyObject* owner;
+    int           field;
+    Py_ssize_t    shape;
+    Py_ssize_t    stride;
+};
+
+enum { FIELD_POS_X, FIELD_POS_Y, FIELD_VEL_X, FIELD_VEL_Y, FIELD_BRIGHTNESS, FIELD_POS_Z, FIELD_VEL_Z };
+
+PyObject* raiseStatus(int status) {
+    PyObject* type = status == BH_ERR_ARGUMENT  ? PyExc_ValueError
+                   : status == BH_ERR_NO_MEMORY ? PyExc_MemoryError
+                                                : PyExc_RuntimeError;
+    PyErr_SetString(type, bh_core_status_string(status));
+    return nullptr;
+}
+
+bool checkIdle(GalaxyObject* self) {
+    if (!self->busy) return true;
+    PyErr_SetString(PyExc_RuntimeError, "galaxy is stepping on another thread");
+    return false;
+}
+
+bool checkNoExports(GalaxyObject* self) {
+    if (self->exports == 0) return true;
+    PyErr_SetString(PyExc_BufferError,
+                    "galaxy arrays are exported; release the views before reset/resize");
+    return false;
+}
+
+// ----------------------
+// Array buffers
+// ----------------------
+float* fieldData(const bh_galaxy_state& s, int field) {
+    switch (field) {
+    case FIELD_POS_X: return s.pos_x;
+    case FIELD_POS_Y: return s.pos_y;
+    case FIELD_VEL_X: return s.vel_x;
+    case FIELD_VEL_Y: return s.vel_y;
+    case FIELD_POS_Z: return s.pos_z;
+    case FIELD_VEL_Z: return s.vel_z;
+    default:          return s.brightness;
+    }
+}
+
+int arrayGetBuffer(PyObject* obj, Py_buffer* view, int flags) {
+    ArrayObject* self = reinterpret_cast<ArrayObject*>(obj);
+    bh_galaxy_state s;
+    int status = bh_galaxy_state_view(self->owner->galaxy, &s);
+    if (status != BH_OK) {
+        raiseStatus(status);
+        view->obj = nullptr;
+        return -1;
+    }
+
+    // Shape / stride live in the exporter: the count can't change while
+    // a buffer is out, so every export of it shares them
+    static float empty = 0.0f;
+    float* data = fieldData(s, self->field);
+    self->shape  = data ? s.count : 0;
+    self->stride = sizeof(float);
+
+    view->obj        = Py_NewRef(obj);
+    view->buf        = data ? data : &empty;
+    view->len        = self->shape * static_cast<Py_ssize_t>(sizeof(float));
+    view->readonly   = 0;
+    view->itemsize   = sizeof(float);
+    view->format     = (flags & PyBUF_FORMAT) ? const_cast<char*>("f") : nullptr;
+    view->ndim       = 1;
+    view->shape      = (flags & PyBUF_ND) ? &self->shape : nullptr;
+    view->strides    = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &self->stride : nullptr;
+    view->suboffsets = nullptr;
+    view->internal   = nullptr;
+    ++self->owner->exports;
+    return 0;
+}
+
+void arrayReleaseBuffer(PyObject* obj, Py_buffer*) {
+    --reinterpret_cast<ArrayObject*>(obj)->owner->exports;
+}
+
+void arrayDealloc(PyObject* obj) {
+    Py_XDECREF(reinterpret_cast<ArrayObject*>(obj)->owner);
+    Py_TYPE(obj)->tp_free(obj);
+}
+
+PyBufferProcs arrayBufferProcs = { arrayGetBuffer, arrayReleaseBuffer };
+
+PyTypeObject ArrayType = { PyVarObject_HEAD_INIT(nullptr, 0) };
+
+// ----------------------
+// Galaxy
+// ----------------------
+struct ParamField {
+    const char* name;
+    size_t      offset;
+    bool        isInt;
+};
+
+const ParamField PARAM_FIELDS[] = {
+    { "G",               offsetof(bh_galaxy_params, G),               false },
+    { "m_bh",            offsetof(bh_galaxy_params, m_bh),            false },
+    { "softening",       offsetof(bh_galaxy_params, softening),       false },
+    { "v0",              offsetof(bh_galaxy_params, v0),              false },
+    { "r_core",          offsetof(bh_galaxy_params, r_core),          false },
+    { "dt",              offsetof(bh_galaxy_params, dt),              false },
+    { "integrator",      offsetof(bh_galaxy_params, integrator),      true  },
+    { "viscosity_base",  offsetof(bh_galaxy_params, viscosity_base),  false },
+    { "viscosity_core",  offsetof(bh_galaxy_params, viscosity_core),  false },
+    { "heat_scale",      offsetof(bh_galaxy_params, heat_scale),      false },
+    { "brightness_cool", offsetof(bh_galaxy_params, brightness_cool), false },
+    { "horizon_radius",  offsetof(bh_galaxy_params, horizon_radius),  false },
+    { "respawn_r_min",   offsetof(bh_galaxy_params, respawn_r_min),   false },
+    { "respawn_r_max",   offsetof(bh_galaxy_params, respawn_r_max),   false },
+    { "three_d",         offsetof(bh_galaxy_params, three_d),         true  },
+    { "thickness",       offsetof(bh_galaxy_params, thickness),       false },
+    { "vertical_restoring", offsetof(bh_galaxy_params, vertical_restoring), false },
+};
+
+int galaxyInit(PyObject* obj, PyObject* args, PyObject* kwargs) {
+    GalaxyObject* self = reinterpret_cast<GalaxyObject*>(obj);
+    static const char* keywords[] = { "count", "seed", "three_d", nullptr };
+    int count = 0;
+    unsigned int seed = 0;
+    int threeD = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "i|Ip", const_cast<char**>(keywords), &count, &seed,
+                                     &threeD)) {
+        return -1;
+    }
+    if (self->galaxy) {
+        if (!checkIdle(self) || !checkNoExports(self)) return -1;
+        bh_galaxy_destroy(self->galaxy);
+        self->galaxy = nullptr;
+    }
+    bh_galaxy_params params;
+    bh_galaxy_default_params(&params);
+    params.three_d = threeD;
+    int status = bh_galaxy_create(&params, count, seed, &self->galaxy);
+    if (status != BH_OK) {
+        raiseStatus(status);
+        return -1;
+    }
+    return 0;
+}
+
+void galaxyDealloc(PyObject* obj) {
+    GalaxyObject* self = reinterpret_cast<GalaxyObject*>(obj);
+    bh_galaxy_destroy(self->galaxy);
+    Py_TYPE(obj)->tp_free(obj);
+}
+
+bool checkCreated(GalaxyObject* self) {
+    if (self->galaxy) return true;
+    PyErr_SetString(PyExc_RuntimeError, "Galaxy.__init__ was not called");
+    return false;
+}
+
+PyObject* galaxyStep(PyObject* obj, PyObject* args) {
+    GalaxyObject* self = reinterpret_cast<GalaxyObject*>(obj);
+    int steps = 1;
+    if (!PyArg_ParseTuple(args, "|i", &steps)) return nullptr;
+    if (!checkCreated(self) || !checkIdle(self)) return nullptr;
+
+    self->busy = 1;
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = bh_galaxy_step(self->galaxy, steps);
+    Py_END_ALLOW_THREADS
+    self->busy = 0;
+    if (status != BH_OK) return raiseStatus(status);
+    Py_RETURN_NONE;
+}
+
+PyObject* galaxyReset(PyObject* obj, PyObject* args, PyObject* kwargs) {
+    GalaxyObject* self = reinterpret_cast<GalaxyObject*>(obj);
+    static const char* keywords[] = { "count", "seed", nullptr };
+    int count = 0;
+    unsigned int seed = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "i|I", const_cast<char**>(keywords), &count, &seed)) {
+        return nullptr;
+    }
+    if (!checkCreated(self) || !checkIdle(self) || !checkNoExports(self)) return nullptr;
+    int status = bh_galaxy_reset(self->galaxy, count, seed);
+    if (status != BH_OK) return raiseStatus(status);
+    Py_RETURN_NONE;
+}
+
+PyObject* galaxyResize(PyObject* obj, PyObject* args) {
+    GalaxyObject* self = reinterpret_cast<GalaxyObject*>(obj);
+    int count = 0;
+    if (!PyArg_ParseTuple(args, "i", &count)) return nullptr;
+    if (!checkCreated(self) || !checkIdle(self) || !checkNoExports(self)) return nullptr;
+    int status = bh_galaxy_resize(self->galaxy, count);
+    if (status != BH_OK) return raiseStatus(status);
+    Py_RETURN_NONE;
+}
+
+PyObject* galaxyGetParams(PyObject* obj, PyObject*) {
+    GalaxyObject* self = reinterpret_cast<GalaxyObject*>(obj);
+    if (!checkCreated(self)) return nullptr;
+    bh_galaxy_params p;
+    bh_galaxy_get_params(self->galaxy, &p);
+
+    PyObject* dict = PyDict_New();
+    if (!dict) return nullptr;
+    for (const ParamField& f : PARAM_FIELDS) {
+        const char* field = reinterpret_cast<const char*>(&p) + f.offset;
+        PyObject* value = f.isInt ? PyLong_FromLong(*reinterpret_cast<const int32_t*>(field))
+                                  : PyFloat_FromDouble(*reinterpret_cast<const float*>(field));
+        if (!value || PyDict_SetItemString(dict, f.name, value) < 0) {
+            Py_XDECREF(value);
+            Py_DECREF(dict);
+            return nullptr;
+        }
+        Py_DECREF(value);
+    }
+    return dict;
+}
+
+PyObject* galaxySetParams(PyObject* obj, PyObject* args, PyObject* kwargs) {
+    GalaxyObject* self = reinterpret_cast<GalaxyObject*>(obj);
+    if (PyTuple_GET_SIZE(args) != 0) {
+        PyErr_SetString(PyExc_TypeError, "set_params takes keyword arguments only");
+        return nullptr;
+    }
+    if (!checkCreated(self) || !checkIdle(self)) return nullptr;
+    bh_galaxy_params p;
+    bh_galaxy_get_params(self->galaxy, &p);
+
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    while (kwargs && PyDict_Next(kwargs, &pos, &key, &value)) {
+        const char* name = PyUnicode_AsUTF8(key);
+        if (!name) return nullptr;
+        const ParamField* match = nullptr;
+        for (const ParamField& f : PARAM_FIELDS) {
+            if (std::strcmp(f.name, name) == 0) match = &f;
+        }
+        if (!match) {
+            PyErr_Format(PyExc_TypeError, "unknown galaxy parameter '%s'", name);
+            return nullptr;
+        }
+        char* field = reinterpret_cast<char*>(&p) + match->offset;
+        if (match->isInt) {
+            long v = PyLong_AsLong(value);
+            if (v == -1 && PyErr_Occurred()) return nullptr;
+            *reinterpret_cast<int32_t*>(field) = static_cast<int32_t>(v);
+        } else {
+            double v = PyFloat_AsDouble(value);
+            if (v == -1.0 && PyErr_Occurred()) return nullptr;
+            *reinterpret_cast<float*>(field) = static_cast<float>(v);
+        }
+    }
+    int status = bh_galaxy_set_params(self->galaxy, &p);
+    if (status != BH_OK) return raiseStatus(status);
+    Py_RETURN_NONE;
+}
+
+PyObject* galaxyArray(PyObject* obj, void* closure) {
+    GalaxyObject* self = reinterpret_cast<GalaxyObject*>(obj);
+    if (!checkCreated(self)) return nullptr;
+    ArrayObject* array = PyObject_New(ArrayObject, &ArrayType);
+    if (!array) return nullptr;
+    array->owner  = reinterpret_cast<GalaxyObject*>(Py_NewRef(obj));
+    array->field  = static_cast<int>(reinterpret_cast<intptr_t>(closure));
+    array->shape  = 0;
+    array->stride = sizeof(float);
+    PyObject* view = PyMemoryView_FromObject(reinterpret_cast<PyObject*>(array));
+    Py_DECREF(array);
+    return view;
+}
+
+PyObject* galaxyCount(PyObject* obj, void*) {
+    GalaxyObject* self = reinterpret_cast<GalaxyObject*>(obj);
+    if (!checkCreated(self)) return nullptr;
+    bh_galaxy_state s;
+    bh_galaxy_state_view(self->galaxy, &s);
+    return PyLong_FromLong(s.count);
+}
+
+PyObject* galaxyCaptured(PyObject* obj, void*) {
+    GalaxyObject* self = reinterpret_cast<GalaxyObject*>(obj);
+    if (!checkCreated(self)) return nullptr;
+    bh_galaxy_state s;
+    bh_galaxy_state_view(self->galaxy, &s);
+    return PyLong_FromUnsignedLongLong(s.captured);
+}
+
+PyMethodDef galaxyMethods[] = {
+    { "step", galaxyStep, METH_VARARGS,
+      "step(n=1): advance n steps with the GIL released" },
+    { "reset", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(galaxyReset)),
+      METH_VARARGS | METH_KEYWORDS,
+      "reset(count, seed=0): fresh disk (2D / 3D from params()['three_d']); "
+      "seed 0 keeps the generator's sequence" },
+    { "resize", galaxyResize, METH_VARARGS,
+      "resize(count): change the star count, survivors keep their orbits" },
+    { "params", galaxyGetParams, METH_NOARGS,
+      "params() -> dict of the simulation parameters" },
+    { "set_params", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(galaxySetParams)),
+      METH_VARARGS | METH_KEYWORDS,
+      "set_params(**kw): change parameters by name (see params())" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+#define BH_ARRAY_GETTER(name, field, doc) \
+    { name, galaxyArray, nullptr, doc, reinterpret_cast<void*>(static_cast<intptr_t>(field)) }
+
+PyGetSetDef galaxyGetSet[] = {
+    BH_ARRAY_GETTER("pos_x", FIELD_POS_X, "x positions, float32 memoryview over the sim"),
+    BH_ARRAY_GETTER("pos_y", FIELD_POS_Y, "y positions, float32 memoryview over the sim"),
+    BH_ARRAY_GETTER("vel_x", FIELD_VEL_X, "x velocities, float32 memoryview over the sim"),
+    BH_ARRAY_GETTER("vel_y", FIELD_VEL_Y, "y velocities, float32 memoryview over the sim"),
+    BH_ARRAY_GETTER("brightness", FIELD_BRIGHTNESS, "brightness, float32 memoryview over the sim"),
+    BH_ARRAY_GETTER("pos_z", FIELD_POS_Z, "z positions (3D galaxies; empty in 2D)"),
+    BH_ARRAY_GETTER("vel_z", FIELD_VEL_Z, "z velocities (3D galaxies; empty in 2D)"),
+    { "count", galaxyCount, nullptr, "number of stars", nullptr },
+    { "captured", galaxyCaptured, nullptr, "stars swallowed since the last reset", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+#undef BH_ARRAY_GETTER
+
+PyTypeObject GalaxyType = { PyVarObject_HEAD_INIT(nullptr, 0) };
+
+PyModuleDef moduleDef = {
+    PyModuleDef_HEAD_INIT, "bhcore",
+    "Galaxy simulation core (bh_core) with zero-copy array views", -1,
+    nullptr, nullptr, nullptr, nullptr, nullptr
+};
+
+} // namespace
+
+PyMODINIT_FUNC PyInit_bhcore(void) {
+    ArrayType.tp_name      = "bhcore._GalaxyArray";
+    ArrayType.tp_basicsize = sizeof(ArrayObject);
+    ArrayType.tp_dealloc   = arrayDealloc;
+    ArrayType.tp_as_buffer = &arrayBufferProcs;
+    ArrayType.tp_flags     = Py_TPFLAGS_DEFAULT;
+    ArrayType.tp_doc       = "buffer exporter for one galaxy array";
+
+    GalaxyType.tp_name      = "bhcore.Galaxy";
+    GalaxyType.tp_basicsize = sizeof(GalaxyObject);
+    GalaxyType.tp_dealloc   = galaxyDealloc;
+    GalaxyType.tp_flags     = Py_TPFLAGS_DEFAULT;
+    GalaxyType.tp_doc       = "Galaxy(count, seed=0, three_d=False): black hole + halo galaxy (GalaxySim)";
+    GalaxyType.tp_methods   = galaxyMethods;
+    GalaxyType.tp_getset    = galaxyGetSet;
+    GalaxyType.tp_init      = galaxyInit;
+    GalaxyType.tp_new       = PyType_GenericNew;
+
+    if (PyType_Ready(&ArrayType) < 0 || PyType_Ready(&GalaxyType) < 0) return nullptr;
+
+    PyObject* module = PyModule_Create(&moduleDef);
+    if (!module) return nullptr;
+    if (PyModule_AddObjectRef(module, "Galaxy", reinterpret_cast<PyObject*>(&GalaxyType)) < 0 ||
+        PyModule_AddIntConstant(module, "EULER", BH_INTEGRATOR_EULER) < 0 ||
+        PyModule_AddIntConstant(module, "LEAPFROG", BH_INTEGRATOR_LEAPFROG) < 0 ||
+        PyModule_AddIntConstant(module, "ABI_VERSION", bh_core_abi_version()) < 0) {
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
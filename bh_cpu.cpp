@@ -0,0 +1,1470 @@
+// ============================================
+// Headless CPU renderer for the ray-march scene
+// (render farm nodes, no GPU / window needed)
+// ============================================
+//
+// Build:
+//   g++ -std=c++17 -O3 -march=native -fno-math-errno -fopenmp-simd -pthread bh_cpu.cpp -o bh_cpu
+//
+// Usage:
+//   bh_cpu render [out.ppm] [packet width 1|8|16]
+//   bh_cpu verify            packet tracer vs scalar reference, pixel diff
+//   bh_cpu bench             rays/sec for reference and 8/16-wide packets
+//   bh_cpu tiles [threads] [tile size]
+//                            static row split vs work-stealing tiles,
+//                            with per-thread utilization
+//   bh_cpu gbuffer           geodesic cache: trace once, reshade per frame
+//   bh_cpu steps             steps per ray, fixed step vs adaptive tolerances
+//   bh_cpu raystats [out.ppm]
+//                            steps per ray and exit reasons for several
+//                            step settings, step-count heatmap
+//   bh_cpu galaxy [csv prefix]
+//                            GalaxySim energy / angular momentum drift per
+//                            dt and integrator, diagnostics to CSV
+//   bh_cpu galaxy3d [out.ppm] [tilt degrees]
+//                            3D disk: step cost vs 2D, energy / L_z drift
+//                            and thickness over time, tilted star splat
+//                            (with the tuned splat settings)
+//   bh_cpu tune [march|lut|kerr] [force]
+//                            calibrate threads, tile size and packet width
+//                            of a kernel for this host (cached in
+//                            bh_tune-<host>-<kernel>.cfg; "force"
+//                            re-tunes), compare with the defaults
+//   bh_cpu tune splat [stars] [force]
+//                            the same for the binned star splat (tile
+//                            size or serial, threads), against serial
+//   bh_cpu quality [log.csv]
+//                            frame-budget controller on an orbiting camera:
+//                            step / resolution knobs under a tight budget,
+//                            then restored under a loose one
+//   bh_cpu counters [stars] [steps]
+//                            hardware counters (cycles, IPC, LLC and
+//                            branch misses) per star for GalaxySim::step
+//                            and the vertex build, per ray / per thread
+//                            for the tiled ray march
+//   bh_cpu regress [dir] [update]
+//                            fixed ray-march poses and a seeded galaxy vs
+//                            golden images and timing baselines in dir
+//                            (default goldens/); exits 1 on a visual
+//                            change or a slowdown, "update" records them
+//   bh_cpu tiers             quality tiers (compile-time variants): cost
+//                            and error of low / medium vs high
+//   bh_cpu profile [out.json] [threads]
+//                            frame profiler overhead, and a Chrome trace
+//                            of a few tiled frames
+//   bh_cpu lut [out.ppm]     Schwarzschild deflection table renderer: cost,
+//                            and a check against direct Binet integration
+//   bh_cpu kerr [spin] [out.ppm]
+//                            Kerr tracer: rays/sec vs the 1/r^2 marcher,
+//                            spin 0 checked against the Schwarzschild table
+//   bh_cpu skip              sphere-of-influence skip / early escape:
+//                            steps saved per pixel and pixels changed
+//   bh_cpu volume [out.ppm]  volumetric thick disk: frame cost vs thin disk
+//   bh_cpu aa [budget] [spp] [out.ppm]
+//                            edge-driven supersampling: extra rays used and
+//                            error vs a uniform 9-sample reference
+//   bh_cpu progressive [out.ppm]
+//                            progressive refinement: cost and error of
+//                            each 1/16 phase after a camera move
+//   bh_cpu poster [width] [height] [out.ppm] [tile size]
+//                            out-of-core tiled still (default 8K): tiles
+//                            are written straight into the file, memory
+//                            does not grow with the resolution; threads,
+//                            tile size and packet width from the host's
+//                            "march" tuning cache
+//   bh_cpu coordinator [port] [width] [height] [out.ppm] [tile size]
+//                            hand tiles to workers over TCP, write the still
+//   bh_cpu worker [host] [port]
+//                            render tiles for a coordinator until it's done
+//   bh_cpu farm [workers]    localhost test: forks workers (one drops out
+//                            mid-frame, one hangs mid-tile), checks the
+//                            file vs a local render
+//                            (coordinator / worker / farm: not on Windows)
+
+#include "auto_tuner.hpp"
+#include "bh_raymarch_cpu.hpp"
+#include "galaxy_diagnostics.hpp"
+#include "geodesic_cache.hpp"
+#include "kerr_geodesic.hpp"
+#include "ray_stats.hpp"
+#include "quality_controller.hpp"
+#include "regression_harness.hpp"
+#include "render_farm.hpp"
+#include "schwarzschild_lut.hpp"
+#include "tiled_still.hpp"
+#include "volume_disk.hpp"
+
+#if BH_FARM
+#include <sys/wait.h>
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// ----------------------
+// Helpers
+// ----------------------
+static double nowSeconds() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static bool writePPM(const char* path, const vector<float>& rgb, int w, int h) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    fprintf(f, "P6\n%d %d\n255\n", w, h);
+
+    vector<unsigned char> row(static_cast<size_t>(w) * 3);
+    for (int y = 0; y < h; ++y) {
+        for (int i = 0; i < w * 3; ++i) {
+            float v = clampf(rgb[static_cast<size_t>(y) * w * 3 + i], 0.0f, 1.0f);
+            row[i] = static_cast<unsigned char>(v * 255.0f + 0.5f);
+        }
+        fwrite(row.data(), 1, row.size(), f);
+    }
+    fclose(f);
+    return true;
+}
+
+// Mean absolute per-channel error of a against a reference frame
+static double meanAbsError(const vector<float>& a, const vector<float>& b) {
+    double e = 0.0;
+    for (size_t i = 0; i < a.size(); ++i) e += fabs(a[i] - b[i]);
+    return e / a.size();
+}
+
+// Byte-for-byte file comparison
+static bool sameFile(const char* pathA, const char* pathB) {
+    FILE* a = fopen(pathA, "rb");
+    FILE* b = fopen(pathB, "rb");
+    int ca = 0, cb = 0;
+    while (a && b && (ca = fgetc(a)) == (cb = fgetc(b)) && ca != EOF) {}
+    bool same = a && b && ca == EOF && cb == EOF;
+    if (a) fclose(a);
+    if (b) fclose(b);
+    return same;
+}
+
+static void renderWithWidth(const RayMarchParams& p, vector<float>& rgb, int width) {
+    const int h = static_cast<int>(p.resolutionY);
+    if (width == 16)     renderRowsPacket<16>(p, rgb, 0, h);
+    else if (width == 8) renderRowsPacket<8>(p, rgb, 0, h);
+    else                 renderRowsReference(p, rgb, 0, h);
+}
+
+// ----------------------
+// Modes
+// ----------------------
+static int cmdRender(const RayMarchParams& p, const char* out, int width) {
+    vector<float> rgb(static_cast<size_t>(p.resolutionX) * static_cast<size_t>(p.resolutionY) * 3);
+    renderWithWidth(p, rgb, width);
+
+    if (!writePPM(out, rgb, static_cast<int>(p.resolutionX), static_cast<int>(p.resolutionY))) {
+        fprintf(stderr, "cannot write %s\n", out);
+        return 1;
+    }
+    printf("wrote %s\n", out);
+    return 0;
+}
+
+// Packets must match the scalar reference. Rays that graze a threshold
+// (horizon radius, disk edge) may flip on last-ulp differences, so allow
+// a tiny fraction of pixels to differ.
+static int cmdVerify(RayMarchParams p) {
+    p.resolutionX = 320.0f;
+    p.resolutionY = 180.0f;
+    p.time = 1.7f;
+
+    const size_t n = static_cast<size_t>(p.resolutionX * p.resolutionY);
+    vector<float> ref(n * 3), pk(n * 3);
+
+    int failures = 0;
+    const float tolerances[] = { 0.0f, 0.01f };   // fixed step, adaptive
+    const float radii[] = { 0.0f, p.diskOuter };    // influence sphere off / on
+    for (float rInf : radii)
+    for (float tol : tolerances) {
+        p.stepTolerance = tol;
+        p.influenceRadius = rInf;
+        renderWithWidth(p, ref, 1);
+
+        const int widths[] = { 8, 16 };
+        for (int width : widths) {
+            renderWithWidth(p, pk, width);
+
+            float maxDiff = 0.0f;
+            size_t bad = 0;
+            for (size_t i = 0; i < n; ++i) {
+                float d = 0.0f;
+                for (int c = 0; c < 3; ++c) {
+                    d = fmaxf(d, fabsf(ref[i * 3 + c] - pk[i * 3 + c]));
+                }
+                maxDiff = fmaxf(maxDiff, d);
+                if (d > 1.0f / 255.0f) ++bad;
+            }
+
+            bool ok = bad <= n / 1000;
+            printf("%s %s packet x%-2d  max diff %.6f  pixels > 1/255: %zu / %zu  %s\n",
+                   tol > 0.0f ? "adaptive" : "fixed   ", rInf > 0.0f ? "skip" : "    ",
+                   width, maxDiff, bad, n, ok ? "OK" : "FAIL");
+            if (!ok) ++failures;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+static int cmdBench(const RayMarchParams& p) {
+    vector<float> rgb(static_cast<size_t>(p.resolutionX * p.resolutionY) * 3);
+    const double rays = p.resolutionX * p.resolutionY;
+
+    const int widths[] = { 1, 8, 16 };
+    for (int width : widths) {
+        renderWithWidth(p, rgb, width);   // warm-up
+
+        const int frames = 3;
+        double t0 = nowSeconds();
+        for (int i = 0; i < frames; ++i) renderWithWidth(p, rgb, width);
+        double dt = (nowSeconds() - t0) / frames;
+
+        printf("%-10s %8.2f ms/frame  %8.2f Mrays/s\n",
+               width == 1 ? "reference" : (width == 8 ? "packet x8" : "packet x16"),
+               dt * 1000.0, rays / dt * 1e-6);
+    }
+    return 0;
+}
+
+static void printUtilization(const vector<TileWorkerStats>& stats, double wall) {
+    double sum = 0.0;
+    for (size_t i = 0; i < stats.size(); ++i) {
+        double util = wall > 0.0 ? stats[i].busySeconds / wall : 0.0;
+        sum += util;
+        printf("    thread %2zu  busy %7.2f ms  util %5.1f%%  tiles %4d  steals %3d\n",
+               i, stats[i].busySeconds * 1000.0, util * 100.0, stats[i].tiles, stats[i].steals);
+    }
+    printf("    mean util %5.1f%%\n", stats.empty() ? 0.0 : sum / stats.size() * 100.0);
+}
+
+static int cmdTiles(const RayMarchParams& p, int threads, int tileSize) {
+    vector<float> rgb(static_cast<size_t>(p.resolutionX * p.resolutionY) * 3);
+    const int h = static_cast<int>(p.resolutionY);
+
+    // Static split: thread i renders one contiguous band of rows
+    vector<TileWorkerStats> rowStats(threads);
+    double t0 = nowSeconds();
+    {
+        vector<thread> pool;
+        for (int i = 0; i < threads; ++i) {
+            pool.emplace_back([&, i]() {
+                double s = nowSeconds();
+                renderRowsPacket<8>(p, rgb, h * i / threads, h * (i + 1) / threads);
+                rowStats[i].busySeconds = nowSeconds() - s;
+                rowStats[i].tiles = 1;
+            });
+        }
+        for (thread& th : pool) th.join();
+    }
+    double rowWall = nowSeconds() - t0;
+
+    vector<TileWorkerStats> tileStats;
+    double tileWall = renderTiledPacket<8>(p, rgb, tileSize, threads, tileStats);
+
+    printf("static rows     %8.2f ms\n", rowWall * 1000.0);
+    printUtilization(rowStats, rowWall);
+    printf("work stealing   %8.2f ms  (%dx%d tiles)\n", tileWall * 1000.0, tileSize, tileSize);
+    printUtilization(tileStats, tileWall);
+    return 0;
+}
+
+// Frame profiler: a few tiled frames recorded and exported as a Chrome
+// trace, then the cost of one scope disabled / enabled
+static int cmdProfile(RayMarchParams p, const char* out, int threads) {
+    FrameProfiler& profiler = FrameProfiler::instance();
+    profiler.setThreadName("main");
+
+    p.stepTolerance   = 0.01f;
+    p.influenceRadius = p.diskOuter;
+    vector<float> rgb(static_cast<size_t>(p.resolutionX * p.resolutionY) * 3);
+    vector<TileWorkerStats> stats;
+    const int frames = 8;
+    profiler.setEnabled(true);
+    for (int frame = 0; frame < frames; ++frame) {
+        PROFILE_SCOPE("frame");
+        p.time = frame / 60.0f;
+        renderTiledPacket<8>(p, rgb, 32, threads, stats);
+    }
+    profiler.setEnabled(false);
+
+    printProfileSummary(profiler.summarize(60.0), 60.0);
+    if (!profiler.writeChromeTrace(out)) {
+        fprintf(stderr, "cannot write %s\n", out);
+        return 1;
+    }
+    printf("wrote %s\n", out);
+
+    // After the export, so the empty scopes don't crowd the trace
+    const int scopes = 10000000;
+    volatile int sink = 0;
+    double t0 = nowSeconds();
+    for (int i = 0; i < scopes; ++i) sink = sink + 1;
+    double bare = (nowSeconds() - t0) * 1e9 / scopes;
+
+    double perScope[2];
+    for (int on = 0; on < 2; ++on) {
+        profiler.setEnabled(on != 0);
+        t0 = nowSeconds();
+        for (int i = 0; i < scopes; ++i) {
+            PROFILE_SCOPE("empty");
+            sink = sink + 1;
+        }
+        perScope[on] = (nowSeconds() - t0) * 1e9 / scopes;
+    }
+    printf("loop body %.2f ns; with a scope %.2f ns disabled, %.2f ns enabled\n",
+           bare, perScope[0], perScope[1]);
+    profiler.setEnabled(false);
+    return 0;
+}
+
+// GalaxySim dt / integrator sweep with viscosity and capture off, so
+// the physics conserves E and L and any drift is integrator error.
+// One CSV per run (prefix_<integrator>_<dt>.csv), sampled every 10 steps.
+static int cmdGalaxy(const char* prefix) {
+    const int    stars   = 10000;
+    const double simTime = 20.0;
+    const int    every   = 10;
+    const float  dts[]   = { 0.005f, 0.01f, 0.02f, 0.04f };
+    const char*  names[] = { "euler", "leapfrog" };
+
+    printf("%d stars, %.0f time units, no viscosity / capture\n", stars, simTime);
+    printf("integrator  dt       max |dE/E0|  max |dL/L0|   step us  sample us\n");
+    for (int integrator = SIM_EULER; integrator <= SIM_LEAPFROG; ++integrator) {
+        for (float dt : dts) {
+            GalaxySim sim;
+            sim.P.dt            = dt;
+            sim.P.integrator    = integrator;
+            sim.P.viscosityBase = 0.0f;
+            sim.P.horizonRadius = 0.0f;
+            sim.init(stars);
+
+            char path[256];
+            snprintf(path, sizeof(path), "%s_%s_%g.csv", prefix, names[integrator], dt);
+            GalaxyDiagnosticsSampler sampler;
+            sampler.every = every;
+            if (!sampler.csv.open(path)) {
+                fprintf(stderr, "cannot write %s\n", path);
+                return 1;
+            }
+            GalaxyDiagnostics d0 = measureGalaxy(sim, 0, 0.0);
+            sampler.csv.write(d0);
+
+            const int steps = static_cast<int>(simTime / dt + 0.5);
+            double maxDE = 0.0, maxDL = 0.0, stepSec = 0.0, sampleSec = 0.0;
+            int samples = 0;
+            for (int i = 0; i < steps; ++i) {
+                double t0 = nowSeconds();
+                sim.step();
+                stepSec += nowSeconds() - t0;
+                if ((i + 1) % every == 0) {
+                    t0 = nowSeconds();
+                    GalaxyDiagnostics d = measureGalaxy(sim, i + 1, (i + 1) * static_cast<double>(dt));
+                    sampleSec += nowSeconds() - t0;
+                    ++samples;
+                    sampler.csv.write(d);
+                    maxDE = fmax(maxDE, fabs((d.energy - d0.energy) / d0.energy));
+                    maxDL = fmax(maxDL, fabs((d.angMom - d0.angMom) / d0.angMom));
+                }
+            }
+            sampler.csv.close();
+            printf("%-10s  %-7g  %11.3e  %11.3e  %8.1f  %9.1f\n", names[integrator], dt, maxDE, maxDL,
+                   stepSec * 1e6 / steps, samples ? sampleSec * 1e6 / samples : 0.0);
+        }
+    }
+    printf("wrote %s_*.csv\n", prefix);
+    return 0;
+}
+
+// 3D mode against 2D: step cost for the same stars, then a leapfrog
+// run with viscosity and capture off (E and L_z conserved, so drift is
+// integrator error) watching the disk's rms thickness, and a splat of
+// a 3D disk at viewer settings (stars only glow when heated) at the
+// given tilt
+static int cmdGalaxy3D(const char* out, float tiltDegrees) {
+    const int stars = 100000;
+    const int steps = 200;
+
+    double stepUs[2];
+    for (int threeD = 0; threeD < 2; ++threeD) {
+        GalaxySim sim;
+        sim.P.threeD = threeD;
+        sim.seed(1);
+        sim.init(stars);
+        sim.step();   // warm the caches
+        double t0 = nowSeconds();
+        for (int i = 0; i < steps; ++i) sim.step();
+        stepUs[threeD] = (nowSeconds() - t0) * 1e6 / steps;
+    }
+    printf("%d stars, euler step: 2D %.1f us, 3D %.1f us (%.2fx)\n", stars, stepUs[0], stepUs[1],
+           stepUs[1] / stepUs[0]);
+
+    GalaxySim sim;
+    sim.P.threeD        = 1;
+    sim.P.integrator    = SIM_LEAPFROG;
+    sim.P.viscosityBase = 0.0f;
+    sim.P.horizonRadius = 0.0f;
+    sim.seed(1);
+    sim.init(stars / 10);
+
+    const double simTime = 20.0;
+    const int total = static_cast<int>(simTime / sim.P.dt + 0.5);
+    GalaxyDiagnostics d0 = measureGalaxy(sim, 0, 0.0);
+    printf("leapfrog dt %g, no viscosity / capture\n", sim.P.dt);
+    printf("    time   |dE/E0|     |dL/L0|     rms z\n");
+    printf("%8.2f  %10.3e  %10.3e  %8.4f\n", 0.0, 0.0, 0.0, d0.rmsZ);
+    for (int i = 1; i <= total; ++i) {
+        sim.step();
+        if (i % (total / 5) == 0) {
+            GalaxyDiagnostics d = measureGalaxy(sim, i, i * static_cast<double>(sim.P.dt));
+            printf("%8.2f  %10.3e  %10.3e  %8.4f\n", d.time, fabs((d.energy - d0.energy) / d0.energy),
+                   fabs((d.angMom - d0.angMom) / d0.angMom), d.rmsZ);
+        }
+    }
+
+    GalaxySim view;
+    view.P.threeD = 1;
+    view.seed(1);
+    view.init(stars);
+    for (int i = 0; i < 300; ++i) view.step();
+
+    const int w = 640, h = 360;
+    RegressImage img;
+    img.resize(w, h);
+    for (size_t i = 0; i < img.rgb.size(); i += 3) img.rgb[i + 2] = 10;
+    const float tilt = tiltDegrees * 3.14159265f / 180.0f;
+    const GalaxyProjection proj(w / 2.0f, h / 2.0f, 12.0f, tilt, 0.0f);
+    TunedSettings splat = loadOrTuneGalaxySplat(".", view, proj, w, h, false, true);
+    splatGalaxyStarsTiled(view, proj, w, h, img.rgb.data(), splat.tileSize, splat.threads);
+    if (!writeRegressImage(out, img)) {
+        fprintf(stderr, "cannot write %s\n", out);
+        return 1;
+    }
+    printf("wrote %s (tilt %g degrees)\n", out, tiltDegrees);
+    return 0;
+}
+
+// Hardware counters per stage for GalaxySim::step (both integrators),
+// the galaxy viewer's vertex build and the tiled ray march, per star /
+// per ray next to the time
+static int cmdCounters(int stars, int steps, int threads) {
+    PerfCounters& pc = PerfCounters::instance();
+    pc.setThreadName("main");
+    if (!pc.setEnabled(true)) {
+        printf("hardware counters unavailable, timing only: %s\n", pc.unavailableReason().c_str());
+    }
+    const char* names[] = { "euler", "leapfrog" };
+
+    printf("%d stars x %d steps\n", stars, steps);
+    for (int integrator = SIM_EULER; integrator <= SIM_LEAPFROG; ++integrator) {
+        GalaxySim sim;
+        sim.seed(1);
+        sim.P.integrator = integrator;
+        sim.init(stars);
+
+        // sf::Vertex layout (position, color, texCoords), filled as
+        // main_galaxy.cpp's vertex build does
+        struct Vertex { float x, y; uint8_t r, g, b, a; float u, v; };
+        vector<Vertex> vertices(stars);
+        const float scale = 12.0f, cx = 640.0f, cy = 360.0f;
+
+        pc.reset();
+        for (int s = 0; s < steps; ++s) {
+            {
+                PROFILE_SCOPE("sim step");
+                sim.step();
+            }
+            {
+                PROFILE_SCOPE("vertex build");
+                for (int i = 0; i < stars; ++i) {
+                    float speed = sqrt(sim.velX[i] * sim.velX[i] + sim.velY[i] * sim.velY[i]);
+                    float t = clampf(speed / 6.0f, 0.0f, 1.0f);
+                    float glow = fmin(sim.brightness[i], 2.0f);
+                    Vertex& v = vertices[i];
+                    v.x = cx + sim.posX[i] * scale;
+                    v.y = cy + sim.posY[i] * scale;
+                    v.r = static_cast<uint8_t>(fmin(220.0f * glow, 255.0f));
+                    v.g = static_cast<uint8_t>(fmin(140.0f * glow, 255.0f));
+                    v.b = static_cast<uint8_t>(fmin(80.0f * glow + 60.0f * t, 255.0f));
+                    v.a = 255;
+                }
+            }
+        }
+        printf("%s\n", names[integrator]);
+        for (const PerfStageTotals& s : pc.perStage()) {
+            printPerfStage(s, static_cast<double>(stars) * steps, "star");
+        }
+    }
+
+    RayMarchParams p;
+    const int frames = 3;
+    vector<float> rgb(static_cast<size_t>(p.resolutionX) * static_cast<size_t>(p.resolutionY) * 3);
+    vector<TileWorkerStats> stats;
+    pc.reset();
+    for (int f = 0; f < frames; ++f) renderTiledPacket<8>(p, rgb, 32, threads, stats);
+    printf("ray march, %d frames, %d threads\n", frames, threads);
+    const double rays = static_cast<double>(p.resolutionX) * p.resolutionY * frames;
+    for (const PerfStageTotals& s : pc.perStage()) printPerfStage(s, rays, "ray");
+    for (const PerfStageTotals& s : pc.perLane()) printPerfStage(s, static_cast<double>(s.totals.calls), "tile");
+    return 0;
+}
+
+// Calibrate (or load) this host's threads / tile size / packet width
+// for one kernel, then check the winners against the untuned defaults
+static int cmdTune(const RayMarchParams& p, GeodesicTracer tracer, bool force) {
+    double t0 = nowSeconds();
+    TunedSettings t = loadOrTuneRayMarch(".", p, tracer, force, true);
+    double seconds = nowSeconds() - t0;
+    if (t.fromCache) {
+        printf("loaded from %s in %.2f ms: packet %d, tile %d, %d threads\n",
+               tuneCachePath(".", currentHost(), tuneKernelName(tracer)).c_str(), seconds * 1000.0,
+               t.packetWidth, t.tileSize, t.threads);
+    }
+
+    RayMarchParams q = p;
+    q.resolutionX = static_cast<float>(TUNE_WIDTH);
+    q.resolutionY = static_cast<float>(TUNE_HEIGHT);
+    vector<float> rgb(static_cast<size_t>(TUNE_WIDTH) * TUNE_HEIGHT * 3);
+    GeodesicCache cache;
+    TunedSettings def;
+    def.threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    tuneFrameSeconds(q, tracer, def, rgb, cache);   // warm-up (builds the table for lut)
+    double defMs = 1e30, tunedMs = 1e30;
+    for (int r = 0; r < 3; ++r) {
+        defMs   = min(defMs, tuneFrameSeconds(q, tracer, def, rgb, cache) * 1000.0);
+        tunedMs = min(tunedMs, tuneFrameSeconds(q, tracer, t, rgb, cache) * 1000.0);
+    }
+    const int hw = def.threads;
+    printf("%dx%d frame: defaults (packet 8, tile 32, %d threads) %.2f ms, tuned %.2f ms\n",
+           TUNE_WIDTH, TUNE_HEIGHT, hw, defMs, tunedMs);
+    return 0;
+}
+
+// Splat tuning on the galaxy viewer's frame (1280x720, 12 pixels per
+// unit) of a seeded disk after 300 steps, then the winners against the
+// serial splat
+static int cmdTuneSplat(int stars, bool force) {
+    const int w = 1280, h = 720;
+    GalaxySim sim;
+    sim.seed(1);
+    sim.init(stars);
+    for (int i = 0; i < 300; ++i) sim.step();
+    const GalaxyProjection view(w / 2.0f, h / 2.0f, 12.0f, 0.0f, 0.0f);
+
+    double t0 = nowSeconds();
+    TunedSettings t = loadOrTuneGalaxySplat(".", sim, view, w, h, force, true);
+    double seconds = nowSeconds() - t0;
+    if (t.fromCache) {
+        printf("loaded from %s in %.2f ms: tile %d, %d threads\n",
+               tuneCachePath(".", currentHost(), TUNE_SPLAT_KERNEL).c_str(), seconds * 1000.0,
+               t.tileSize, t.threads);
+    }
+
+    TunedSettings serial;
+    serial.tileSize = 0;
+    serial.threads  = 1;
+    vector<uint8_t> rgb;
+    tuneSplatSeconds(sim, view, w, h, t, rgb);   // warm-up
+    double serialMs = 1e30, tunedMs = 1e30;
+    for (int r = 0; r < TUNE_SPLAT_REPEATS; ++r) {
+        serialMs = min(serialMs, tuneSplatSeconds(sim, view, w, h, serial, rgb) * 1000.0);
+        tunedMs  = min(tunedMs, tuneSplatSeconds(sim, view, w, h, t, rgb) * 1000.0);
+    }
+    printf("%d stars, %dx%d: serial %.3f ms, tuned %.3f ms\n", stars, w, h, serialMs, tunedMs);
+    return 0;
+}
+
+// Frame-budget controller on an orbiting camera: a budget of half the
+// full-quality frame, then twice it. The step and resolution knobs
+// should come down until frames fit, then go back up to full quality.
+// Small frames (and a short window) so the run takes seconds here.
+static int cmdQuality(RayMarchParams p, int threads, const char* log) {
+    const int W = 160, H = 90;
+    const int framesPerPhase = 200;
+
+    QualityController quality;
+    quality.config.window   = 10;
+    quality.config.cooldown = 5;
+    const int qStep = quality.addKnob("step", 1.0, 4.0, 1.25, true);
+    const int qRes  = quality.addKnob("resolution", 1.0, 0.5, 0.85, true);
+    if (log && !quality.openLog(log)) fprintf(stderr, "cannot write %s\n", log);
+
+    const float baseStep = p.stepSize;
+    vector<float> rgb(static_cast<size_t>(W) * H * 3);
+    vector<TileWorkerStats> stats;
+    double orbit = 0.0;
+    auto frame = [&]() {
+        const float scale = static_cast<float>(quality.value(qRes));
+        p.resolutionX = static_cast<float>(max(1, static_cast<int>(W * scale)));
+        p.resolutionY = static_cast<float>(max(1, static_cast<int>(H * scale)));
+        p.stepSize    = baseStep * static_cast<float>(quality.value(qStep));
+        p.camPos      = Vec3(12.0f * sinf(static_cast<float>(orbit)), 1.0f, 12.0f * cosf(static_cast<float>(orbit)));
+        orbit += 0.01;
+        double t0 = nowSeconds();
+        renderTiledPacket<8>(p, rgb, 32, threads, stats);
+        return (nowSeconds() - t0) * 1000.0;
+    };
+
+    double fullMs = 1e30;
+    for (int i = 0; i < 3; ++i) fullMs = min(fullMs, frame());
+    printf("%dx%d full quality: %.2f ms\n", W, H, fullMs);
+
+    const double budgets[] = { fullMs * 0.5, fullMs * 2.0 };
+    for (double budget : budgets) {
+        quality.config.budgetMs = budget;
+        printf("budget %.2f ms\n", budget);
+        vector<double> tail;
+        for (int i = 0; i < framesPerPhase; ++i) {
+            double ms = frame();
+            quality.frame(ms);
+            if (i >= framesPerPhase - 30) tail.push_back(ms);
+        }
+        sort(tail.begin(), tail.end());
+        printf("  last 30 frames: p90 %.2f ms (%.0f%% of budget), step x%.3g, resolution %.3g\n",
+               tail[tail.size() * 9 / 10], tail[tail.size() * 9 / 10] / budget * 100.0,
+               quality.value(qStep), quality.value(qRes));
+    }
+    printf("%llu adjustments in %llu frames%s%s\n", static_cast<unsigned long long>(quality.adjustments),
+           static_cast<unsigned long long>(quality.frames), log ? ", logged to " : "", log ? log : "");
+    return 0;
+}
+
+// Fixed scenes against goldens / timing baselines in dir; "update"
+// records them. Ray-march poses render single-threaded so their times
+// are comparable run to run; the galaxy case times only its steps.
+static int cmdRegress(const char* dir, bool update) {
+    const int W = 640, H = 360;
+    const int repeats = 7;
+
+    struct Pose { const char* name; Vec3 camPos; float time; float tol; float influence; };
+    const Pose poses[] = {
+        { "march_front",    Vec3(0.0f, 1.0f, 12.0f),   0.0f, 0.0f,  0.0f },
+        { "march_edge_on",  Vec3(11.5f, 0.3f, 3.0f),   1.5f, 0.0f,  0.0f },
+        { "march_above",    Vec3(0.0f, 9.0f, 7.0f),    4.0f, 0.0f,  0.0f },
+        { "march_close",    Vec3(2.0f, 0.8f, 6.5f),    2.0f, 0.0f,  0.0f },
+        { "march_adaptive", Vec3(0.0f, 1.0f, 12.0f),   0.0f, 0.01f, 16.0f },
+    };
+
+    vector<RegressCase> cases;
+    for (const Pose& pose : poses) {
+        cases.push_back({ pose.name, [pose](RegressImage& img) {
+            RayMarchParams p;
+            p.resolutionX     = W;
+            p.resolutionY     = H;
+            p.camPos          = pose.camPos;
+            p.time            = pose.time;
+            p.stepTolerance   = pose.tol;
+            p.influenceRadius = pose.influence;
+            vector<float> rgb(static_cast<size_t>(W) * H * 3);
+            double t0 = nowSeconds();
+            renderRowsPacket<8>(p, rgb, 0, H);
+            double seconds = nowSeconds() - t0;
+            regressImageFromFloat(rgb, W, H, img);
+            return seconds;
+        } });
+    }
+    cases.push_back({ "galaxy_step300", [](RegressImage& img) {
+        GalaxySim sim;
+        sim.seed(1);
+        sim.init(20000);
+        double t0 = nowSeconds();
+        for (int i = 0; i < 300; ++i) sim.step();
+        double seconds = nowSeconds() - t0;
+        renderGalaxyFrame(sim, 1280, 720, 12.0f, img);
+        return seconds;
+    } });
+
+    std::error_code mkdirError;   // an existing dir is fine; a bad one fails on write
+    std::filesystem::create_directories(dir, mkdirError);
+    const string timings = string(dir) + "/timings.txt";
+    map<string, RegressTiming> baselines = readTimingBaselines(timings);
+    RegressTolerance tol;
+
+    int failed = 0;
+    printf("%s %s, %d rounds of all cases\n", update ? "recording" : "checking against", dir, repeats);
+    for (const RegressResult& r : runRegressSuite(cases, dir, update, tol, repeats, baselines)) {
+        if (update) {
+            printf("  %-20s  %8.1f ms  spread %6.1f ms  %s\n", r.name.c_str(),
+                   r.timing.best * 1e3, r.timing.spread * 1e3,
+                   r.imageOk ? "recorded" : "cannot write golden");
+            failed += r.imageOk ? 0 : 1;
+            continue;
+        }
+        printRegressResult(r);
+        failed += (r.haveGolden && r.imageOk && r.timeOk) ? 0 : 1;
+    }
+
+    if (update && !writeTimingBaselines(timings, baselines)) {
+        fprintf(stderr, "cannot write %s\n", timings.c_str());
+        return 1;
+    }
+    if (failed) {
+        printf("%d of %zu cases failed%s\n", failed, cases.size(),
+               update ? "" : " (record goldens with: regress [dir] update)");
+        return 1;
+    }
+    printf("all %zu cases pass\n", cases.size());
+    return 0;
+}
+
+// Animate with the geodesic cache vs full re-trace every frame, and
+// check the cached frames match the full render
+static int cmdGBuffer(RayMarchParams p, int threads) {
+    const size_t n = static_cast<size_t>(p.resolutionX * p.resolutionY);
+    vector<float> full(n * 3), cached(n * 3);
+    vector<TileWorkerStats> stats;
+
+    GeodesicCache cache;
+    double t0 = nowSeconds();
+    cache.update(p, 32, threads);
+    double traceMs = (nowSeconds() - t0) * 1000.0;
+
+    const int frames = 30;
+    int retraces = 0;
+    t0 = nowSeconds();
+    for (int i = 0; i < frames; ++i) {
+        p.time = i / 60.0f;
+        if (cache.update(p, 32, threads)) ++retraces;
+        cache.shade(p, cached);
+    }
+    double shadeMs = (nowSeconds() - t0) * 1000.0 / frames;
+
+    t0 = nowSeconds();
+    renderTiledPacket<8>(p, full, 32, threads, stats);
+    double fullMs = (nowSeconds() - t0) * 1000.0;
+
+    float maxDiff = 0.0f;
+    for (size_t i = 0; i < n * 3; ++i) maxDiff = fmaxf(maxDiff, fabsf(full[i] - cached[i]));
+
+    printf("initial trace   %8.2f ms\n", traceMs);
+    printf("cached frame    %8.3f ms  (%d re-traces in %d frames)\n", shadeMs, retraces, frames);
+    printf("full frame      %8.2f ms\n", fullMs);
+    printf("max diff vs full render %.6f  %s\n", maxDiff, maxDiff < 1e-4f ? "OK" : "FAIL");
+    return maxDiff < 1e-4f ? 0 : 1;
+}
+
+// Steps per ray and step-cap exhaustion for fixed vs adaptive stepping
+static int cmdSteps(RayMarchParams p) {
+    const int w = static_cast<int>(p.resolutionX);
+    const int h = static_cast<int>(p.resolutionY);
+
+    const float tolerances[] = { 0.0f, 0.02f, 0.01f, 0.005f, 0.0025f };
+    for (float tol : tolerances) {
+        p.stepTolerance = tol;
+        RayFrame f = makeRayFrame(p);
+
+        double steps = 0.0;
+        size_t exhausted = 0, disk = 0;
+        double t0 = nowSeconds();
+        traceRectPacket<8>(p, f, 0, 0, w, h,
+            [&](int, int, const RayResult& res) {
+                steps += res.steps;
+                if (res.hit == RAY_DISK) ++disk;
+                if (res.hit == RAY_MISS && res.steps == RAY_MAX_STEPS) ++exhausted;
+            });
+        double ms = (nowSeconds() - t0) * 1000.0;
+
+        const double n = static_cast<double>(w) * h;
+        if (tol > 0.0f) printf("adaptive tol %-7.4f", tol);
+        else            printf("fixed step %-9.3f", p.stepSize);
+        printf(" %7.2f steps/ray  %5.1f%% hit step cap  %5.1f%% disk  %8.2f ms\n",
+               steps / n, exhausted * 100.0 / n, disk * 100.0 / n, ms);
+    }
+    return 0;
+}
+
+// One frame through a compile-time variant: time, steps per ray and
+// rays that ran out of steps (the quality-tier knobs)
+template <class V>
+static double traceVariant(const RayMarchParams& p, vector<float>& rgb,
+                           double& stepsPerRay, double& cappedPct) {
+    const int w = static_cast<int>(p.resolutionX);
+    const int h = static_cast<int>(p.resolutionY);
+    RayFrame f = makeRayFrame(p);
+
+    double steps = 0.0;
+    size_t capped = 0;
+    double t0 = nowSeconds();
+    traceRectPacket<8, V>(p, f, 0, 0, w, h,
+        [&](int x, int y, const RayResult& res) {
+            steps += res.steps;
+            if (res.hit == RAY_MISS && res.steps == V::maxSteps) ++capped;
+            Vec3 c = shadeRay(p, f, res);
+            float* px = &rgb[(static_cast<size_t>(y) * w + x) * 3];
+            px[0] = c.x; px[1] = c.y; px[2] = c.z;
+        });
+    double ms = (nowSeconds() - t0) * 1000.0;
+
+    const double n = static_cast<double>(w) * h;
+    stepsPerRay = steps / n;
+    cappedPct   = capped * 100.0 / n;
+    return ms;
+}
+
+// Quality tiers (RayTier<...>, the CPU side of the shader variants):
+// cost and error against the high tier, for a fixed-step and an
+// adaptive scene. A pinned step mode must match the runtime switch.
+static int cmdTiers(RayMarchParams p) {
+    const size_t n = static_cast<size_t>(p.resolutionX) * static_cast<size_t>(p.resolutionY);
+    vector<float> ref(n * 3), rgb(n * 3), runtime(n * 3);
+    double spr, capped;
+    bool ok = true;
+
+    for (int adaptive = 0; adaptive < 2; ++adaptive) {
+        p.stepTolerance   = adaptive ? 0.01f : 0.0f;
+        p.influenceRadius = adaptive ? p.diskOuter : 0.0f;
+        printf("%s scene\n", adaptive ? "adaptive-step" : "fixed-step");
+
+        double ms = traceVariant<RayTierHigh>(p, ref, spr, capped);
+        printf("  %-8s %8.2f ms  %7.2f steps/ray  %5.1f%% hit step cap\n",
+               QUALITY_TIERS[TIER_HIGH].name, ms, spr, capped);
+        ms = traceVariant<RayTierMedium>(p, rgb, spr, capped);
+        printf("  %-8s %8.2f ms  %7.2f steps/ray  %5.1f%% hit step cap  mean abs error %.5f\n",
+               QUALITY_TIERS[TIER_MEDIUM].name, ms, spr, capped, meanAbsError(rgb, ref));
+        ms = traceVariant<RayTierLow>(p, rgb, spr, capped);
+        printf("  %-8s %8.2f ms  %7.2f steps/ray  %5.1f%% hit step cap  mean abs error %.5f\n",
+               QUALITY_TIERS[TIER_LOW].name, ms, spr, capped, meanAbsError(rgb, ref));
+
+        // Same step mode, pinned at compile time vs read from params
+        if (adaptive) {
+            double pinnedMs  = traceVariant<RayVariant<RAY_MAX_STEPS, 80, 1>>(p, rgb, spr, capped);
+            double runtimeMs = traceVariant<RayTierMedium>(p, runtime, spr, capped);
+            bool same = rgb == runtime;
+            printf("  pinned adaptive %8.2f ms vs runtime %8.2f ms  %s\n",
+                   pinnedMs, runtimeMs, same ? "identical" : "DIFFER");
+            ok = ok && same;
+        }
+    }
+    return ok ? 0 : 1;
+}
+
+// Steps and exit reasons per pixel for a few step settings, heatmap of
+// the first; exit codes checked against the scalar reference
+static int cmdRayStats(RayMarchParams p, const char* out, int threads) {
+    struct Config {
+        const char* label;
+        float stepSize, tolerance, influence;
+        bool  highCap;
+    };
+    const Config configs[] = {
+        { "fixed 0.10, cap 140",              0.10f, 0.00f, 0.0f,        false },
+        { "fixed 0.20, cap 140",              0.20f, 0.00f, 0.0f,        false },
+        { "fixed 0.10, cap 400",              0.10f, 0.00f, 0.0f,        true  },
+        { "adaptive 0.01, cap 140",           0.10f, 0.01f, 0.0f,        false },
+        { "adaptive 0.01 + influence, cap 140", 0.10f, 0.01f, p.diskOuter, false },
+    };
+
+    RayMarchStats stats;
+    size_t mismatched = 0;
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); ++c) {
+        const Config& cfg = configs[c];
+        p.stepSize        = cfg.stepSize;
+        p.stepTolerance   = cfg.tolerance;
+        p.influenceRadius = cfg.influence;
+
+        double sec = cfg.highCap ? collectRayMarchStats<RayTierHigh>(p, stats, threads)
+                                 : collectRayMarchStats<RayTierMedium>(p, stats, threads);
+        printf("%s  (%.2f ms)\n", cfg.label, sec * 1000.0);
+        printRayMarchStats(stats);
+
+        if (!cfg.highCap) {
+            RayFrame f = makeRayFrame(p);
+            for (int y = 0; y < stats.height; y += 3) {
+                for (int x = 0; x < stats.width; x += 3) {
+                    RayResult ref = traceRayReference(p, f, x + 0.5f, stats.height - y - 0.5f);
+                    size_t i = static_cast<size_t>(y) * stats.width + x;
+                    if (ref.exit != stats.exits[i]) ++mismatched;
+                }
+            }
+        }
+        if (c == 0 && !writeStepHeatmap(out, stats)) {
+            fprintf(stderr, "cannot write %s\n", out);
+            return 1;
+        }
+    }
+    printf("exit reason vs scalar reference: %zu mismatches (every 3rd pixel)\n", mismatched);
+    printf("wrote %s (fixed 0.10, white = step cap)\n", out);
+    return 0;
+}
+
+// Per-pixel steps with the influence sphere off / on, same camera
+static int cmdSkip(RayMarchParams p) {
+    const int w = static_cast<int>(p.resolutionX);
+    const int h = static_cast<int>(p.resolutionY);
+    const size_t n = static_cast<size_t>(w) * h;
+    const float rInf = p.diskOuter;
+
+    struct Pose { const char* name; Vec3 camPos; };
+    const Pose poses[] = {
+        { "default camera", p.camPos },
+        { "far camera",     Vec3(0.0f, 4.0f, 40.0f) },
+    };
+    const float tolerances[] = { 0.0f, 0.01f };
+
+    printf("influence radius %.2f\n", rInf);
+    for (const Pose& pose : poses) {
+        for (float tol : tolerances) {
+            p.camPos = pose.camPos;
+            p.stepTolerance = tol;
+            RayFrame f = makeRayFrame(p);
+
+            vector<RayResult> base(n), skip(n);
+            double t0 = nowSeconds();
+            p.influenceRadius = 0.0f;
+            traceRectPacket<8>(p, f, 0, 0, w, h,
+                [&](int x, int y, const RayResult& res) { base[static_cast<size_t>(y) * w + x] = res; });
+            double t1 = nowSeconds();
+            p.influenceRadius = rInf;
+            traceRectPacket<8>(p, f, 0, 0, w, h,
+                [&](int x, int y, const RayResult& res) { skip[static_cast<size_t>(y) * w + x] = res; });
+            double t2 = nowSeconds();
+
+            double stepsBase = 0.0, stepsSkip = 0.0;
+            size_t changed = 0;
+            for (size_t i = 0; i < n; ++i) {
+                stepsBase += base[i].steps;
+                stepsSkip += skip[i].steps;
+                if (base[i].hit != skip[i].hit ||
+                    (base[i].hit == RAY_DISK && fabsf(base[i].diskR - skip[i].diskR) > 0.05f)) ++changed;
+            }
+
+            printf("%-15s %-9s %7.2f -> %6.2f steps/px  (saved %6.2f)  %8.2f -> %7.2f ms  %zu px changed\n",
+                   pose.name, tol > 0.0f ? "adaptive" : "fixed",
+                   stepsBase / n, stepsSkip / n, (stepsBase - stepsSkip) / n,
+                   (t1 - t0) * 1000.0, (t2 - t1) * 1000.0, changed);
+        }
+    }
+    return 0;
+}
+
+// Thin plane vs volumetric slab, same march settings as main.cpp
+static int cmdVolume(RayMarchParams p, const char* out, int threads) {
+    const int w = static_cast<int>(p.resolutionX);
+    const int h = static_cast<int>(p.resolutionY);
+    const double n = static_cast<double>(w) * h;
+    vector<float> rgb(static_cast<size_t>(w) * h * 3);
+    vector<TileWorkerStats> stats;
+
+    p.stepTolerance   = 0.01f;
+    p.influenceRadius = p.diskOuter;
+    RayFrame f = makeRayFrame(p);
+
+    double t0 = nowSeconds();
+    renderRowsReference(p, rgb, 0, h);
+    double thinRefMs = (nowSeconds() - t0) * 1000.0;
+    double thinPkMs  = renderTiledPacket<8>(p, rgb, 32, threads, stats) * 1000.0;
+
+    p.diskModel = DISK_VOLUME;
+    double volMs = renderTiledVolume(p, rgb, 32, threads, stats) * 1000.0;
+
+    double steps = 0.0, samples = 0.0;
+    size_t opaque = 0, touched = 0;
+    traceRectVolume(p, f, 0, 0, w, h,
+        [&](int, int, const VolumeResult& v) {
+            steps   += v.steps;
+            samples += v.samples;
+            if (v.samples > 0) ++touched;
+            if (v.transmittance < VOL_MIN_TRANSMIT) ++opaque;
+        });
+
+    printf("thin disk, scalar reference   %8.2f ms\n", thinRefMs);
+    printf("thin disk, packet x8 tiled    %8.2f ms  (%d threads)\n", thinPkMs, threads);
+    printf("volumetric disk, tiled        %8.2f ms  (%d threads, %.2fx scalar thin)\n",
+           volMs, threads, volMs / thinRefMs);
+    printf("  %.2f coarse steps/px, %.2f fine samples/px (%.1f per ray entering the slab)\n",
+           steps / n, samples / n, touched ? samples / touched : 0.0);
+    printf("  %5.1f%% of rays enter the slab, %5.1f%% stop on opacity\n",
+           touched * 100.0 / n, opaque * 100.0 / n);
+
+    if (!writePPM(out, rgb, w, h)) {
+        fprintf(stderr, "cannot write %s\n", out);
+        return 1;
+    }
+    printf("wrote %s\n", out);
+    return 0;
+}
+
+static int cmdAA(RayMarchParams p, int budget, int spp, const char* out, int threads) {
+    const int w = static_cast<int>(p.resolutionX);
+    const int h = static_cast<int>(p.resolutionY);
+    const size_t n = static_cast<size_t>(w) * h;
+
+    p.stepTolerance   = 0.01f;
+    p.influenceRadius = p.diskOuter;
+    RayFrame f = makeRayFrame(p);
+
+    // Reference: the pixel's own ray + all 8 offsets, every pixel
+    vector<float> ref(n * 3, 0.0f);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            Vec3 c = rayMarchReference(p, f, x + 0.5f, h - y - 0.5f);
+            for (int s = 0; s < 8; ++s) {
+                c = c + rayMarchReference(p, f, x + EDGE_AA_OFFSETS[s][0], h - y - EDGE_AA_OFFSETS[s][1]);
+            }
+            float* px = &ref[(static_cast<size_t>(y) * w + x) * 3];
+            px[0] = c.x / 9.0f; px[1] = c.y / 9.0f; px[2] = c.z / 9.0f;
+        }
+    }
+
+    vector<float> rgb(n * 3);
+    GeodesicCache cache;
+
+    double t0 = nowSeconds();
+    cache.update(p, 32, threads);
+    double baseMs = (nowSeconds() - t0) * 1000.0;
+    cache.shade(p, rgb);
+    double baseErr = meanAbsError(rgb, ref);
+
+    cache.aa.budget = budget;
+    cache.aa.samplesPerPixel = spp;
+    t0 = nowSeconds();
+    cache.update(p, 32, threads);
+    double aaMs = (nowSeconds() - t0) * 1000.0;
+    cache.shade(p, rgb);
+    double aaErr = meanAbsError(rgb, ref);
+
+    const EdgeAAStats& st = cache.aaStats;
+    printf("budget %d extra rays, %d per edge pixel\n", budget, edgeAASamples(cache.aa));
+    printf("edge pixels %d (%.2f%% of frame), supersampled %d\n",
+           st.edgePixels, st.edgePixels * 100.0 / n, st.supersampled);
+    printf("extra rays %d = %.2f%% of one frame (uniform 4x: %zu)\n",
+           st.extraRays, st.extraRays * 100.0 / n, n * 3);
+    printf("1 spp        %8.2f ms  mean abs error %.5f\n", baseMs, baseErr);
+    printf("edge AA      %8.2f ms  mean abs error %.5f\n", aaMs, aaErr);
+
+    if (!writePPM(out, rgb, w, h)) {
+        fprintf(stderr, "cannot write %s\n", out);
+        return 1;
+    }
+    printf("wrote %s\n", out);
+    return 0;
+}
+
+// A camera move with progressive refinement: phase 0 traces 1/16 of
+// the pixels, each still frame adds 1/16 until it matches a full trace
+static int cmdProgressive(RayMarchParams p, const char* out, int threads) {
+    const int w = static_cast<int>(p.resolutionX);
+    const int h = static_cast<int>(p.resolutionY);
+    const size_t n = static_cast<size_t>(w) * h;
+
+    p.stepTolerance   = 0.01f;
+    p.influenceRadius = p.diskOuter;
+
+    vector<float> full(n * 3), rgb(n * 3);
+    GeodesicCache cache;
+    cache.progressive = true;
+    cache.update(p, 32, threads);
+
+    // Move the camera, then hold it still
+    p.camPos = Vec3(1.0f, 1.5f, 11.5f);
+
+    GeodesicCache ref;
+    double t0 = nowSeconds();
+    ref.update(p, 32, threads);
+    double fullMs = (nowSeconds() - t0) * 1000.0;
+    ref.shade(p, full);
+
+    printf("full trace        %8.2f ms\n", fullMs);
+    double totalMs = 0.0;
+    int frame = 0;
+    while (true) {
+        t0 = nowSeconds();
+        if (!cache.update(p, 32, threads)) break;
+        double ms = (nowSeconds() - t0) * 1000.0;
+        totalMs += ms;
+        cache.shade(p, rgb);
+        printf("frame %2d phase %2d %8.2f ms  mean abs error %.5f\n",
+               frame, cache.phase, ms, meanAbsError(rgb, full));
+        if (frame == 0 && !writePPM(out, rgb, w, h)) {
+            fprintf(stderr, "cannot write %s\n", out);
+            return 1;
+        }
+        ++frame;
+    }
+
+    float maxDiff = 0.0f;
+    for (size_t i = 0; i < n * 3; ++i) maxDiff = fmaxf(maxDiff, fabsf(full[i] - rgb[i]));
+    printf("%d frames, %.2f ms total; max diff vs full trace %.6f  %s\n",
+           frame, totalMs, maxDiff, maxDiff == 0.0f ? "OK" : "FAIL");
+    printf("wrote %s (first frame)\n", out);
+    return maxDiff == 0.0f ? 0 : 1;
+}
+
+// Poster still through the out-of-core renderer. A small frame is
+// checked byte for byte against the in-memory render first.
+static int cmdPoster(RayMarchParams p, int width, int height, const char* out,
+                     int tileSize, int threads, int packetWidth) {
+    vector<TileWorkerStats> workers;
+    StillStats st;
+
+    RayMarchParams small = p;
+    small.resolutionX = 320.0f;
+    small.resolutionY = 180.0f;
+    const size_t n = 320 * 180;
+    vector<float> rgb(n * 3);
+    renderTiledPacket<8>(small, rgb, 32, threads, workers);
+    string refPath  = string(out) + ".ref.ppm";
+    string tilePath = string(out) + ".tiled.ppm";
+    bool same = writePPM(refPath.c_str(), rgb, 320, 180) &&
+                renderStillPPM(small, tilePath.c_str(), tileSize, threads, workers, st, packetWidth);
+    same = same && sameFile(refPath.c_str(), tilePath.c_str());
+    remove(refPath.c_str());
+    remove(tilePath.c_str());
+    printf("320x180 tiled file vs in-memory render: %s\n", same ? "identical" : "DIFFERENT");
+    if (!same) return 1;
+
+    p.resolutionX = static_cast<float>(width);
+    p.resolutionY = static_cast<float>(height);
+    if (!renderStillPPM(p, out, tileSize, threads, workers, st, packetWidth)) {
+        fprintf(stderr, "cannot write %s\n", out);
+        return 1;
+    }
+
+    double frameMB = static_cast<double>(width) * height * 3 * sizeof(float) / (1024.0 * 1024.0);
+    printf("%dx%d in %d tiles of %d, %d threads, packet %d: %.2f s\n",
+           width, height, st.tiles, tileSize, threads, packetWidth, st.seconds);
+    printf("tile buffers %.2f MB (whole float frame would be %.1f MB)\n",
+           st.bufferBytes / (1024.0 * 1024.0), frameMB);
+    printUtilization(workers, st.seconds);
+    printf("wrote %s\n", out);
+    return 0;
+}
+
+#if BH_FARM
+static void printFarmStats(const FarmStats& st) {
+    printf("%d tiles in %.2f s; workers seen %d, lost %d (%d timed out), tiles reassigned %d\n",
+           st.tiles, st.seconds, st.workersSeen, st.workersLost, st.timedOut, st.reassigned);
+}
+
+static int cmdCoordinator(RayMarchParams p, int port, int width, int height,
+                          const char* out, int tileSize) {
+    p.resolutionX = static_cast<float>(width);
+    p.resolutionY = static_cast<float>(height);
+
+    int bound = 0;
+    int fd = farmListen(port, bound);
+    if (fd < 0) {
+        fprintf(stderr, "cannot listen on port %d\n", port);
+        return 1;
+    }
+    printf("coordinator on port %d: %dx%d, tiles of %d\n", bound, width, height, tileSize);
+
+    FarmStats st;
+    bool ok = runFarmCoordinator(p, fd, out, tileSize, st);
+    close(fd);
+    if (!ok) {
+        fprintf(stderr, "cannot write %s\n", out);
+        return 1;
+    }
+    printFarmStats(st);
+    printf("wrote %s\n", out);
+    return 0;
+}
+
+static int cmdWorker(const char* host, int port) {
+    int n = runFarmWorker(host, port, 0);
+    if (n < 0) {
+        fprintf(stderr, "no coordinator at %s:%d\n", host, port);
+        return 1;
+    }
+    printf("rendered %d tiles\n", n);
+    return 0;
+}
+
+// All on localhost: fork the workers, let worker 0 vanish after a few
+// tiles and worker 1 hang mid-tile, and check the result against the
+// single-process renderer
+static int cmdFarm(RayMarchParams p, int workerCount) {
+    p.resolutionX = 640.0f;
+    p.resolutionY = 360.0f;
+    const int tileSize = 32;
+    const char* out = "bh_farm.ppm";
+    const char* ref = "bh_farm_ref.ppm";
+
+    int port = 0;
+    int fd = farmListen(0, port);
+    if (fd < 0) {
+        fprintf(stderr, "cannot listen\n");
+        return 1;
+    }
+
+    vector<pid_t> kids;
+    for (int i = 0; i < workerCount; ++i) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fd);
+            int n = runFarmWorker("127.0.0.1", port, i == 0 ? 5 : 0, i == 1 ? 5 : 0);
+            _exit(n < 0 ? 1 : 0);
+        }
+        if (pid > 0) kids.push_back(pid);
+    }
+
+    // Tiles take milliseconds here, so a short deadline finds the hang
+    FarmStats st;
+    bool ok = runFarmCoordinator(p, fd, out, tileSize, st, 2.0);
+    close(fd);
+    for (pid_t pid : kids) waitpid(pid, nullptr, 0);
+    printFarmStats(st);
+
+    vector<TileWorkerStats> workers;
+    StillStats local;
+    ok = ok && renderStillPPM(p, ref, tileSize, 1, workers, local);
+    bool same = ok && sameFile(out, ref);
+    printf("local render %.2f s; farm file vs local render: %s\n",
+           local.seconds, same ? "identical" : "DIFFERENT");
+    remove(ref);
+    const bool lossSeen = st.workersLost > 0 && (workerCount < 2 || st.timedOut > 0);
+    return same && lossSeen ? 0 : 1;
+}
+#endif // BH_FARM
+
+static int cmdLut(const RayMarchParams& p, const char* out, int threads) {
+    const int w = static_cast<int>(p.resolutionX);
+    const int h = static_cast<int>(p.resolutionY);
+    vector<float> rgb(static_cast<size_t>(w) * h * 3);
+    vector<TileWorkerStats> stats;
+
+    SchwarzschildLut lut;
+    double t0 = nowSeconds();
+    ensureLut(lut, p);
+    double buildMs = (nowSeconds() - t0) * 1000.0;
+
+    double renderMs = renderTiledLut(p, lut, rgb, 32, threads, stats) * 1000.0;
+
+    // Lookups per pixel (one per disk-plane crossing visited)
+    RayFrame f = makeRayFrame(p);
+    double lookups = 0.0;
+    traceRectLut(p, f, lut, 0, 0, w, h,
+        [&](int, int, const RayResult& res) { lookups += res.steps; });
+
+    // Check the table against direct integration on a sparse grid
+    size_t checked = 0, typeMismatch = 0;
+    float maxRErr = 0.0f;
+    for (int y = 0; y < h; y += 7) {
+        for (int x = 0; x < w; x += 7) {
+            float fx = x + 0.5f, fy = h - y - 0.5f;
+            RayResult a = traceRayLut(p, f, lut, fx, fy);
+            RayResult b = traceRaySchwarzschildDirect(p, f, fx, fy);
+            ++checked;
+            if (a.hit != b.hit) ++typeMismatch;
+            else if (a.hit == RAY_DISK) maxRErr = fmaxf(maxRErr, fabsf(a.diskR - b.diskR));
+        }
+    }
+
+    printf("table build     %8.2f ms  (%d b x %d psi, %.1f MB)\n", buildMs, lut.nb, lut.npsi,
+           (lut.u.size() + lut.du.size() + lut.psiIn.size()) * 4.0 / (1 << 20));
+    printf("render          %8.2f ms  %.2f lookups/pixel\n", renderMs, lookups / (double(w) * h));
+    printf("vs direct Binet: %zu / %zu hit-type mismatches, max diskR error %.4f\n",
+           typeMismatch, checked, maxRErr);
+
+    if (!writePPM(out, rgb, w, h)) {
+        fprintf(stderr, "cannot write %s\n", out);
+        return 1;
+    }
+    printf("wrote %s\n", out);
+
+    bool ok = typeMismatch <= checked / 100 && maxRErr < 0.05f;
+    return ok ? 0 : 1;
+}
+
+// Single-threaded rays/sec over a strided subset of the frame
+template <class TraceFn>
+static double raysPerSecond(const RayMarchParams& p, TraceFn trace, double& stepsPerRay) {
+    const int w = static_cast<int>(p.resolutionX);
+    const int h = static_cast<int>(p.resolutionY);
+    double steps = 0.0;
+    size_t rays = 0;
+
+    double t0 = nowSeconds();
+    for (int y = 0; y < h; y += 4) {
+        for (int x = 0; x < w; x += 4) {
+            steps += trace(x + 0.5f, h - y - 0.5f).steps;
+            ++rays;
+        }
+    }
+    double dt = nowSeconds() - t0;
+    stepsPerRay = steps / rays;
+    return rays / dt;
+}
+
+static int cmdKerr(RayMarchParams p, float spin, const char* out, int threads) {
+    RayFrame f = makeRayFrame(p);
+    double spr = 0.0;
+
+    p.stepTolerance = 0.0f;
+    double fixedRps = raysPerSecond(p, [&](float x, float y) { return traceRayReference(p, f, x, y); }, spr);
+    printf("1/r^2 march, fixed step   %8.3f Mrays/s  %6.1f steps/ray\n", fixedRps * 1e-6, spr);
+
+    p.stepTolerance = 0.01f;
+    double adaptRps = raysPerSecond(p, [&](float x, float y) { return traceRayReference(p, f, x, y); }, spr);
+    printf("1/r^2 march, adaptive     %8.3f Mrays/s  %6.1f steps/ray\n", adaptRps * 1e-6, spr);
+
+    const float spins[] = { 0.0f, spin };
+    for (float a : spins) {
+        p.spin = a;
+        double rps = raysPerSecond(p, [&](float x, float y) { return traceRayKerr(p, f, x, y); }, spr);
+        printf("Kerr a/M = %.2f            %8.3f Mrays/s  %6.1f steps/ray  (%.1fx march cost)\n",
+               a, rps * 1e-6, spr, fixedRps / rps);
+    }
+
+    // spin 0 must agree with the Schwarzschild table
+    p.spin = 0.0f;
+    SchwarzschildLut lut;
+    ensureLut(lut, p);
+    const int w = static_cast<int>(p.resolutionX);
+    const int h = static_cast<int>(p.resolutionY);
+    size_t checked = 0, mismatch = 0;
+    for (int y = 0; y < h; y += 9) {
+        for (int x = 0; x < w; x += 9) {
+            RayResult a = traceRayKerr(p, f, x + 0.5f, h - y - 0.5f);
+            RayResult b = traceRayLut(p, f, lut, x + 0.5f, h - y - 0.5f);
+            ++checked;
+            if (a.hit != b.hit || (a.hit == RAY_DISK && fabsf(a.diskR - b.diskR) > 0.05f)) ++mismatch;
+        }
+    }
+    printf("Kerr a=0 vs Schwarzschild table: %zu / %zu rays differ\n", mismatch, checked);
+
+    p.spin = spin;
+    vector<float> rgb(static_cast<size_t>(w) * h * 3);
+    vector<TileWorkerStats> stats;
+    double ms = renderTiledKerr(p, rgb, 32, threads, stats) * 1000.0;
+    printf("Kerr frame (%d threads) %8.2f ms\n", threads, ms);
+    if (!writePPM(out, rgb, w, h)) {
+        fprintf(stderr, "cannot write %s\n", out);
+        return 1;
+    }
+    printf("wrote %s\n", out);
+    return mismatch <= checked / 50 ? 0 : 1;
+}
+
+// ----------------------
+// Main
+// ----------------------
+int main(int argc, char** argv) {
+    RayMarchParams params;
+    params.time = 0.0f;
+
+    string mode = argc > 1 ? argv[1] : "render";
+
+    if (mode == "render") {
+        const char* out = argc > 2 ? argv[2] : "bh_cpu.ppm";
+        int width = argc > 3 ? atoi(argv[3]) : 8;
+        return cmdRender(params, out, width);
+    }
+    if (mode == "verify") return cmdVerify(params);
+    if (mode == "bench")  return cmdBench(params);
+    if (mode == "tiles") {
+        int hw = static_cast<int>(thread::hardware_concurrency());
+        int threads = argc > 2 ? atoi(argv[2]) : (hw > 0 ? hw : 4);
+        int tileSize = argc > 3 ? atoi(argv[3]) : 32;
+        return cmdTiles(params, threads, tileSize);
+    }
+    if (mode == "steps") return cmdSteps(params);
+    if (mode == "skip")  return cmdSkip(params);
+    if (mode == "tiers") return cmdTiers(params);
+    if (mode == "galaxy") return cmdGalaxy(argc > 2 ? argv[2] : "galaxy_diag");
+    if (mode == "galaxy3d") {
+        float tilt = argc > 3 ? static_cast<float>(atof(argv[3])) : 70.0f;
+        return cmdGalaxy3D(argc > 2 ? argv[2] : "galaxy3d.ppm", tilt);
+    }
+    if (mode == "tune") {
+        GeodesicTracer tracer = TRACE_MARCH;
+        bool force = false, splat = false;
+        int stars = 100000;
+        for (int i = 2; i < argc; ++i) {
+            string a = argv[i];
+            if (a == "force")      force  = true;
+            else if (a == "lut")   tracer = TRACE_SCHWARZSCHILD_LUT;
+            else if (a == "kerr")  tracer = TRACE_KERR;
+            else if (a == "splat") splat  = true;
+            else if (atoi(a.c_str()) > 0) stars = atoi(a.c_str());
+        }
+        return splat ? cmdTuneSplat(stars, force) : cmdTune(params, tracer, force);
+    }
+    if (mode == "quality") {
+        int hw = static_cast<int>(thread::hardware_concurrency());
+        return cmdQuality(params, hw > 0 ? hw : 4, argc > 2 ? argv[2] : "quality_log.csv");
+    }
+    if (mode == "counters") {
+        int hw = static_cast<int>(thread::hardware_concurrency());
+        return cmdCounters(argc > 2 ? atoi(argv[2]) : 200000, argc > 3 ? atoi(argv[3]) : 100,
+                           hw > 0 ? hw : 4);
+    }
+    if (mode == "regress") {
+        return cmdRegress(argc > 2 ? argv[2] : "goldens",
+                          argc > 3 && string(argv[3]) == "update");
+    }
+    if (mode == "raystats") {
+        int hw = static_cast<int>(thread::hardware_concurrency());
+        return cmdRayStats(params, argc > 2 ? argv[2] : "bh_steps.ppm", hw > 0 ? hw : 4);
+    }
+    if (mode == "profile") {
+        int hw = static_cast<int>(thread::hardware_concurrency());
+        int threads = argc > 3 ? atoi(argv[3]) : (hw > 0 ? hw : 4);
+        return cmdProfile(params, argc > 2 ? argv[2] : "bh_trace.json", threads);
+    }
+    if (mode == "aa") {
+        int hw = static_cast<int>(thread::hardware_concurrency());
+        int budget = argc > 2 ? atoi(argv[2]) : 100000;
+        int spp    = argc > 3 ? atoi(argv[3]) : 4;
+        return cmdAA(params, budget, spp, argc > 4 ? argv[4] : "bh_aa.ppm", hw > 0 ? hw : 4);
+    }
+    if (mode == "progressive") {
+        int hw = static_cast<int>(thread::hardware_concurrency());
+        return cmdProgressive(params, argc > 2 ? argv[2] : "bh_progressive.ppm", hw > 0 ? hw : 4);
+    }
+    if (mode == "poster") {
+        TunedSettings tuned = loadOrTuneRayMarch(".", params, TRACE_MARCH, false, true);
+        int width  = argc > 2 ? atoi(argv[2]) : 7680;
+        int height = argc > 3 ? atoi(argv[3]) : 4320;
+        int tile   = argc > 5 ? atoi(argv[5]) : tuned.tileSize;
+        return cmdPoster(params, width, height, argc > 4 ? argv[4] : "bh_poster.ppm",
+                         tile, tuned.threads, tuned.packetWidth);
+    }
+#if BH_FARM
+    if (mode == "coordinator") {
+        int port   = argc > 2 ? atoi(argv[2]) : 5555;
+        int width  = argc > 3 ? atoi(argv[3]) : 7680;
+        int height = argc > 4 ? atoi(argv[4]) : 4320;
+        int tile   = argc > 6 ? atoi(argv[6]) : 64;
+        return cmdCoordinator(params, port, width, height,
+                              argc > 5 ? argv[5] : "bh_farm.ppm", tile);
+    }
+    if (mode == "worker") {
+        return cmdWorker(argc > 2 ? argv[2] : "127.0.0.1", argc > 3 ? atoi(argv[3]) : 5555);
+    }
+    if (mode == "farm") return cmdFarm(params, argc > 2 ? atoi(argv[2]) : 3);
+#endif
+    if (mode == "volume") {
+        int hw = static_cast<int>(thread::hardware_concurrency());
+        return cmdVolume(params, argc > 2 ? argv[2] : "bh_volume.ppm", hw > 0 ? hw : 4);
+    }
+    if (mode == "kerr") {
+        int hw = static_cast<int>(thread::hardware_concurrency());
+        float spin = argc > 2 ? static_cast<float>(atof(argv[2])) : 0.9f;
+        return cmdKerr(params, spin, argc > 3 ? argv[3] : "bh_kerr.ppm", hw > 0 ? hw : 4);
+    }
+    if (mode == "lut") {
+        int hw = static_cast<int>(thread::hardware_concurrency());
+        return cmdLut(params, argc > 2 ? argv[2] : "bh_lut.ppm", hw > 0 ? hw : 4);
+    }
+    if (mode == "gbuffer") {
+        int hw = static_cast<int>(thread::hardware_concurrency());
+        return cmdGBuffer(params, hw > 0 ? hw : 4);
+    }
+
+    fprintf(stderr, "usage: %s render [out.ppm] [1|8|16] | verify | bench | tiles [threads] [tile] | gbuffer | steps | raystats [out.ppm] | galaxy [csv prefix] | galaxy3d [out.ppm] [tilt] | counters [stars] [steps] | tune [march|lut|kerr] [force] | quality [log.csv] | regress [dir] [update] | tiers | profile [out.json] [threads] | lut [out.ppm] | kerr [spin] [out.ppm] | skip | volume [out.ppm] | aa [budget] [spp] [out.ppm] | progressive [out.ppm] | poster [w] [h] [out.ppm] [tile] | coordinator [port] [w] [h] [out.ppm] [tile] | worker [host] [port] | farm [workers]\n", argv[0]);
+    return 1;
+}
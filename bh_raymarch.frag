@@ -3,6 +3,43 @@
 // Ray-marched with simple GR-like bending
 // ============================================
 
+// Variant defines (shader_variants.hpp injects them at load time;
+// the defaults below are the medium tier = the old hard-coded values).
+// A model of -1 reads the uniform; 0 / 1 pins it, and the compiler
+// folds away the branches the variant can't take.
+#ifndef BH_MAX_STEPS
+#define BH_MAX_STEPS 140
+#endif
+#ifndef BH_MAX_DIST
+#define BH_MAX_DIST 80.0
+#endif
+#ifndef BH_STEP_MODE
+#define BH_STEP_MODE -1      // -1 = uStepTolerance decides, 0 = fixed, 1 = adaptive
+#endif
+#ifndef BH_DISK_MODEL
+#define BH_DISK_MODEL -1
+#endif
+#ifndef BH_BENDING_MODEL
+#define BH_BENDING_MODEL -1
+#endif
+#ifndef BH_EDGE_AA
+#define BH_EDGE_AA 1         // 0 compiles out the edge supersampling pass
+#endif
+#ifndef BH_DEBUG_STATS
+#define BH_DEBUG_STATS 0     // 1 = write steps + exit reason (ray_stats.hpp)
+#endif
+
+#if BH_DISK_MODEL < 0
+#define DISK_MODEL uDiskModel
+#else
+#define DISK_MODEL BH_DISK_MODEL
+#endif
+#if BH_BENDING_MODEL < 0
+#define BENDING_MODEL uBendingModel
+#else
+#define BENDING_MODEL BH_BENDING_MODEL
+#endif
+
 uniform vec2  uResolution;     // window size in pixels
 uniform float uTime;           // seconds since start
 
@@ -15,8 +52,13 @@ uniform float uFovFactor;
 uniform float uBhRadius;
 uniform float uDiskInner;
 uniform float uDiskOuter;
+uniform float uDiskHeight;
 uniform float uDiskRotation;
 
+// Disk model: 0 = thin plane, 1 = volumetric slab of height uDiskHeight
+// (emission + absorption, 1/r^2 bending model only)
+uniform int   uDiskModel;
+
 // Tilt (same as before)
 uniform float uDiskTilt;
 
@@ -24,9 +66,379 @@ uniform float uDiskTilt;
 uniform float uGravStrength;
 uniform float uStepSize;
 
+// Adaptive step: > 0 replaces uStepSize with a curvature-scaled step
+// that bends the ray by about uStepTolerance radians per step
+uniform float uStepTolerance;
+
+// Sphere of influence: > 0 moves the camera ray onto it in closed form
+// and stops rays that leave it moving outward (derivation next to
+// influenceRadius() in bh_raymarch_cpu.hpp)
+uniform float uInfluenceRadius;
+
+// Bending model: 0 = 1/r^2 pull above, 1 = Kerr geodesics (true GR,
+// mass uBhRadius / 2, spin a/M = uSpin about the disk normal)
+uniform int   uBendingModel;
+uniform float uSpin;
+
 // Colors
 uniform vec3  uDiskColorBase;
 
+// Geodesic G-buffer pass: write packed (disk angle, static brightness)
+// instead of a color; bh_shade.frag adds the time-dependent band
+uniform bool  uWriteGBuffer;
+
+// Edge-driven supersampling, two passes over the same shader:
+//   1: color + edge key in alpha (BlendNone into uFirstPass)
+//   2: copy uFirstPass, but pixels whose key jumps against a neighbour
+//      by more than uEdgeThreshold re-trace uEdgeSamples sub-pixel rays
+// Key: 0 = hole / background, 0.2..1 = disk by diskR (or opacity)
+uniform int       uEdgeAAPass;
+uniform sampler2D uFirstPass;
+uniform int       uEdgeSamples;      // 1..8 extra rays per edge pixel
+uniform float     uEdgeThreshold;
+
+// Progressive refinement (progressive_refine.hpp), G-buffer path only:
+//   1: coarse, into a ceil(res / 4) target; each fragment traces the
+//      phase-0 pixel of its 4x4 block
+//   2: fill, copies uCoarse over every block
+//   3: refine, traces the pixels of phase uProgressPhase and discards
+//      the rest so the target keeps them
+uniform int       uProgressPass;
+uniform int       uProgressPhase;
+uniform sampler2D uCoarse;
+
+const float PI = 3.14159265;
+
+#if BH_DEBUG_STATS
+// Set by tracePixel: loop iterations and RayExit code
+// (bh_raymarch_cpu.hpp: 1 horizon, 2 disk, 3 escape, 4 left
+// influence, 5 missed influence, 6 step cap)
+int   dbgSteps;
+float dbgExit;
+#endif
+
+// [0,1] -> two 8-bit channels (16-bit fixed point)
+vec2 packUnit16(float v) {
+    float q  = floor(clamp(v, 0.0, 1.0) * 65535.0 + 0.5);
+    float hi = floor(q / 256.0);
+    float lo = q - hi * 256.0;
+    return vec2(hi, lo) / 255.0;
+}
+
+// ----------------------
+// Step size (fixed or adaptive)
+// h = tol * r^2 / g keeps |acc| * h ~ tol; capped at half the gap to
+// the horizon so a ray can't jump across the capture sphere
+// ----------------------
+const float MIN_STEP = 0.02;
+const float MAX_STEP = 2.0;
+const float DEFAULT_TOLERANCE = 0.01;   // RAY_DEFAULT_TOLERANCE
+
+float rayStepSize(float r) {
+#if BH_STEP_MODE == 0
+    return uStepSize;
+#else
+    float tol = uStepTolerance;
+#if BH_STEP_MODE < 0
+    if (tol <= 0.0) {
+        return uStepSize;
+    }
+#else
+    // Pinned adaptive: scenes set up with a fixed step get the default
+    tol = tol > 0.0 ? tol : DEFAULT_TOLERANCE;
+#endif
+    float h = tol * r * r / max(uGravStrength, 1e-6);
+    h = min(h, max(0.5 * (r - uBhRadius), MIN_STEP));
+    return clamp(h, MIN_STEP, MAX_STEP);
+#endif
+}
+
+// ----------------------
+// Sphere of influence
+// ----------------------
+float influenceRadius() {
+    if (uInfluenceRadius <= 0.0) {
+        return 0.0;
+    }
+    float halfH = DISK_MODEL == 1 ? 0.5 * uDiskHeight : 0.0;
+    float disk = sqrt(uDiskOuter * uDiskOuter + halfH * halfH);
+    return max(max(uInfluenceRadius, uGravStrength), max(disk, uBhRadius));
+}
+
+// Move (pos, dir) onto the sphere of radius R along the bent path:
+// L = |pos x dir| = C exp(-g / r), dphi = L du / sqrt(1 - L^2 u^2).
+// false if the ray turns back (or heads away) outside R
+const int INFLUENCE_QUAD = 12;
+
+bool enterInfluenceSphere(inout vec3 pos, inout vec3 dir, float R) {
+    float r0 = length(pos);
+    if (r0 <= R) {
+        return true;
+    }
+    float radial = dot(pos, dir);
+    if (radial >= 0.0) {
+        return false;
+    }
+
+    float g  = uGravStrength;
+    vec3  e1 = pos / r0;
+    vec3  t  = dir - e1 * (radial / r0);
+    float L0 = length(t) * r0;
+    float uR = 1.0 / R, u0 = 1.0 / r0;
+    float C  = L0 * exp(g * u0);
+    float LR = C * exp(-g * uR);
+    if (LR >= R) {
+        return false;
+    }
+
+    float phi = 0.0;
+    for (int k = 0; k < INFLUENCE_QUAD; ++k) {
+        float sk = (float(k) + 0.5) / float(INFLUENCE_QUAD);
+        float u  = uR - (uR - u0) * sk * sk;
+        float L  = C * exp(-g * u);
+        phi += L / sqrt(max(1.0 - L * L * u * u, 1e-12)) * 2.0 * (uR - u0) * sk;
+    }
+    phi /= float(INFLUENCE_QUAD);
+
+    vec3  e2 = L0 > 1e-6 * r0 ? t * (r0 / L0) : vec3(0.0);
+    vec3  er = e1 * cos(phi) + e2 * sin(phi);
+    vec3  ep = e2 * cos(phi) - e1 * sin(phi);
+    float sinPsi = LR / R;
+
+    pos = er * R;
+    dir = normalize(ep * sinPsi - er * sqrt(1.0 - sinPsi * sinPsi));
+    return true;
+}
+
+// ----------------------
+// Volumetric disk (port of volume_disk.hpp)
+// Gaussian vertical profile (sigma = H/4), absorption scaled so a
+// vertical pass has optical depth VOL_TAU; source = thin-disk color
+// ----------------------
+const float VOL_SAMPLE_STEP  = 0.05;
+const int   VOL_MAX_SAMPLES  = 48;
+const float VOL_TAU          = 2.5;
+const float VOL_MIN_TRANSMIT = 0.01;
+
+// Thin-disk color at disk-plane coords (x, z) seen along dir
+vec3 diskEmission(float rDisk, float x, float z, vec3 dir, vec3 diskX, vec3 diskZ) {
+    float tRad = (rDisk - uDiskInner) / (uDiskOuter - uDiskInner);
+    float radialBright = clamp(1.5 - tRad * 1.2, 0.0, 1.0);
+
+    vec3 tangent = normalize(-z * diskX + x * diskZ);
+    float dopplerBoost = 1.0 + 0.8 * dot(-dir, tangent);
+
+    float band = 0.3 + 0.7 * sin((atan(z, x) + uDiskRotation * uTime) * 4.0);
+    return uDiskColorBase * (radialBright * dopplerBoost * (0.6 + 0.4 * band));
+}
+
+// Overlap [t0, t1] of segment a -> b with the slab and outer cylinder
+bool clipSegmentToDisk(vec3 a, vec3 b, vec3 n, vec3 diskX, vec3 diskZ,
+                       out float t0, out float t1) {
+    float halfH = 0.5 * uDiskHeight;
+    t0 = 0.0;
+    t1 = 1.0;
+
+    float da = dot(a, n);
+    float dd = dot(b, n) - da;
+    if (abs(dd) < 1e-9) {
+        if (abs(da) >= halfH) return false;
+    } else {
+        float ta = (-halfH - da) / dd;
+        float tb = ( halfH - da) / dd;
+        t0 = max(t0, min(ta, tb));
+        t1 = min(t1, max(ta, tb));
+        if (t0 >= t1) return false;
+    }
+
+    vec2 q = vec2(dot(a, diskX), dot(a, diskZ));
+    vec2 v = vec2(dot(b, diskX), dot(b, diskZ)) - q;
+    float A = dot(v, v);
+    float B = dot(q, v);
+    float C = dot(q, q) - uDiskOuter * uDiskOuter;
+    if (A < 1e-12) return C < 0.0;
+    float disc = B * B - A * C;
+    if (disc <= 0.0) return false;
+    float sq = sqrt(disc);
+    t0 = max(t0, (-B - sq) / A);
+    t1 = min(t1, (-B + sq) / A);
+    return t0 < t1;
+}
+
+// Front-to-back emission / absorption along the clipped segment
+void integrateSegment(vec3 a, vec3 dir, float len, float t0, float t1,
+                      vec3 n, vec3 diskX, vec3 diskZ,
+                      inout vec3 volColor, inout float transmit) {
+    float sigma = 0.25 * uDiskHeight;
+    float kappa = VOL_TAU / (sigma * 2.5066283);
+
+    float span = (t1 - t0) * len;
+    int   ns   = int(clamp(ceil(span / VOL_SAMPLE_STEP), 1.0, float(VOL_MAX_SAMPLES)));
+    float ds   = span / float(ns);
+
+    for (int k = 0; k < VOL_MAX_SAMPLES; ++k) {
+        if (k >= ns || transmit < VOL_MIN_TRANSMIT) break;
+
+        vec3 hp = a + dir * (len * t0 + ds * (float(k) + 0.5));
+        float x = dot(hp, diskX);
+        float z = dot(hp, diskZ);
+        float rDisk = length(vec2(x, z));
+        if (rDisk <= uDiskInner || rDisk >= uDiskOuter) continue;
+
+        float y = dot(hp, n) / sigma;
+        float alpha = 1.0 - exp(-kappa * exp(-0.5 * y * y) * ds);
+
+        volColor += diskEmission(rDisk, x, z, dir, diskX, diskZ) * (transmit * alpha);
+        transmit *= 1.0 - alpha;
+    }
+}
+
+// ----------------------
+// Kerr geodesics (port of kerr_geodesic.hpp)
+// Carter-separated equations in Mino time, second-order form:
+// state (r, theta, r', theta') + phi, constants xi = L/E, eta = Q/E^2
+// ----------------------
+const int   KERR_MAX_STEPS = 300;
+const float KERR_MIN_STEP  = 0.02;
+const float KERR_MAX_STEP  = 2.0;
+const float KERR_MAX_ANGLE = 0.1;
+
+// d/dlambda of (r, theta, r', theta'); dPhi gets dphi/dlambda
+vec4 kerrDeriv(float M, float a, float xi, float eta, vec4 s, out float dPhi) {
+    float st = sin(s.y), ct = cos(s.y);
+    if (abs(st) < 1e-4) st = st < 0.0 ? -1e-4 : 1e-4;
+
+    float delta = s.x * s.x - 2.0 * M * s.x + a * a;
+    float P = s.x * s.x + a * a - a * xi;
+    float K = eta + (xi - a) * (xi - a);
+
+    dPhi = a / delta * P - a + xi / (st * st);
+    return vec4(s.z, s.w,
+                2.0 * s.x * P - (s.x - M) * K,
+                -a * a * st * ct + xi * xi * ct / (st * st * st));
+}
+
+void kerrRK4(float M, float a, float xi, float eta, inout vec4 s, inout float ph, float h) {
+    float p1, p2, p3, p4;
+    vec4 k1 = kerrDeriv(M, a, xi, eta, s, p1);
+    vec4 k2 = kerrDeriv(M, a, xi, eta, s + 0.5 * h * k1, p2);
+    vec4 k3 = kerrDeriv(M, a, xi, eta, s + 0.5 * h * k2, p3);
+    vec4 k4 = kerrDeriv(M, a, xi, eta, s + h * k3, p4);
+    s  += h / 6.0 * (k1 + 2.0 * k2 + 2.0 * k3 + k4);
+    ph += h / 6.0 * (p1 + 2.0 * p2 + 2.0 * p3 + p4);
+}
+
+// Boyer-Lindquist -> disk-frame Cartesian (oblate spheroidal embedding)
+vec3 kerrFromBL(float a, float r, float th, float ph) {
+    float rho = sqrt(r * r + a * a);
+    return vec3(rho * sin(th) * cos(ph), rho * sin(th) * sin(ph), r * cos(th));
+}
+
+// c, d: camera position / ray direction in the disk frame (x, z, normal).
+// Returns 0 = escaped, 1 = horizon, 2 = disk (diskR/Xc/Zc, dir filled)
+int traceKerr(vec3 c, vec3 d, out float diskR, out float diskXc, out float diskZc,
+              out vec3 stepDir) {
+    float M  = 0.5 * uBhRadius;
+    float a  = uSpin * M;
+    float rH = M + sqrt(max(M * M - a * a, 0.0));
+
+    diskR = 0.0; diskXc = 0.0; diskZc = 0.0;
+    stepDir = d;
+
+    // Camera position in BL coordinates
+    float R2 = dot(c, c);
+    float w  = R2 - a * a;
+    float r  = sqrt(max(0.5 * (w + sqrt(w * w + 4.0 * a * a * c.z * c.z)), 1e-6));
+    float th = acos(clamp(c.z / r, -1.0, 1.0));
+    float ph = atan(c.y, c.x);
+
+    // Direction seen by a zero angular momentum observer
+    float st = max(sin(th), 1e-4), ct = cos(th);
+    float sp = sin(ph), cp = cos(ph);
+    float rho = sqrt(r * r + a * a);
+
+    vec3 er = vec3(r / rho * st * cp, r / rho * st * sp, ct);
+    vec3 et = vec3(rho * ct * cp, rho * ct * sp, -r * st);
+    vec3 ep = vec3(-sp, cp, 0.0);
+
+    float nr  = dot(d, er) / length(er);
+    float nth = dot(d, et) / length(et);
+    float nph = dot(d, ep);
+
+    float sig   = r * r + a * a * ct * ct;
+    float delta = r * r - 2.0 * M * r + a * a;
+    float A     = (r * r + a * a) * (r * r + a * a) - a * a * delta * st * st;
+    float alpha = sqrt(sig * delta / A);
+    float omega = 2.0 * M * a * r / A;
+    float varpi = sqrt(A / sig) * st;
+
+    float pR  = sqrt(sig / delta) * nr;
+    float pTh = sqrt(sig) * nth;
+    float pPh = varpi * nph;
+    float E   = alpha + omega * pPh;
+
+    float xi  = pPh / E;
+    float eta = (pTh / E) * (pTh / E) + ct * ct * (xi * xi / (st * st) - a * a);
+    vec4 s = vec4(r, th, delta * pR / E, pTh / E);
+
+    // Outgoing rays can't turn back outside the photon region (r <= 4M)
+    float rInf    = influenceRadius();
+    float escapeR = rInf > 0.0 ? max(4.0 * M, rInf) : 80.0;
+
+    for (int i = 0; i < KERR_MAX_STEPS; ++i) {
+        if (s.x < rH * 1.01) {
+            return 1;
+        }
+        if (s.x > escapeR && s.z > 0.0) {
+            return 0;
+        }
+
+        float len = clamp(0.1 * (s.x - rH), KERR_MIN_STEP, KERR_MAX_STEP);
+        float h = len / (s.x * s.x + a * a * cos(s.y) * cos(s.y));
+
+        // Cap the angular change per step near the spin axis
+        float dPh0;
+        vec4 d0 = kerrDeriv(M, a, xi, eta, s, dPh0);
+        h = min(h, KERR_MAX_ANGLE / max(max(abs(dPh0), abs(d0.y)), 1e-12));
+        h = min(h, sqrt(KERR_MAX_ANGLE / max(abs(d0.w), 1e-12)));
+
+        vec4  prev   = s;
+        float prevPh = ph;
+        for (int retry = 0; retry < 8; ++retry) {
+            s  = prev;
+            ph = prevPh;
+            kerrRK4(M, a, xi, eta, s, ph, h);
+            if (abs(s.y - prev.y) < 2.0 * KERR_MAX_ANGLE &&
+                abs(ph - prevPh) < 4.0 * KERR_MAX_ANGLE) break;
+            h *= 0.25;
+        }
+
+        // Keep theta' on the first integral (axis crossings kick it off)
+        float c1s = cos(s.y), s1s = sin(s.y);
+        float Th = eta + c1s * c1s * (a * a - xi * xi / max(s1s * s1s, 1e-8));
+        if (Th > 0.0) s.w = (s.w < 0.0 ? -1.0 : 1.0) * sqrt(Th);
+
+        // Disk = equatorial plane, theta = pi/2
+        float c0 = cos(prev.y), c1 = cos(s.y);
+        if ((c0 > 0.0 && c1 <= 0.0) || (c0 < 0.0 && c1 >= 0.0)) {
+            float t  = c0 / (c0 - c1);
+            float rr = mix(prev.x, s.x, t);
+            float pp = mix(prevPh, ph, t);
+
+            if (rr > uDiskInner && rr < uDiskOuter) {
+                float rrho = sqrt(rr * rr + a * a);
+                diskR   = rr;
+                diskXc  = rrho * cos(pp);
+                diskZc  = rrho * sin(pp);
+                stepDir = normalize(kerrFromBL(a, s.x, s.y, ph) -
+                                    kerrFromBL(a, prev.x, prev.y, prevPh));
+                return 2;
+            }
+        }
+    }
+    return 0;
+}
+
 // ----------------------
 // Build camera ray
 // ----------------------
@@ -46,9 +458,11 @@ vec3 makeRayDirection(vec2 fragCoord) {
     return dir;
 }
 
-void main() {
-    vec2 frag = gl_FragCoord.xy;
-
+// ----------------------
+// One camera ray through frag: vec4(color, edge key), or the packed
+// G-buffer texel when uWriteGBuffer is set
+// ----------------------
+vec4 tracePixel(vec2 frag) {
     // 1) Camera ray
     vec3 ro = uCamPos;
     vec3 rd0 = makeRayDirection(frag);
@@ -70,6 +484,10 @@ void main() {
     vec3 pos = ro;
     vec3 dir = rd0;
 
+    // (the closed form is for the 1/r^2 pull; Kerr has its own exit)
+    float rInf   = influenceRadius();
+    bool  inside = BENDING_MODEL == 1 || rInf <= 0.0 || enterInfluenceSphere(pos, dir, rInf);
+
     bool hitBH   = false;
     bool hitDisk = false;
 
@@ -78,32 +496,84 @@ void main() {
     float diskXc    = 0.0;
     float diskZc    = 0.0;
 
-    float maxDist = 80.0;
-    float stepSize = uStepSize;
+    // Volumetric disk accumulation (DISK_MODEL = 1)
+    vec3  volColor = vec3(0.0);
+    float transmit = 1.0;
 
     // Signed distance to disk plane at current pos
     float dPlane = dot(pos, diskNormal);
 
-    const int MAX_STEPS = 140;
-    for (int i = 0; i < MAX_STEPS; ++i) {
+    if (BENDING_MODEL == 1) {
+        vec3 kDir;
+        int kHit = traceKerr(vec3(dot(ro, diskX), dot(ro, diskZ), dot(ro, diskNormal)),
+                             vec3(dot(rd0, diskX), dot(rd0, diskZ), dot(rd0, diskNormal)),
+                             diskR, diskXc, diskZc, kDir);
+        hitBH   = kHit == 1;
+        hitDisk = kHit == 2;
+        dir     = kDir.x * diskX + kDir.y * diskZ + kDir.z * diskNormal;
+#if BH_DEBUG_STATS
+        dbgExit = hitBH ? 1.0 : (hitDisk ? 2.0 : 3.0);
+#endif
+    }
+#if BH_DEBUG_STATS
+    if (!inside) {
+        dbgSteps = 1;
+        dbgExit  = 5.0;
+    }
+#endif
+    for (int i = 0; i < BH_MAX_STEPS && BENDING_MODEL != 1 && inside; ++i) {
         float r = length(pos);
+#if BH_DEBUG_STATS
+        dbgSteps = i + 1;
+        dbgExit  = i + 1 == BH_MAX_STEPS ? 6.0 : 0.0;
+#endif
 
         // Black hole capture
         if (r < uBhRadius) {
             hitBH = true;
+#if BH_DEBUG_STATS
+            dbgExit = 1.0;
+#endif
             break;
         }
 
         // Early exit if we flew far away
-        if (r > maxDist) {
+        if (r > BH_MAX_DIST) {
+#if BH_DEBUG_STATS
+            dbgExit = 3.0;
+#endif
             break;
         }
 
+        // ... or are leaving the sphere of influence for good
+        if (rInf > 0.0 && r > rInf && dot(pos, dir) > 0.0) {
+#if BH_DEBUG_STATS
+            dbgExit = 4.0;
+#endif
+            break;
+        }
+
+        float stepSize = rayStepSize(r);
+
         // Check if we cross the disk plane in this step
         vec3 nextPos = pos + dir * stepSize;
         float dNext = dot(nextPos, diskNormal);
 
-        if ((dPlane > 0.0 && dNext <= 0.0) || (dPlane < 0.0 && dNext >= 0.0)) {
+        if (DISK_MODEL == 1) {
+            // Empty-space skipping: fine samples only where this segment
+            // overlaps the slab; stop once the disk is opaque
+            float t0, t1;
+            if (clipSegmentToDisk(pos, nextPos, diskNormal, diskX, diskZ, t0, t1)) {
+                integrateSegment(pos, dir, stepSize, t0, t1, diskNormal, diskX, diskZ,
+                                 volColor, transmit);
+                if (transmit < VOL_MIN_TRANSMIT) {
+#if BH_DEBUG_STATS
+                    dbgExit = 2.0;
+#endif
+                    break;
+                }
+            }
+        } else if ((dPlane > 0.0 && dNext <= 0.0) || (dPlane < 0.0 && dNext >= 0.0)) {
             // We crossed the plane between pos and nextPos
             float frac = dPlane / (dPlane - dNext); // 0..1
             vec3 hp = pos + dir * (stepSize * frac);
@@ -118,6 +588,9 @@ void main() {
                 diskR      = rDisk;
                 diskXc     = x;
                 diskZc     = z;
+#if BH_DEBUG_STATS
+                dbgExit = 2.0;
+#endif
                 break;
             }
         }
@@ -137,10 +610,14 @@ void main() {
 
     vec3 color = vec3(0.0); // background / hole
 
+    // Time-independent part of the shading (for the G-buffer pass)
+    float angle      = 0.0;
+    float baseBright = 0.0;
+
     // ====== DISK SHADING (if hit) ======
     if (hitDisk) {
         // diskHitPos, diskR, diskXc, diskZc are already computed
-        float angle = atan(diskZc, diskXc);
+        angle = atan(diskZc, diskXc);
         float spin  = angle + uDiskRotation * uTime;
 
         float tRad = (diskR - uDiskInner) / (uDiskOuter - uDiskInner);
@@ -154,6 +631,7 @@ void main() {
         float dopplerBoost = 1.0 + 0.8 * doppler;
 
         float brightness = radialBright * dopplerBoost;
+        baseBright = brightness;
 
         float band = 0.3 + 0.7 * sin(spin * 4.0);
         brightness *= 0.6 + 0.4 * band;
@@ -166,7 +644,109 @@ void main() {
     }
     // else: stays background black
 
-    gl_FragColor = vec4(color, 1.0);
+    // Volumetric disk: whatever the slab emitted in front of hole / background
+    if (DISK_MODEL == 1 && BENDING_MODEL != 1) {
+        color = volColor;
+    }
+
+    if (uWriteGBuffer) {
+        // brightness <= 1.0 * 1.8, so /2 keeps it in [0,1]
+        return vec4(packUnit16((angle + PI) / (2.0 * PI)),
+                    packUnit16(baseBright * 0.5));
+    }
+
+    float key = 0.0;
+    if (DISK_MODEL == 1 && BENDING_MODEL != 1) {
+        key = transmit < 1.0 ? 0.2 + 0.8 * (1.0 - transmit) : 0.0;
+    } else if (hitDisk) {
+        key = 0.2 + 0.8 * clamp((diskR - uDiskInner) / (uDiskOuter - uDiskInner), 0.0, 1.0);
+    }
+    return vec4(color, key);
+}
+
+// Same sub-pixel offsets as EDGE_AA_OFFSETS in edge_supersample.hpp
+// (x right, y down within the pixel)
+vec2 edgeOffset(int k) {
+    if (k == 0) return vec2(0.125, 0.625);
+    if (k == 1) return vec2(0.375, 0.125);
+    if (k == 2) return vec2(0.625, 0.875);
+    if (k == 3) return vec2(0.875, 0.375);
+    if (k == 4) return vec2(0.25, 0.25);
+    if (k == 5) return vec2(0.75, 0.25);
+    if (k == 6) return vec2(0.25, 0.75);
+    return vec2(0.75, 0.75);
+}
+
+// 4x4 Bayer rank of a pixel, BAYER4 in progressive_refine.hpp:
+// 4 * M2(x mod 2, y mod 2) + M2(x / 2, y / 2), M2 = [0 2; 3 1]
+float bayer2(vec2 c) {
+    return 2.0 * c.x + c.y * (3.0 - 4.0 * c.x);
+}
+
+float bayer4(vec2 pixel) {
+    vec2 c = mod(floor(pixel), 4.0);
+    return 4.0 * bayer2(mod(c, 2.0)) + bayer2(floor(c * 0.5));
+}
+
+void main() {
+    vec2 frag = gl_FragCoord.xy;
+
+#if BH_DEBUG_STATS
+    // Steps as 16-bit fixed point in r, g; exit code in b
+    dbgSteps = 0;
+    dbgExit  = 0.0;
+    tracePixel(frag);
+    gl_FragColor = vec4(packUnit16(float(dbgSteps) / 65535.0), dbgExit / 255.0, 1.0);
+    return;
+#endif
+
+    if (uProgressPass == 2) {
+        vec2 coarseRes = ceil(uResolution * 0.25);
+        gl_FragColor = texture2D(uCoarse, (floor(frag * 0.25) + 0.5) / coarseRes);
+        return;
+    }
+    if (uProgressPass == 1) {
+        frag = floor(frag) * 4.0 + 0.5;
+    }
+    if (uProgressPass == 3 && bayer4(frag) != float(uProgressPhase)) {
+        discard;
+    }
+
+#if BH_EDGE_AA
+    if (uEdgeAAPass == 2) {
+        vec2 texel = 1.0 / uResolution;
+        vec2 uv    = frag * texel;
+        vec4 first = texture2D(uFirstPass, uv);
+
+        float jump = max(max(abs(texture2D(uFirstPass, uv + vec2(texel.x, 0.0)).a - first.a),
+                             abs(texture2D(uFirstPass, uv - vec2(texel.x, 0.0)).a - first.a)),
+                         max(abs(texture2D(uFirstPass, uv + vec2(0.0, texel.y)).a - first.a),
+                             abs(texture2D(uFirstPass, uv - vec2(0.0, texel.y)).a - first.a)));
+        if (jump <= uEdgeThreshold) {
+            gl_FragColor = vec4(first.rgb, 1.0);
+            return;
+        }
+
+        // Pixel corner (left, top) in gl_FragCoord space is
+        // (floor(x), floor(y) + 1); offsets run down from the top
+        vec2 corner = vec2(floor(frag.x), floor(frag.y) + 1.0);
+        vec3 sum = first.rgb;
+        for (int k = 0; k < 8; ++k) {
+            if (k >= uEdgeSamples) break;
+            vec2 o = edgeOffset(k);
+            sum += tracePixel(corner + vec2(o.x, -o.y)).rgb;
+        }
+        gl_FragColor = vec4(sum / float((uEdgeSamples < 8 ? uEdgeSamples : 8) + 1), 1.0);
+        return;
+    }
+#endif
+
+    vec4 px = tracePixel(frag);
+    if (uWriteGBuffer || uEdgeAAPass == 1) {
+        gl_FragColor = px;
+        return;
+    }
+    gl_FragColor = vec4(px.rgb, 1.0);
 }
 
 
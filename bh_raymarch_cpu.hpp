@@ -0,0 +1,801 @@
+// ============================================
+// CPU port of bh_raymarch.frag (Phase G1 - G3)
+// Scalar reference + SIMD-friendly ray packets
+// ============================================
+//
+// Header only, no SFML dependency, so render farm nodes can use it
+// without a GPU or a window. Every formula mirrors the shader line by
+// line; keep the two in sync when one of them changes.
+//
+// Build the packet path with vectorization enabled, e.g.
+//   -O3 -march=native -fno-math-errno -fopenmp-simd
+// (no -ffast-math: it reorders the float math and breaks the pixel
+// match against the reference).
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "tile_scheduler.hpp"
+
+// ----------------------
+// Minimal vec3 (GLSL-like)
+// ----------------------
+struct Vec3 {
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+
+    Vec3() {}
+    Vec3(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
+};
+
+inline Vec3 operator+(Vec3 a, Vec3 b) { return Vec3(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline Vec3 operator-(Vec3 a, Vec3 b) { return Vec3(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline Vec3 operator-(Vec3 a)         { return Vec3(-a.x, -a.y, -a.z); }
+inline Vec3 operator*(Vec3 a, float s) { return Vec3(a.x * s, a.y * s, a.z * s); }
+inline Vec3 operator*(float s, Vec3 a) { return a * s; }
+
+inline float dot(Vec3 a, Vec3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline float length(Vec3 a)      { return std::sqrt(dot(a, a)); }
+
+inline Vec3 cross(Vec3 a, Vec3 b) {
+    return Vec3(
+        a.y * b.z - a.z * b.y,
+        a.z * b.x - a.x * b.z,
+        a.x * b.y - a.y * b.x
+    );
+}
+
+inline Vec3 normalize(Vec3 a) {
+    float inv = 1.0f / std::sqrt(dot(a, a));
+    return a * inv;
+}
+
+inline float clampf(float v, float lo, float hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// Plain selects, unlike std::fmin/fmax (no NaN rules, so no libm call):
+// the packet lane loop only if-converts and vectorizes without calls
+inline float minf(float a, float b) { return a < b ? a : b; }
+inline float maxf(float a, float b) { return a > b ? a : b; }
+
+// ----------------------
+// Shader uniforms (defaults = main.cpp)
+// ----------------------
+enum DiskModel {
+    DISK_THIN   = 0,   // infinitely thin plane (the tracers in this file)
+    DISK_VOLUME = 1    // slab of diskHeight, see volume_disk.hpp
+};
+
+struct RayMarchParams {
+    float resolutionX = 1280.0f;
+    float resolutionY = 720.0f;
+    float time        = 0.0f;
+
+    // Camera
+    Vec3  camPos    = Vec3(0.0f, 1.0f, 12.0f);
+    Vec3  camTarget = Vec3(0.0f, 0.0f, 0.0f);
+    float fovFactor = 0.52056705f;   // tan(55 deg / 2)
+
+    // Scene
+    float bhRadius     = 3.0f;
+    float diskInner    = 4.0f;
+    float diskOuter    = 10.0f;
+    float diskHeight   = 0.5f;
+    float diskRotation = 0.5f;
+    float diskTilt     = 27.0f * 3.14159265f / 180.0f;
+    float spin         = 0.0f;   // Kerr a/M (kerr_geodesic.hpp only)
+    int   diskModel    = DISK_THIN;
+
+    // Bending
+    float gravStrength = 0.8f;
+    float stepSize     = 0.10f;
+    float stepTolerance = 0.0f;   // > 0: adaptive step (bending per step, radians)
+    float influenceRadius = 0.0f; // > 0: skip / early escape outside this sphere
+
+    // Colors
+    Vec3  diskColorBase = Vec3(1.2f, 0.9f, 1.4f);
+};
+
+// Shader defaults (BH_MAX_STEPS / BH_MAX_DIST of the medium tier)
+const int   RAY_MAX_STEPS = 140;
+const float RAY_MAX_DIST  = 80.0f;
+const float RAY_GRAV_EPS  = 0.05f;
+
+// ----------------------
+// Quality tiers (shader_variants.hpp turns them into #defines)
+// ----------------------
+enum QualityTier { TIER_LOW = 0, TIER_MEDIUM = 1, TIER_HIGH = 2 };
+
+const int QUALITY_TIER_COUNT = 3;
+
+struct QualityTierSettings {
+    const char* name;
+    int  maxSteps;
+    int  maxDist;
+    int  stepMode;     // -1 = stepTolerance decides, 0 = fixed, 1 = adaptive
+    bool edgeAA;       // edge supersampling pass compiled in (GPU only)
+};
+
+// Medium is the old hard-coded shader (140 steps, escape at 80).
+// Low pins the adaptive step so 64 steps still reach the disk;
+// high lets grazing rays orbit longer and escape further out.
+constexpr QualityTierSettings QUALITY_TIERS[QUALITY_TIER_COUNT] = {
+    { "low",     64,  40,  1, false },
+    { "medium", 140,  80, -1, true  },
+    { "high",   400, 120, -1, true  },
+};
+
+// Compile-time variant for the CPU tracers: the same knobs as the
+// shader defines, as template parameters, so a tier's loop bound and
+// step-mode test are constants in the instantiated code
+template <int MaxSteps, int MaxDist, int StepMode>
+struct RayVariant {
+    static constexpr int   maxSteps = MaxSteps;
+    static constexpr float maxDist  = static_cast<float>(MaxDist);
+    static constexpr int   stepMode = StepMode;
+};
+
+template <QualityTier T>
+using RayTier = RayVariant<QUALITY_TIERS[T].maxSteps, QUALITY_TIERS[T].maxDist,
+                           QUALITY_TIERS[T].stepMode>;
+
+using RayTierLow    = RayTier<TIER_LOW>;
+using RayTierMedium = RayTier<TIER_MEDIUM>;
+using RayTierHigh   = RayTier<TIER_HIGH>;
+
+// ----------------------
+// Adaptive step (uStepTolerance > 0)
+// ----------------------
+// Curvature-scaled: the direction turns by |acc| * h = g / r^2 * h per
+// step, so h = tol * r^2 / g keeps the bending per step at `tol`. Far from
+// the hole that is many times the fixed step, close to it it shrinks. The
+// step is also kept below half the gap to the horizon so a ray can't
+// jump across the capture sphere. Disk crossings stay exact: they are
+// found on each straight segment regardless of its length.
+const float RAY_MIN_STEP = 0.02f;
+const float RAY_MAX_STEP = 2.0f;
+
+inline float adaptiveStepSize(float tol, float gravStrength, float bhRadius, float r) {
+    float h = tol * r * r / maxf(gravStrength, 1e-6f);
+    h = minf(h, maxf(0.5f * (r - bhRadius), RAY_MIN_STEP));
+    return clampf(h, RAY_MIN_STEP, RAY_MAX_STEP);
+}
+
+// A variant that pins the adaptive step still has to work for scenes
+// set up with a fixed step (stepTolerance = 0)
+const float RAY_DEFAULT_TOLERANCE = 0.01f;
+
+inline float pinnedTolerance(float tol) {
+    return tol > 0.0f ? tol : RAY_DEFAULT_TOLERANCE;
+}
+
+inline float rayStepSize(const RayMarchParams& p, float r) {
+    if (p.stepTolerance <= 0.0f) return p.stepSize;
+    return adaptiveStepSize(p.stepTolerance, p.gravStrength, p.bhRadius, r);
+}
+
+template <class V>
+inline float rayStepSize(const RayMarchParams& p, float r) {
+    if (V::stepMode == 0) return p.stepSize;
+    if (V::stepMode > 0) {
+        return adaptiveStepSize(pinnedTolerance(p.stepTolerance), p.gravStrength, p.bhRadius, r);
+    }
+    return rayStepSize(p, r);
+}
+
+// ----------------------
+// Sphere of influence (uInfluenceRadius > 0)
+// ----------------------
+// Everything that can end a ray (horizon, disk) lies within R of the
+// origin, R >= max(diskOuter, bhRadius, gravStrength); for the volumetric
+// disk diskOuter becomes the slab's rim corner. Outside R the
+// march only bends the ray, and that part has a closed form:
+//
+// The pull is radial and dir stays unit length, so the ray stays in the
+// plane of (pos, dir) and L = |pos x dir| = r sin(psi) changes as
+// dL/ds = g cos(psi) / r^2 * L, i.e. L(r) = C exp(-g / r). With u = 1/r
+// the swept angle is dphi = L du / sqrt(1 - L^2 u^2).
+//
+// Entry: a camera outside R jumps onto the sphere along that curve. r
+// minus L(r) is increasing for r > g, so the ray reaches R iff L(R) < R
+// (the impact-parameter test); otherwise it turns back outside and is
+// background after one step.
+//
+// Escape: the angle psi to the outward radial obeys
+// dpsi/ds = sin(psi) / r * (g / r - 1), so for r > g an outgoing ray
+// only straightens out. Once outside R and moving outward it's done.
+const int RAY_INFLUENCE_QUAD = 12;   // midpoint samples for the entry angle
+
+inline float influenceRadius(const RayMarchParams& p) {
+    if (p.influenceRadius <= 0.0f) return 0.0f;
+    float half = p.diskModel == DISK_VOLUME ? 0.5f * p.diskHeight : 0.0f;
+    float disk = std::sqrt(p.diskOuter * p.diskOuter + half * half);
+    return std::fmax(std::fmax(p.influenceRadius, p.gravStrength),
+                     std::fmax(disk, p.bhRadius));
+}
+
+// Move (pos, dir) onto the sphere of radius R along the bent path.
+// Returns false if the ray never gets inside R.
+inline bool enterInfluenceSphere(Vec3& pos, Vec3& dir, float R, float g) {
+    float r0 = length(pos);
+    if (r0 <= R) return true;
+
+    float radial = dot(pos, dir);
+    if (radial >= 0.0f) return false;            // outgoing beyond R >= g
+
+    Vec3  e1 = pos * (1.0f / r0);
+    Vec3  t  = dir - e1 * (radial / r0);         // in-plane, perpendicular to e1
+    float L0 = length(t) * r0;
+    float uR = 1.0f / R, u0 = 1.0f / r0;
+    float C  = L0 * std::exp(g * u0);
+    float LR = C * std::exp(-g * uR);
+    if (LR >= R) return false;                   // turns back outside R
+
+    // phi swept from r0 to R; u = uR - (uR - u0) s^2 removes the grazing
+    // 1/sqrt singularity at u = uR
+    float phi = 0.0f;
+    for (int k = 0; k < RAY_INFLUENCE_QUAD; ++k) {
+        float sk = (k + 0.5f) / RAY_INFLUENCE_QUAD;
+        float u  = uR - (uR - u0) * sk * sk;
+        float L  = C * std::exp(-g * u);
+        phi += L / std::sqrt(std::fmax(1.0f - L * L * u * u, 1e-12f)) * 2.0f * (uR - u0) * sk;
+    }
+    phi /= RAY_INFLUENCE_QUAD;
+
+    Vec3  e2 = L0 > 1e-6f * r0 ? t * (r0 / L0) : Vec3(0.0f, 0.0f, 0.0f);
+    float c = std::cos(phi), sn = std::sin(phi);
+    Vec3  er = e1 * c + e2 * sn;
+    Vec3  ep = e2 * c - e1 * sn;
+    float sinPsi = LR / R;
+
+    pos = er * R;
+    dir = normalize(ep * sinPsi - er * std::sqrt(1.0f - sinPsi * sinPsi));
+    return true;
+}
+
+// ----------------------
+// Per-frame constants (camera + disk basis)
+// The shader rebuilds these per pixel; they only depend on uniforms.
+// ----------------------
+struct RayFrame {
+    Vec3 forward, right, up;
+    Vec3 diskNormal, diskX, diskZ;
+};
+
+inline RayFrame makeRayFrame(const RayMarchParams& p) {
+    RayFrame f;
+
+    f.forward = normalize(p.camTarget - p.camPos);
+    Vec3 worldUp(0.0f, 1.0f, 0.0f);
+    f.right = normalize(cross(f.forward, worldUp));
+    f.up    = cross(f.right, f.forward);
+
+    float c = std::cos(p.diskTilt);
+    float s = std::sin(p.diskTilt);
+    f.diskNormal = normalize(Vec3(0.0f, c, s));
+
+    Vec3 tmpAxis(1.0f, 0.0f, 0.0f);
+    if (std::fabs(dot(tmpAxis, f.diskNormal)) > 0.99f) {
+        tmpAxis = Vec3(0.0f, 0.0f, 1.0f);
+    }
+    f.diskX = normalize(cross(tmpAxis, f.diskNormal));
+    f.diskZ = cross(f.diskNormal, f.diskX);
+    return f;
+}
+
+inline Vec3 makeRayDirection(const RayMarchParams& p, const RayFrame& f,
+                             float fragX, float fragY) {
+    float ndcX = (2.0f * fragX - p.resolutionX) / p.resolutionY;
+    float ndcY = (2.0f * fragY - p.resolutionY) / p.resolutionY;
+
+    return normalize(
+        f.forward +
+        f.right * (ndcX * p.fovFactor) +
+        f.up    * (ndcY * p.fovFactor)
+    );
+}
+
+// ----------------------
+// Ray result (everything the shading pass needs)
+// ----------------------
+enum RayHitType : std::uint8_t {
+    RAY_MISS    = 0,   // escaped past maxDist or ran out of steps
+    RAY_HORIZON = 1,
+    RAY_DISK    = 2
+};
+
+// Why the march stopped (ray_stats.hpp; the debug shader variant
+// writes the same codes). Tracers other than the marcher leave NONE.
+enum RayExit : std::uint8_t {
+    RAY_EXIT_NONE     = 0,
+    RAY_EXIT_HORIZON  = 1,
+    RAY_EXIT_DISK     = 2,
+    RAY_EXIT_ESCAPE   = 3,   // r > maxDist
+    RAY_EXIT_LEAVING  = 4,   // left the sphere of influence outward
+    RAY_EXIT_SKIPPED  = 5,   // missed the sphere of influence entirely
+    RAY_EXIT_STEP_CAP = 6,   // still marching after maxSteps
+    RAY_EXIT_COUNT    = 7
+};
+
+struct RayResult {
+    std::uint8_t hit  = RAY_MISS;
+    std::uint8_t exit = RAY_EXIT_NONE;
+    float diskR  = 0.0f;
+    float diskXc = 0.0f;
+    float diskZc = 0.0f;
+    Vec3  dir;             // ray direction at the disk hit
+    int   steps = 0;       // loop iterations used
+};
+
+// ----------------------
+// Disk shading (identical to the shader's DISK SHADING block)
+// Split into the time-independent part (radial falloff x Doppler) and
+// the spinning band, so the geodesic cache can bake the first one.
+// ----------------------
+inline float diskBaseBrightness(const RayMarchParams& p, const RayFrame& f, const RayResult& h) {
+    float tRad = (h.diskR - p.diskInner) / (p.diskOuter - p.diskInner);
+    float radialBright = 1.5f - tRad * 1.2f;
+    radialBright = clampf(radialBright, 0.0f, 1.0f);
+
+    Vec3 tangent = normalize(f.diskX * (-h.diskZc) + f.diskZ * h.diskXc);
+
+    float doppler      = dot(-h.dir, tangent);
+    float dopplerBoost = 1.0f + 0.8f * doppler;
+
+    return radialBright * dopplerBoost;
+}
+
+inline float diskBandFactor(const RayMarchParams& p, float angle) {
+    float spin = angle + p.diskRotation * p.time;
+    float band = 0.3f + 0.7f * std::sin(spin * 4.0f);
+    return 0.6f + 0.4f * band;
+}
+
+inline Vec3 shadeRay(const RayMarchParams& p, const RayFrame& f, const RayResult& h) {
+    if (h.hit != RAY_DISK) {
+        return Vec3(0.0f, 0.0f, 0.0f);   // hole shadow and background are both black
+    }
+
+    float angle = std::atan2(h.diskZc, h.diskXc);
+    float brightness = diskBaseBrightness(p, f, h) * diskBandFactor(p, angle);
+
+    return p.diskColorBase * brightness;
+}
+
+// ----------------------
+// Scalar reference: one ray, straight transliteration of main()
+// ----------------------
+template <class V = RayTierMedium>
+inline RayResult traceRayReference(const RayMarchParams& p, const RayFrame& f,
+                                   float fragX, float fragY) {
+    RayResult res;
+
+    Vec3 pos = p.camPos;
+    Vec3 dir = makeRayDirection(p, f, fragX, fragY);
+
+    const float rInf = influenceRadius(p);
+    if (rInf > 0.0f && !enterInfluenceSphere(pos, dir, rInf, p.gravStrength)) {
+        res.steps = 1;
+        res.exit  = RAY_EXIT_SKIPPED;
+        return res;
+    }
+
+    float dPlane = dot(pos, f.diskNormal);
+
+    for (int i = 0; i < V::maxSteps; ++i) {
+        float r = length(pos);
+        res.steps = i + 1;
+
+        if (r < p.bhRadius) {
+            res.hit  = RAY_HORIZON;
+            res.exit = RAY_EXIT_HORIZON;
+            break;
+        }
+        if (r > V::maxDist) {
+            res.exit = RAY_EXIT_ESCAPE;
+            break;
+        }
+        if (rInf > 0.0f && r > rInf && dot(pos, dir) > 0.0f) {
+            res.exit = RAY_EXIT_LEAVING;
+            break;
+        }
+
+        float stepSize = rayStepSize<V>(p, r);
+
+        Vec3 nextPos = pos + dir * stepSize;
+        float dNext = dot(nextPos, f.diskNormal);
+
+        if ((dPlane > 0.0f && dNext <= 0.0f) || (dPlane < 0.0f && dNext >= 0.0f)) {
+            float frac = dPlane / (dPlane - dNext);
+            Vec3 hp = pos + dir * (stepSize * frac);
+
+            float x = dot(hp, f.diskX);
+            float z = dot(hp, f.diskZ);
+            float rDisk = std::sqrt(x * x + z * z);
+
+            if (rDisk > p.diskInner && rDisk < p.diskOuter) {
+                res.hit    = RAY_DISK;
+                res.exit   = RAY_EXIT_DISK;
+                res.diskR  = rDisk;
+                res.diskXc = x;
+                res.diskZc = z;
+                res.dir    = dir;
+                break;
+            }
+        }
+
+        float invR = 1.0f / std::fmax(r, RAY_GRAV_EPS);
+        float grav = p.gravStrength * invR * invR;
+        Vec3  acc  = pos * (-grav * invR);
+
+        dir = normalize(dir + acc * stepSize);
+        pos = nextPos;
+
+        dPlane = dNext;
+    }
+    if (res.exit == RAY_EXIT_NONE) res.exit = RAY_EXIT_STEP_CAP;
+    return res;
+}
+
+inline Vec3 rayMarchReference(const RayMarchParams& p, const RayFrame& f,
+                              float fragX, float fragY) {
+    return shadeRay(p, f, traceRayReference(p, f, fragX, fragY));
+}
+
+// ----------------------
+// Ray packet: W lanes stepped in lock-step, SoA
+// ----------------------
+// Rays go through in groups of W; lanes retire independently (horizon /
+// escape / disk / step cap) and a group steps until its last lane has
+// retired. Refilling retired lanes from the stream instead saves under
+// 10% of the vector steps even in divergent scenes (neighbouring pixels
+// retire close together) and measured within noise at both widths, so
+// it isn't worth the scalar bookkeeping. The lane loop has no branches
+// and no libm calls, so it maps onto 8/16-wide vector registers.
+template <int W, class V = RayTierMedium>
+struct RayPacket {
+    float px[W], py[W], pz[W];
+    float dx[W], dy[W], dz[W];
+    float dPlane[W];
+    int   active[W];
+    int   steps[W];
+    int   exitCode[W];
+
+    // Hit record, SoA so the lane loop stays vectorizable
+    int   hitType[W];
+    float hitR[W], hitX[W], hitZ[W];
+    float hitDx[W], hitDy[W], hitDz[W];
+
+    // Loop invariants of one trace
+    struct Consts {
+        Vec3  n, ax, az;
+        float fixedH, tol;
+        bool  adaptive;
+        float bhRadius, diskInner, diskOuter, gravStrength;
+        float rInf;
+        int   skipOn;
+    };
+
+    static Consts makeConsts(const RayMarchParams& p, const RayFrame& f) {
+        Consts c;
+        c.n  = f.diskNormal;
+        c.ax = f.diskX;
+        c.az = f.diskZ;
+        c.fixedH   = p.stepSize;
+        c.tol      = V::stepMode > 0 ? pinnedTolerance(p.stepTolerance) : p.stepTolerance;
+        c.adaptive = V::stepMode < 0 ? c.tol > 0.0f : V::stepMode > 0;
+        c.bhRadius     = p.bhRadius;
+        c.diskInner    = p.diskInner;
+        c.diskOuter    = p.diskOuter;
+        c.gravStrength = p.gravStrength;
+        c.rInf   = influenceRadius(p);
+        c.skipOn = c.rInf > 0.0f ? 1 : 0;
+        return c;
+    }
+
+    // Empty lanes still go through the lane loop: park them on a finite
+    // state so the discarded math can't produce inf/NaN
+    void park(int l) {
+        px[l] = py[l] = pz[l] = 0.0f;
+        dx[l] = dy[l] = 0.0f;
+        dz[l] = 1.0f;
+        dPlane[l] = 0.0f;
+        active[l] = 0;
+        steps[l] = 0;
+        exitCode[l] = RAY_EXIT_NONE;
+        hitType[l] = RAY_MISS;
+        hitR[l] = hitX[l] = hitZ[l] = 0.0f;
+        hitDx[l] = hitDy[l] = hitDz[l] = 0.0f;
+    }
+
+    // Starts a ray in lane l; false if it misses the influence sphere,
+    // in which case its result is already final
+    bool load(const RayMarchParams& p, const RayFrame& f, const Consts& c,
+              int l, float fragX, float fragY) {
+        Vec3 d = makeRayDirection(p, f, fragX, fragY);
+        Vec3 o = p.camPos;
+        int  in = c.skipOn ? (enterInfluenceSphere(o, d, c.rInf, c.gravStrength) ? 1 : 0) : 1;
+        px[l] = o.x; py[l] = o.y; pz[l] = o.z;
+        dx[l] = d.x; dy[l] = d.y; dz[l] = d.z;
+        dPlane[l] = px[l] * c.n.x + py[l] * c.n.y + pz[l] * c.n.z;
+        active[l] = in;
+        steps[l] = in ? 0 : 1;
+        exitCode[l] = in ? RAY_EXIT_NONE : RAY_EXIT_SKIPPED;
+        hitType[l] = RAY_MISS;
+        hitR[l] = hitX[l] = hitZ[l] = 0.0f;
+        hitDx[l] = hitDy[l] = hitDz[l] = 0.0f;
+        return in != 0;
+    }
+
+    RayResult laneResult(int l) const {
+        RayResult res;
+        res.hit    = static_cast<std::uint8_t>(hitType[l]);
+        res.exit   = static_cast<std::uint8_t>(exitCode[l]);
+        res.diskR  = hitR[l];
+        res.diskXc = hitX[l];
+        res.diskZc = hitZ[l];
+        res.dir    = Vec3(hitDx[l], hitDy[l], hitDz[l]);
+        res.steps  = steps[l];
+        return res;
+    }
+
+    // One step of every lane; returns how many are still active
+    template <bool ADAPTIVE>
+    int step(const Consts& c) {
+        const Vec3 n  = c.n;
+        const Vec3 ax = c.ax;
+        const Vec3 az = c.az;
+        int alive = 0;
+
+#pragma omp simd reduction(+:alive)
+        for (int l = 0; l < W; ++l) {
+            float x = px[l], y = py[l], z = pz[l];
+            float r = std::sqrt(x * x + y * y + z * z);
+
+            // Masks are 0/1 ints combined with & and | (no && / ||)
+            // so the loop body has no control flow to vectorize around
+            int on      = active[l];
+            steps[l] += on;
+            int capture = on & (r < c.bhRadius);
+            int leaving = c.skipOn & (r > c.rInf) & ((x * dx[l] + y * dy[l] + z * dz[l]) > 0.0f);
+            int escape  = on & (capture ^ 1) & ((r > V::maxDist) | leaving);
+            on = on & (capture ^ 1) & (escape ^ 1);
+
+            float h = ADAPTIVE ? adaptiveStepSize(c.tol, c.gravStrength, c.bhRadius, r) : c.fixedH;
+
+            float nx = x + dx[l] * h;
+            float ny = y + dy[l] * h;
+            float nz = z + dz[l] * h;
+            float dNext = nx * n.x + ny * n.y + nz * n.z;
+            float dCur  = dPlane[l];
+
+            int crossed = ((dCur > 0.0f) & (dNext <= 0.0f)) | ((dCur < 0.0f) & (dNext >= 0.0f));
+
+            float frac = dCur / (dCur - dNext);
+            float hx = x + dx[l] * (h * frac);
+            float hy = y + dy[l] * (h * frac);
+            float hz = z + dz[l] * (h * frac);
+            float diskXc = hx * ax.x + hy * ax.y + hz * ax.z;
+            float diskZc = hx * az.x + hy * az.y + hz * az.z;
+            float rDisk  = std::sqrt(diskXc * diskXc + diskZc * diskZc);
+
+            int disk = on & crossed & (rDisk > c.diskInner) & (rDisk < c.diskOuter);
+            on = on & (disk ^ 1);
+
+            // The reference loop ends after maxSteps full steps
+            int capped = on & (steps[l] >= V::maxSteps);
+            on = on & (capped ^ 1);
+
+            int escapeCode = leaving & (r <= V::maxDist) ? RAY_EXIT_LEAVING : RAY_EXIT_ESCAPE;
+            int code = exitCode[l];
+            code = capped  ? RAY_EXIT_STEP_CAP : code;
+            code = disk    ? RAY_EXIT_DISK     : code;
+            code = escape  ? escapeCode        : code;
+            code = capture ? RAY_EXIT_HORIZON  : code;
+            exitCode[l] = code;
+
+            int type = hitType[l];
+            type = disk    ? RAY_DISK    : type;
+            type = capture ? RAY_HORIZON : type;
+            hitType[l] = type;
+
+            hitR[l]  = disk ? rDisk  : hitR[l];
+            hitX[l]  = disk ? diskXc : hitX[l];
+            hitZ[l]  = disk ? diskZc : hitZ[l];
+            hitDx[l] = disk ? dx[l]  : hitDx[l];
+            hitDy[l] = disk ? dy[l]  : hitDy[l];
+            hitDz[l] = disk ? dz[l]  : hitDz[l];
+
+            float invR = 1.0f / maxf(r, RAY_GRAV_EPS);
+            float grav = c.gravStrength * invR * invR;
+            float k    = -grav * invR;
+
+            float ndx = dx[l] + (x * k) * h;
+            float ndy = dy[l] + (y * k) * h;
+            float ndz = dz[l] + (z * k) * h;
+            float inv = 1.0f / std::sqrt(ndx * ndx + ndy * ndy + ndz * ndz);
+
+            // Retired lanes keep their state frozen
+            px[l] = on ? nx : x;
+            py[l] = on ? ny : y;
+            pz[l] = on ? nz : z;
+            dx[l] = on ? ndx * inv : dx[l];
+            dy[l] = on ? ndy * inv : dy[l];
+            dz[l] = on ? ndz * inv : dz[l];
+            dPlane[l] = on ? dNext : dCur;
+            active[l] = on;
+            alive += on;
+        }
+        return alive;
+    }
+
+    // Traces rays 0..count-1. rayAt(i, fragX, fragY) fills in ray i's
+    // fragment coords; onResult(i, const RayResult&) is called once per
+    // ray, in order
+    template <class RayFn, class ResultFn>
+    void traceStream(const RayMarchParams& p, const RayFrame& f, int count,
+                     RayFn rayAt, ResultFn onResult) {
+        const Consts c = makeConsts(p, f);
+
+        for (int first = 0; first < count; first += W) {
+            const int lanes = count - first < W ? count - first : W;
+            int live = 0;
+            for (int l = 0; l < W; ++l) {
+                if (l >= lanes) {
+                    park(l);
+                    continue;
+                }
+                float fragX, fragY;
+                rayAt(first + l, fragX, fragY);
+                live += load(p, f, c, l, fragX, fragY) ? 1 : 0;
+            }
+
+            while (live > 0) live = c.adaptive ? step<true>(c) : step<false>(c);
+
+            for (int l = 0; l < lanes; ++l) onResult(first + l, laneResult(l));
+        }
+    }
+};
+
+// ----------------------
+// Whole-image helpers
+// rgb is width*height*3 floats, row 0 = top of the window
+// (gl_FragCoord.y is flipped: row y -> fragY = height - y - 0.5)
+// ----------------------
+inline void renderRowsReference(const RayMarchParams& p, std::vector<float>& rgb,
+                                int rowBegin, int rowEnd) {
+    const int w = static_cast<int>(p.resolutionX);
+    const int hgt = static_cast<int>(p.resolutionY);
+    RayFrame f = makeRayFrame(p);
+
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        float fragY = hgt - y - 0.5f;
+        for (int x = 0; x < w; ++x) {
+            Vec3 c = rayMarchReference(p, f, x + 0.5f, fragY);
+            float* px = &rgb[(static_cast<size_t>(y) * w + x) * 3];
+            px[0] = c.x; px[1] = c.y; px[2] = c.z;
+        }
+    }
+}
+
+// The rect's pixels go through one packet in row order, W at a time.
+// onResult(x, y, const RayResult&) is called once per pixel.
+template <int W, class V = RayTierMedium, class ResultFn>
+inline void traceRectPacket(const RayMarchParams& p, const RayFrame& f,
+                            int rx0, int ry0, int rx1, int ry1, ResultFn onResult) {
+    const int hgt = static_cast<int>(p.resolutionY);
+    const int rw  = rx1 - rx0;
+    if (rw <= 0 || ry1 <= ry0) return;
+
+    RayPacket<W, V> packet;
+    packet.traceStream(p, f, rw * (ry1 - ry0),
+        [&](int i, float& fragX, float& fragY) {
+            fragX = rx0 + i % rw + 0.5f;
+            fragY = hgt - (ry0 + i / rw) - 0.5f;
+        },
+        [&](int i, const RayResult& res) { onResult(rx0 + i % rw, ry0 + i / rw, res); });
+}
+
+// rgb: resolutionX * resolutionY * 3 floats, rows top-down; the
+// pointer overloads write straight into a caller's buffer (bh_core)
+template <int W>
+inline void renderRectPacket(const RayMarchParams& p, const RayFrame& f, float* rgb,
+                             int rx0, int ry0, int rx1, int ry1) {
+    const int w = static_cast<int>(p.resolutionX);
+
+    traceRectPacket<W>(p, f, rx0, ry0, rx1, ry1,
+        [&](int x, int y, const RayResult& res) {
+            Vec3 c = shadeRay(p, f, res);
+            float* px = &rgb[(static_cast<size_t>(y) * w + x) * 3];
+            px[0] = c.x; px[1] = c.y; px[2] = c.z;
+        });
+}
+
+template <int W>
+inline void renderRectPacket(const RayMarchParams& p, const RayFrame& f,
+                             std::vector<float>& rgb,
+                             int rx0, int ry0, int rx1, int ry1) {
+    renderRectPacket<W>(p, f, rgb.data(), rx0, ry0, rx1, ry1);
+}
+
+template <int W>
+inline void renderRowsPacket(const RayMarchParams& p, std::vector<float>& rgb,
+                             int rowBegin, int rowEnd) {
+    RayFrame f = makeRayFrame(p);
+    renderRectPacket<W>(p, f, rgb, 0, rowBegin, static_cast<int>(p.resolutionX), rowEnd);
+}
+
+// ----------------------
+// Project a world point to pixel coords (row 0 = top)
+// Inverse of makeRayDirection; returns false behind the camera.
+// ----------------------
+inline bool projectToPixel(const RayMarchParams& p, const RayFrame& f, Vec3 world,
+                           float& outX, float& outY) {
+    Vec3 v = world - p.camPos;
+    float zf = dot(v, f.forward);
+    if (zf <= 0.0f) return false;
+
+    float ndcX = dot(v, f.right) / (zf * p.fovFactor);
+    float ndcY = dot(v, f.up)    / (zf * p.fovFactor);
+
+    outX = (ndcX * p.resolutionY + p.resolutionX) * 0.5f;
+    outY = p.resolutionY - (ndcY * p.resolutionY + p.resolutionY) * 0.5f;
+    return true;
+}
+
+// ----------------------
+// Tiled multi-threaded render (work stealing, see tile_scheduler.hpp)
+// ----------------------
+// Cost estimate: rays near the projected hole circle the longest (they
+// often run all RAY_MAX_STEPS), rays far from it escape or hit the disk
+// quickly. Lensing makes the shadow look ~1.5x larger than bhRadius.
+inline void estimateRayMarchTileCosts(const RayMarchParams& p, const RayFrame& f,
+                                      std::vector<RenderTile>& tiles) {
+    float hx = 0.0f, hy = 0.0f;
+    bool visible = projectToPixel(p, f, Vec3(0.0f, 0.0f, 0.0f), hx, hy);
+
+    float camDist = length(p.camPos);
+    float shadowPx = 1.5f * p.bhRadius / std::fmax(camDist, 1e-3f)
+                   * (0.5f * p.resolutionY) / p.fovFactor;
+    shadowPx = std::fmax(shadowPx, 1.0f);
+
+    for (RenderTile& t : tiles) {
+        if (!visible) {
+            t.cost = 1.0f;
+            continue;
+        }
+        float cx = 0.5f * (t.x0 + t.x1) - hx;
+        float cy = 0.5f * (t.y0 + t.y1) - hy;
+        float d = std::sqrt(cx * cx + cy * cy) / shadowPx;
+        t.cost = 1.0f + 4.0f / (1.0f + d * d);
+    }
+}
+
+template <int W>
+inline double renderTiledPacket(const RayMarchParams& p, float* rgb,
+                                int tileSize, int threads,
+                                std::vector<TileWorkerStats>& stats) {
+    RayFrame f = makeRayFrame(p);
+
+    std::vector<RenderTile> tiles = makeTileGrid(
+        static_cast<int>(p.resolutionX), static_cast<int>(p.resolutionY), tileSize);
+    estimateRayMarchTileCosts(p, f, tiles);
+
+    return runTilesWorkStealing(tiles, threads,
+        [&](const RenderTile& t, int) {
+            renderRectPacket<W>(p, f, rgb, t.x0, t.y0, t.x1, t.y1);
+        },
+        stats);
+}
+
+template <int W>
+inline double renderTiledPacket(const RayMarchParams& p, std::vector<float>& rgb,
+                                int tileSize, int threads,
+                                std::vector<TileWorkerStats>& stats) {
+    return renderTiledPacket<W>(p, rgb.data(), tileSize, threads, stats);
+}
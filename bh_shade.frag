@@ -0,0 +1,39 @@
+// ============================================
+// Geodesic G-buffer shading pass
+// Reads the packed buffer written by bh_raymarch.frag
+// (uWriteGBuffer = true) and applies the only time-dependent
+// term: the spinning band. No ray marching here.
+// ============================================
+
+uniform sampler2D uGBuffer;      // RG = disk angle, BA = static brightness
+uniform vec2      uResolution;
+uniform float     uTime;
+
+uniform float     uDiskRotation;
+uniform vec3      uDiskColorBase;
+
+const float PI = 3.14159265;
+
+// Inverse of packUnit16() in bh_raymarch.frag
+float unpackUnit16(vec2 hl) {
+    vec2 b = floor(hl * 255.0 + 0.5);
+    return (b.x * 256.0 + b.y) / 65535.0;
+}
+
+void main() {
+    vec4 g = texture2D(uGBuffer, gl_FragCoord.xy / uResolution);
+
+    float baseBright = unpackUnit16(g.ba) * 2.0;
+    if (baseBright <= 0.0) {
+        gl_FragColor = vec4(0.0, 0.0, 0.0, 1.0);  // hole / background
+        return;
+    }
+
+    float angle = unpackUnit16(g.rg) * 2.0 * PI - PI;
+    float spin  = angle + uDiskRotation * uTime;
+
+    float band = 0.3 + 0.7 * sin(spin * 4.0);
+    float brightness = baseBright * (0.6 + 0.4 * band);
+
+    gl_FragColor = vec4(uDiskColorBase * brightness, 1.0);
+}
@@ -0,0 +1,317 @@
+// ============================================
+// Per-stage frame profiler
+// ============================================
+//
+// PROFILE_SCOPE("ray march") times the rest of the enclosing block.
+// Each thread records into its own fixed-size ring of (name, start,
+// end) events with nanosecond steady-clock timestamps; the owning
+// thread is the only writer, so recording takes no lock. The ring keeps
+// the most recent PROFILE_RING_SIZE events and overwrites the oldest.
+//
+// On demand the rings are copied out for
+//   writeChromeTrace   JSON for chrome://tracing / Perfetto
+//   summarize          p50 / p95 / p99 per stage over the last N seconds
+//
+// Disabled (the default) a scope costs one relaxed atomic load and a
+// branch. Building with -DBH_PROFILE=0 removes the scopes entirely.
+//
+// With PerfCounters enabled (perf_counters.hpp) each scope also adds
+// its hardware counter deltas to the stage's per-thread totals.
+//
+// GPU stages are timed on the CPU: a draw scope covers submission, and
+// the wait for the GPU shows up in "present" (window.display).
+
+#pragma once
+
+#include "perf_counters.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef BH_PROFILE
+#define BH_PROFILE 1
+#endif
+
+struct ProfileEvent {
+    const char*   name;      // string literal, never freed
+    std::uint64_t startNs;
+    std::uint64_t endNs;
+};
+
+const std::uint64_t PROFILE_RING_SIZE = 1 << 14;   // events per thread, power of two
+
+// ----------------------
+// Single-writer ring
+// ----------------------
+// A seqlock with head as the sequence: the writer fills slot h, then
+// publishes it by bumping head to h + 1 (release). A reader copies
+// [head - size, head) and afterwards drops the slots the writer may
+// have lapped while it was copying. Slot fields are relaxed atomics, so
+// a copy racing a write is torn rather than undefined (and TSan-clean);
+// the torn copies are exactly the ones the re-check drops.
+struct ProfileSlot {
+    std::atomic<const char*>   name{nullptr};
+    std::atomic<std::uint64_t> startNs{0};
+    std::atomic<std::uint64_t> endNs{0};
+};
+
+struct ProfileRing {
+    ProfileSlot events[PROFILE_RING_SIZE];
+    std::atomic<std::uint64_t> head{0};
+    int         id = 0;                  // Chrome trace tid
+    const char* threadName = nullptr;
+
+    void push(const ProfileEvent& e) {
+        const auto relaxed = std::memory_order_relaxed;
+        std::uint64_t h = head.load(relaxed);
+        ProfileSlot& slot = events[h & (PROFILE_RING_SIZE - 1)];
+        // A reader that sees any of the new fields also sees head >= h,
+        // so it knows slot h - size is being overwritten
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.name.store(e.name, relaxed);
+        slot.startNs.store(e.startNs, relaxed);
+        slot.endNs.store(e.endNs, relaxed);
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    // Append the events still in the ring, oldest first
+    void snapshot(std::vector<ProfileEvent>& out) const {
+        const auto relaxed = std::memory_order_relaxed;
+        std::uint64_t end   = head.load(std::memory_order_acquire);
+        std::uint64_t begin = end > PROFILE_RING_SIZE ? end - PROFILE_RING_SIZE : 0;
+        size_t base = out.size();
+        for (std::uint64_t h = begin; h < end; ++h) {
+            const ProfileSlot& slot = events[h & (PROFILE_RING_SIZE - 1)];
+            out.push_back(ProfileEvent{ slot.name.load(relaxed), slot.startNs.load(relaxed),
+                                        slot.endNs.load(relaxed) });
+        }
+
+        // Slot `now` may be mid-write and shares its index with
+        // now - size, so the first intact slot is now + 1 - size
+        std::atomic_thread_fence(std::memory_order_acquire);
+        std::uint64_t now = head.load(relaxed);
+        std::uint64_t firstIntact = now + 1 > PROFILE_RING_SIZE ? now + 1 - PROFILE_RING_SIZE : 0;
+        if (firstIntact > begin) {
+            size_t lapped = static_cast<size_t>(std::min(firstIntact - begin, end - begin));
+            out.erase(out.begin() + base, out.begin() + base + lapped);
+        }
+    }
+};
+
+struct ProfileStageSummary {
+    std::string name;
+    size_t count = 0;
+    double p50Ms = 0.0, p95Ms = 0.0, p99Ms = 0.0, maxMs = 0.0;
+};
+
+// ----------------------
+// Process-wide profiler
+// ----------------------
+// Rings are handed out per thread on first use and returned to a free
+// list when the thread exits, so short-lived worker threads (one set
+// per tiled frame) reuse a handful of rings instead of growing the list.
+class FrameProfiler {
+public:
+    static FrameProfiler& instance() {
+        static FrameProfiler profiler;
+        return profiler;
+    }
+
+    bool enabled() const { return on.load(std::memory_order_relaxed); }
+    void setEnabled(bool v) { on.store(v, std::memory_order_relaxed); }
+
+    std::uint64_t nowNs() const {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch).count());
+    }
+
+    void record(const char* name, std::uint64_t startNs, std::uint64_t endNs) {
+        threadRing().push(ProfileEvent{ name, startNs, endNs });
+    }
+
+    // Label the calling thread's lane in the trace
+    void setThreadName(const char* name) { threadRing().threadName = name; }
+
+    // Per-stage percentiles over events that ended in the last windowSeconds
+    std::vector<ProfileStageSummary> summarize(double windowSeconds) const {
+        std::vector<ProfileEvent> events;
+        collect(events, nullptr);
+
+        const std::uint64_t now = nowNs();
+        const std::uint64_t window = static_cast<std::uint64_t>(windowSeconds * 1e9);
+        std::map<std::string, std::vector<double>> byName;
+        for (const ProfileEvent& e : events) {
+            if (now - e.endNs > window) continue;
+            byName[e.name].push_back((e.endNs - e.startNs) * 1e-6);
+        }
+
+        std::vector<ProfileStageSummary> out;
+        for (auto& kv : byName) {
+            std::vector<double>& ms = kv.second;
+            std::sort(ms.begin(), ms.end());
+            auto rank = [&](double q) {
+                size_t i = static_cast<size_t>(q * ms.size());
+                return ms[std::min(i, ms.size() - 1)];
+            };
+            ProfileStageSummary s;
+            s.name  = kv.first;
+            s.count = ms.size();
+            s.p50Ms = rank(0.50);
+            s.p95Ms = rank(0.95);
+            s.p99Ms = rank(0.99);
+            s.maxMs = ms.back();
+            out.push_back(s);
+        }
+        return out;
+    }
+
+    // Complete ("X") events plus one thread_name record per ring
+    bool writeChromeTrace(const char* path) const {
+        std::vector<ProfileEvent> events;
+        std::vector<int> tids;
+        std::vector<std::pair<int, const char*>> names;
+        collect(events, &tids, &names);
+
+        FILE* f = std::fopen(path, "w");
+        if (!f) return false;
+        std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        bool first = true;
+        for (const auto& n : names) {
+            std::fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                            "\"args\":{\"name\":\"%s\"}}",
+                         first ? "" : ",\n", n.first, jsonSafe(n.second).c_str());
+            first = false;
+        }
+        for (size_t i = 0; i < events.size(); ++i) {
+            const ProfileEvent& e = events[i];
+            std::fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                            "\"ts\":%.3f,\"dur\":%.3f}",
+                         first ? "" : ",\n", jsonSafe(e.name).c_str(), tids[i],
+                         e.startNs * 1e-3, (e.endNs - e.startNs) * 1e-3);
+            first = false;
+        }
+        std::fprintf(f, "\n]}\n");
+        return std::fclose(f) == 0;
+    }
+
+private:
+    std::atomic<bool> on{false};
+    const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    mutable std::mutex registry;
+    std::vector<std::unique_ptr<ProfileRing>> rings;
+    std::vector<ProfileRing*> freeRings;
+
+    FrameProfiler() = default;
+
+    // Returns the ring to the free list when its thread exits
+    struct RingHandle {
+        ProfileRing* ring = nullptr;
+        ~RingHandle() {
+            if (ring) FrameProfiler::instance().release(ring);
+        }
+    };
+
+    ProfileRing& threadRing() {
+        thread_local RingHandle handle;
+        if (!handle.ring) handle.ring = acquire();
+        return *handle.ring;
+    }
+
+    ProfileRing* acquire() {
+        std::lock_guard<std::mutex> lock(registry);
+        if (!freeRings.empty()) {
+            ProfileRing* r = freeRings.back();
+            freeRings.pop_back();
+            return r;
+        }
+        rings.emplace_back(new ProfileRing());
+        rings.back()->id = static_cast<int>(rings.size()) - 1;
+        return rings.back().get();
+    }
+
+    void release(ProfileRing* r) {
+        std::lock_guard<std::mutex> lock(registry);
+        freeRings.push_back(r);
+    }
+
+    void collect(std::vector<ProfileEvent>& events, std::vector<int>* tids,
+                 std::vector<std::pair<int, const char*>>* names = nullptr) const {
+        std::lock_guard<std::mutex> lock(registry);
+        for (const auto& r : rings) {
+            size_t before = events.size();
+            r->snapshot(events);
+            if (tids) tids->resize(events.size(), r->id);
+            if (names && events.size() > before) {
+                names->emplace_back(r->id, r->threadName ? r->threadName : "worker");
+            }
+        }
+    }
+
+    static std::string jsonSafe(const char* s) {
+        std::string out;
+        for (; *s; ++s) {
+            if (*s == '"' || *s == '\\') out += '\\';
+            out += *s;
+        }
+        return out;
+    }
+};
+
+inline void printProfileSummary(const std::vector<ProfileStageSummary>& stages, double windowSeconds) {
+    std::printf("profile, last %.0f s          count    p50 ms    p95 ms    p99 ms    max ms\n",
+                windowSeconds);
+    for (const ProfileStageSummary& s : stages) {
+        std::printf("  %-24s %7zu  %8.3f  %8.3f  %8.3f  %8.3f\n", s.name.c_str(), s.count,
+                    s.p50Ms, s.p95Ms, s.p99Ms, s.maxMs);
+    }
+}
+
+// ----------------------
+// Scoped timer
+// ----------------------
+class ProfileScope {
+public:
+    // Counter reads sit outside the timed interval, so they don't
+    // show up in the trace
+    explicit ProfileScope(const char* stage) : name(stage) {
+        counting = PerfCounters::enabled();
+        if (counting) PerfCounters::instance().begin();
+        FrameProfiler& p = FrameProfiler::instance();
+        active = p.enabled();
+        if (active) startNs = p.nowNs();
+    }
+
+    ~ProfileScope() {
+        if (active) {
+            FrameProfiler& p = FrameProfiler::instance();
+            p.record(name, startNs, p.nowNs());
+        }
+        if (counting) PerfCounters::instance().end(name);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char*   name;
+    std::uint64_t startNs = 0;
+    bool          active  = false;
+    bool          counting = false;
+};
+
+#if BH_PROFILE
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b)  PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(stage)  ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(stage)
+#else
+#define PROFILE_SCOPE(stage)  ((void)0)
+#endif
@@ -0,0 +1,162 @@
+// ============================================
+// GalaxySim conservation diagnostics
+// ============================================
+//
+// For picking P.dt and the integrator from data: total energy in the
+// black hole + halo potential, angular momentum about the hole, stars
+// captured so far and a brightness histogram, sampled every K steps
+// and streamed to CSV.
+//
+// The potential is the one step() integrates (d = r + 1e-3, as there):
+//   black hole  a = G M / (d^2 + s)  ->  phi = -(G M / sqrt(s)) (pi/2 - atan(d / sqrt(s)))
+//   halo        a = v0^2 / (d + rc)  ->  phi = v0^2 ln(d + rc)
+// In 3D mode d is the 3D radius, plus the disk's restoring force
+//   a_z = -k z  ->  phi = k z^2 / 2
+// and the kinetic term takes vz; L is still about the z axis (the
+// extra forces are central or along z, so Lz is conserved too).
+// With viscosity and capture off (viscosityBase = 0, horizonRadius = 0)
+// E and L are conserved by the physics, so any drift is integrator
+// error. With them on, the drift is dissipation plus that error.
+//
+// The sums run as one fused SIMD reduction over the SoA arrays, apart
+// from step(); sampling every K steps costs about 1/K of a pass.
+
+#pragma once
+
+#include "galaxy_sim.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+const int   GALAXY_BRIGHT_BINS = 9;      // over the clamp range [0.2, 2.0]
+const float GALAXY_BRIGHT_MIN  = 0.2f;
+const float GALAXY_BRIGHT_MAX  = 2.0f;
+
+struct GalaxyDiagnostics {
+    std::uint64_t step = 0;
+    double time      = 0.0;
+    double kinetic   = 0.0;
+    double potential = 0.0;
+    double energy    = 0.0;   // kinetic + potential, per unit star mass, summed
+    double angMom    = 0.0;   // sum of x vy - y vx
+    double rmsZ      = 0.0;   // disk thickness (3D mode; 0 in 2D)
+    std::uint64_t captured = 0;
+    double meanBrightness  = 0.0;
+    std::uint32_t brightHist[GALAXY_BRIGHT_BINS] = {};
+};
+
+inline GalaxyDiagnostics measureGalaxy(const GalaxySim& sim, std::uint64_t step, double time) {
+    GalaxyDiagnostics d;
+    d.step     = step;
+    d.time     = time;
+    d.captured = sim.captured;
+
+    const int n = static_cast<int>(sim.posX.size());
+    const float* px = sim.posX.data();
+    const float* py = sim.posY.data();
+    const float* vx = sim.velX.data();
+    const float* vy = sim.velY.data();
+    const float* br = sim.brightness.data();
+
+    const float rs     = std::sqrt(sim.P.softening);
+    const float bhK    = sim.P.G * sim.P.M_bh / rs;
+    const float v02    = sim.P.v0 * sim.P.v0;
+    const float rCore  = sim.P.r_core;
+    const float PI_2   = 1.57079633f;
+
+    // Float lanes, double accumulators: 1e6 stars would otherwise lose
+    // the drift we are looking for in rounding
+    double kin = 0.0, pot = 0.0, ang = 0.0, bright = 0.0, z2 = 0.0;
+    if (sim.threeD) {
+        const float* pz = sim.posZ.data();
+        const float* vz = sim.velZ.data();
+        const float  kz = 0.5f * sim.P.verticalRestoring;
+#pragma omp simd reduction(+:kin, pot, ang, bright, z2)
+        for (int i = 0; i < n; ++i) {
+            float x = px[i], y = py[i], z = pz[i];
+            float u = vx[i], v = vy[i], w = vz[i];
+            float dist = std::sqrt(x * x + y * y + z * z) + 1e-3f;
+            kin += 0.5f * (u * u + v * v + w * w);
+            pot += -bhK * (PI_2 - std::atan(dist / rs)) + v02 * std::log(dist + rCore) + kz * z * z;
+            ang += x * v - y * u;
+            bright += br[i];
+            z2 += z * z;
+        }
+    } else {
+#pragma omp simd reduction(+:kin, pot, ang, bright)
+        for (int i = 0; i < n; ++i) {
+            float x = px[i], y = py[i];
+            float u = vx[i], v = vy[i];
+            float dist = std::sqrt(x * x + y * y) + 1e-3f;
+            kin += 0.5f * (u * u + v * v);
+            pot += -bhK * (PI_2 - std::atan(dist / rs)) + v02 * std::log(dist + rCore);
+            ang += x * v - y * u;
+            bright += br[i];
+        }
+    }
+    d.kinetic   = kin;
+    d.potential = pot;
+    d.energy    = kin + pot;
+    d.angMom    = ang;
+    d.meanBrightness = n > 0 ? bright / n : 0.0;
+    d.rmsZ      = n > 0 ? std::sqrt(z2 / n) : 0.0;
+
+    // Histogram: scattered increments don't vectorize, keep it separate
+    const float binScale = GALAXY_BRIGHT_BINS / (GALAXY_BRIGHT_MAX - GALAXY_BRIGHT_MIN);
+    for (int i = 0; i < n; ++i) {
+        int b = static_cast<int>((br[i] - GALAXY_BRIGHT_MIN) * binScale);
+        b = b < 0 ? 0 : (b >= GALAXY_BRIGHT_BINS ? GALAXY_BRIGHT_BINS - 1 : b);
+        ++d.brightHist[b];
+    }
+    return d;
+}
+
+// ----------------------
+// CSV stream: one row per sample, flushed as it goes so a run that is
+// killed still leaves its data
+// ----------------------
+struct GalaxyDiagnosticsCSV {
+    FILE* file = nullptr;
+
+    bool open(const char* path, const char* label = nullptr) {
+        file = std::fopen(path, "w");
+        if (!file) return false;
+        if (label) std::fprintf(file, "# %s\n", label);
+        std::fprintf(file, "step,time,energy,kinetic,potential,ang_mom,rms_z,captured,mean_brightness");
+        for (int b = 0; b < GALAXY_BRIGHT_BINS; ++b) std::fprintf(file, ",bright_%d", b);
+        std::fprintf(file, "\n");
+        return true;
+    }
+
+    void write(const GalaxyDiagnostics& d) {
+        if (!file) return;
+        std::fprintf(file, "%llu,%.6f,%.9g,%.9g,%.9g,%.9g,%.6g,%llu,%.6f",
+                     static_cast<unsigned long long>(d.step), d.time, d.energy, d.kinetic,
+                     d.potential, d.angMom, d.rmsZ, static_cast<unsigned long long>(d.captured),
+                     d.meanBrightness);
+        for (int b = 0; b < GALAXY_BRIGHT_BINS; ++b) std::fprintf(file, ",%u", d.brightHist[b]);
+        std::fprintf(file, "\n");
+        std::fflush(file);
+    }
+
+    void close() {
+        if (file) std::fclose(file);
+        file = nullptr;
+    }
+};
+
+// Sample every `every` steps (0 = off) into csv
+struct GalaxyDiagnosticsSampler {
+    int every = 0;
+    std::uint64_t steps = 0;
+    double time = 0.0;          // sim time (dt may change on reload)
+    GalaxyDiagnosticsCSV csv;
+
+    // Call once after each sim.step()
+    void afterStep(const GalaxySim& sim) {
+        ++steps;
+        time += sim.P.dt;
+        if (every > 0 && steps % every == 0) csv.write(measureGalaxy(sim, steps, time));
+    }
+};
@@ -0,0 +1,311 @@
+// ============================================
+// Galaxy viewer frame on the CPU
+// ============================================
+//
+// The two passes of main_galaxy.cpp without a GPU: the star splat
+// (one pixel per star, BlendAdd into the trail texture) and the lens
+// warp of lensing.frag. Both work on caller-owned 8-bit RGB buffers,
+// rows top-down, tightly packed (width * 3 bytes per row), so the
+// regression harness and bh_core can hand in their own memory.
+//
+// GalaxyProjection views the disk at any tilt: orthographic, turned by
+// yaw about the disk axis, then tilted about the screen's horizontal
+// (0 face-on as the viewer always was, 90 edge-on with +z up).
+//
+// lensWarpCPU mirrors lensing.frag line by line; keep them in step.
+// The shader works in gl_FragCoord (y up) and samples the trail
+// texture with nearest filtering, so a row here is flipped into that
+// frame and back.
+
+#pragma once
+
+#include "galaxy_sim.hpp"
+#include "tile_scheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// ----------------------
+// View projection
+// ----------------------
+struct GalaxyProjection {
+    float centerX = 0.0f, centerY = 0.0f;   // screen position of the hole
+    float scale   = 12.0f;                  // pixels per sim unit
+    float cosYaw  = 1.0f, sinYaw  = 0.0f;
+    float cosTilt = 1.0f, sinTilt = 0.0f;
+
+    GalaxyProjection() = default;
+    GalaxyProjection(float cx, float cy, float pixelsPerUnit, float tiltRadians, float yawRadians)
+        : centerX(cx), centerY(cy), scale(pixelsPerUnit),
+          cosYaw(std::cos(yawRadians)), sinYaw(std::sin(yawRadians)),
+          cosTilt(std::cos(tiltRadians)), sinTilt(std::sin(tiltRadians)) {}
+
+    bool faceOn() const { return cosYaw == 1.0f && cosTilt == 1.0f; }
+
+    // Screen pixel of sim point (x, y, z), row 0 = top
+    void project(float x, float y, float z, float& sx, float& sy) const {
+        float xr = x * cosYaw - y * sinYaw;
+        float yr = x * sinYaw + y * cosYaw;
+        sx = centerX + xr * scale;
+        sy = centerY + (yr * cosTilt - z * sinTilt) * scale;
+    }
+};
+
+// ----------------------
+// Star splat
+// ----------------------
+// Colored as main_galaxy.cpp's starColor (clamped per channel) and
+// added with the same 8-bit saturation as BlendAdd. 2D sims project
+// with z = 0.
+//
+// Star i's pixel (row-major index) and color add; false when it lands
+// off screen
+inline bool galaxyStarSplat(const GalaxySim& sim, const GalaxyProjection& view, bool hasZ, size_t i,
+                            int w, int h, std::uint32_t& pixel, std::uint8_t add[3]) {
+    float sx, sy;
+    view.project(sim.posX[i], sim.posY[i], hasZ ? sim.posZ[i] : 0.0f, sx, sy);
+    int px = static_cast<int>(std::floor(sx));
+    int py = static_cast<int>(std::floor(sy));
+    if (px < 0 || py < 0 || px >= w || py >= h) return false;
+
+    float speed = std::sqrt(sim.velX[i] * sim.velX[i] + sim.velY[i] * sim.velY[i]);
+    float t     = std::min(std::max(speed / 6.0f, 0.0f), 1.0f);
+    float glow  = std::min(sim.brightness[i], 2.0f);
+    add[0] = static_cast<std::uint8_t>(std::min(255, static_cast<int>(220 * glow)));
+    add[1] = static_cast<std::uint8_t>(std::min(255, static_cast<int>(140 * glow)));
+    add[2] = static_cast<std::uint8_t>(std::min(255, static_cast<int>(80 * glow + 60 * t)));
+    pixel  = static_cast<std::uint32_t>(py) * static_cast<std::uint32_t>(w) + static_cast<std::uint32_t>(px);
+    return true;
+}
+
+inline void addStarPixel(std::uint8_t* rgb, std::uint32_t pixel, const std::uint8_t add[3]) {
+    std::uint8_t* dst = &rgb[static_cast<size_t>(pixel) * 3];
+    for (int c = 0; c < 3; ++c) dst[c] = static_cast<std::uint8_t>(std::min(255, dst[c] + add[c]));
+}
+
+// Serial, in star order. Draws over what is in rgb.
+inline void splatGalaxyStars(const GalaxySim& sim, const GalaxyProjection& view, int w, int h,
+                             std::uint8_t* rgb) {
+    const bool hasZ = sim.posZ.size() == sim.posX.size();
+    for (size_t i = 0; i < sim.posX.size(); ++i) {
+        std::uint32_t pixel;
+        std::uint8_t add[3];
+        if (galaxyStarSplat(sim, view, hasZ, i, w, h, pixel, add)) addStarPixel(rgb, pixel, add);
+    }
+}
+
+// Binned: stars are projected in chunks on `threads` workers and
+// counted into tileSize x tileSize screen tiles, scattered into one
+// list per tile (a prefix sum over the counts gives each chunk its
+// slots), and each tile then adds its own stars, so no two workers
+// write a pixel. The adds are non-negative and saturate at 255, so
+// their order doesn't change the sum and the image matches the serial
+// splat byte for byte. tileSize <= 0 is the serial splat.
+//
+// Three passes over the stars instead of one, so it only pays with
+// cores to spare; auto_tuner.hpp's "splat" kernel picks per host.
+const int GALAXY_SPLAT_CHUNK = 4096;   // stars per projection work item
+
+inline void splatGalaxyStarsTiled(const GalaxySim& sim, const GalaxyProjection& view, int w, int h,
+                                  std::uint8_t* rgb, int tileSize, int threads) {
+    if (tileSize <= 0) {
+        splatGalaxyStars(sim, view, w, h, rgb);
+        return;
+    }
+    const bool hasZ   = sim.posZ.size() == sim.posX.size();
+    const int  stars  = static_cast<int>(sim.posX.size());
+    const int  tilesX = (w + tileSize - 1) / tileSize;
+    const int  tilesY = (h + tileSize - 1) / tileSize;
+    const int  tiles  = tilesX * tilesY;
+    const int  chunks = (stars + GALAXY_SPLAT_CHUNK - 1) / GALAXY_SPLAT_CHUNK;
+    if (tiles == 0 || chunks == 0) return;
+
+    // Star k's pixel and add, tile -1 when off screen
+    std::vector<std::uint32_t> pixel(stars);
+    std::vector<std::uint8_t>  add(static_cast<size_t>(stars) * 3);
+    std::vector<int>           tileOf(stars);
+    std::vector<int>           counts(static_cast<size_t>(chunks) * tiles, 0);   // [chunk][tile]
+
+    std::vector<RenderTile> work;
+    for (int k = 0; k < stars; k += GALAXY_SPLAT_CHUNK) {
+        RenderTile t;
+        t.x0 = k;
+        t.x1 = std::min(k + GALAXY_SPLAT_CHUNK, stars);
+        t.y1 = 1;
+        work.push_back(t);
+    }
+    std::vector<TileWorkerStats> stats;
+    runTilesWorkStealing(work, threads,
+        [&](const RenderTile& t, int) {
+            int* count = &counts[static_cast<size_t>(t.x0 / GALAXY_SPLAT_CHUNK) * tiles];
+            for (int k = t.x0; k < t.x1; ++k) {
+                tileOf[k] = -1;
+                if (!galaxyStarSplat(sim, view, hasZ, k, w, h, pixel[k], &add[static_cast<size_t>(k) * 3])) {
+                    continue;
+                }
+                int px = static_cast<int>(pixel[k] % static_cast<std::uint32_t>(w));
+                int py = static_cast<int>(pixel[k] / static_cast<std::uint32_t>(w));
+                tileOf[k] = (py / tileSize) * tilesX + px / tileSize;
+                ++count[tileOf[k]];
+            }
+        },
+        stats);
+
+    // counts -> each chunk's first slot in each tile's list
+    std::vector<int> tileStart(tiles + 1);
+    int total = 0;
+    for (int tile = 0; tile < tiles; ++tile) {
+        tileStart[tile] = total;
+        for (int c = 0; c < chunks; ++c) {
+            int& n = counts[static_cast<size_t>(c) * tiles + tile];
+            int first = total;
+            total += n;
+            n = first;
+        }
+    }
+    tileStart[tiles] = total;
+
+    std::vector<int> binned(total);
+    runTilesWorkStealing(work, threads,
+        [&](const RenderTile& t, int) {
+            int* slot = &counts[static_cast<size_t>(t.x0 / GALAXY_SPLAT_CHUNK) * tiles];
+            for (int k = t.x0; k < t.x1; ++k) {
+                if (tileOf[k] >= 0) binned[slot[tileOf[k]]++] = k;
+            }
+        },
+        stats);
+
+    // One work item per screen tile, costed by its star count
+    std::vector<RenderTile> screen;
+    for (int tile = 0; tile < tiles; ++tile) {
+        RenderTile t;
+        t.x0   = tileStart[tile];
+        t.x1   = tileStart[tile + 1];
+        t.y1   = 1;
+        t.cost = static_cast<float>(t.x1 - t.x0);
+        if (t.x1 > t.x0) screen.push_back(t);
+    }
+    runTilesWorkStealing(screen, threads,
+        [&](const RenderTile& t, int) {
+            for (int j = t.x0; j < t.x1; ++j) {
+                int k = binned[j];
+                addStarPixel(rgb, pixel[k], &add[static_cast<size_t>(k) * 3]);
+            }
+        },
+        stats);
+}
+
+// Face-on and centered, scale pixels per sim unit
+inline void splatGalaxyStars(const GalaxySim& sim, int w, int h, float scale, std::uint8_t* rgb) {
+    splatGalaxyStars(sim, GalaxyProjection(w / 2.0f, h / 2.0f, scale, 0.0f, 0.0f), w, h, rgb);
+}
+
+// ----------------------
+// Lens warp (lensing.frag uniforms, defaults = scene.cfg)
+// ----------------------
+struct LensWarpParams {
+    float centerX = 640.0f;   // black hole center in pixels, row 0 = top
+    float centerY = 360.0f;
+
+    float lensStrength = 18000.0f;
+    float ringRadius   = 110.0f;
+    float ringWidth    = 3.0f;
+    float ringBoost    = 3.5f;
+    float dopplerBoost = 0.7f;
+    float tint[3]      = { 1.1f, 1.05f, 0.95f };
+
+    float verticalWarpStrength = 40.0f;
+    float verticalWarpFalloff  = 260.0f;
+    float shearStrength        = 9000.0f;
+    float ringEccentricity     = 1.4f;
+};
+
+// Lens values from the scene file (the center stays the caller's)
+inline void applySceneLens(LensWarpParams& p, const SceneParams& s) {
+    p.lensStrength = s.lensStrength;
+    p.ringRadius   = s.ringRadius;
+    p.ringWidth    = s.ringWidth;
+    p.ringBoost    = s.ringBoost;
+    p.dopplerBoost = s.dopplerBoost;
+    for (int c = 0; c < 3; ++c) p.tint[c] = s.tint[c];
+    p.verticalWarpStrength = s.verticalWarpStrength;
+    p.verticalWarpFalloff  = s.verticalWarpFalloff;
+    p.shearStrength        = s.shearStrength;
+    p.ringEccentricity     = s.ringEccentricity;
+}
+
+inline float lensSmoothstep(float e0, float e1, float x) {
+    float t = std::min(std::max((x - e0) / (e1 - e0), 0.0f), 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+// Rows [rowBegin, rowEnd) of dst from the whole of src (a gather: src
+// and dst must not overlap). Callers split rows across threads.
+inline void lensWarpRowsCPU(const LensWarpParams& p, const std::uint8_t* src, std::uint8_t* dst,
+                            int w, int h, int rowBegin, int rowEnd) {
+    const float resX = static_cast<float>(w), resY = static_cast<float>(h);
+    const float centerX = p.centerX;
+    const float centerY = resY - p.centerY;   // to gl_FragCoord (y up)
+
+    for (int row = rowBegin; row < rowEnd; ++row) {
+        const float fragY = resY - row - 0.5f;
+        for (int x = 0; x < w; ++x) {
+            const float fragX = x + 0.5f;
+            float toCx = fragX - centerX, toCy = fragY - centerY;
+            float r  = std::sqrt(toCx * toCx + toCy * toCy) + 0.0001f;
+            float nx = toCx / r, ny = toCy / r;
+
+            float u = fragX, v = fragY;
+
+            // 1. Radial lensing
+            float lens = p.lensStrength / (r * r + 20.0f);
+            u -= nx * lens;
+            v -= ny * lens;
+
+            // 2. Frame-drag shear
+            float shear = p.shearStrength / (r * r + 20000.0f);
+            u += -ny * shear;
+            v +=  nx * shear;
+
+            // 3. Vertical warp
+            float angle = std::atan2(toCy, toCx);
+            float lift  = p.verticalWarpStrength * std::exp(-r / p.verticalWarpFalloff) * std::sin(angle);
+            v += lift;
+
+            u = std::min(std::max(u, 0.0f), resX - 1.0f);
+            v = std::min(std::max(v, 0.0f), resY - 1.0f);
+
+            // Nearest texel; texture row 0 is the bottom
+            int tx = std::min(static_cast<int>(u), w - 1);
+            int ty = h - 1 - std::min(static_cast<int>(v), h - 1);
+            const std::uint8_t* s = &src[(static_cast<size_t>(ty) * w + tx) * 3];
+            float color[3] = { s[0] / 255.0f, s[1] / 255.0f, s[2] / 255.0f };
+
+            float edge = std::min(fragX, std::min(fragY, std::min(resX - fragX, resY - fragY)));
+            float edgeFade = lensSmoothstep(10.0f, 40.0f, edge);
+
+            // 4. Photon ring + horizon
+            float ringX = toCx, ringY = toCy * p.ringEccentricity;
+            float rRing = std::sqrt(ringX * ringX + ringY * ringY);
+            float ring  = std::exp(-std::fabs(rRing - p.ringRadius) / p.ringWidth);
+            bool horizon = r < p.ringRadius * 0.35f;
+
+            // 5. Doppler, 6. tint
+            float dop = 1.0f + p.dopplerBoost * std::cos(angle);
+
+            std::uint8_t* d = &dst[(static_cast<size_t>(row) * w + x) * 3];
+            for (int c = 0; c < 3; ++c) {
+                float col = horizon ? 0.0f : color[c] * edgeFade + ring * p.ringBoost;
+                col *= dop * p.tint[c];
+                col = std::min(std::max(col, 0.0f), 1.0f);
+                d[c] = static_cast<std::uint8_t>(col * 255.0f + 0.5f);
+            }
+        }
+    }
+}
+
+inline void lensWarpCPU(const LensWarpParams& p, const std::uint8_t* src, std::uint8_t* dst, int w, int h) {
+    lensWarpRowsCPU(p, src, dst, w, h, 0, h);
+}
@@ -0,0 +1,392 @@
+// ============================================
+// Galaxy simulation (SoA), shared by main_galaxy.cpp and the headless
+// tools
+// ============================================
+//
+// Stars orbit a softened point mass (the black hole) inside a flat-
+// rotation-curve dark matter halo. Viscosity heats and slows them;
+// stars inside horizonRadius respawn on the outer ring.
+//
+// 3D mode (P.threeD at init): posZ / velZ join the SoA arrays, the
+// hole and halo pull along the 3D radius, and the disk's own gravity
+// is a harmonic restoring force toward z = 0 (verticalRestoring). Stars
+// start within +-thickness of the plane. In 2D mode the z arrays stay
+// empty and step() runs the original 2D loop, so the 2D path does the
+// same work as before.
+
+#pragma once
+
+#include "scene_config.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// ----------------------
+// Simple random helper
+// ----------------------
+// 24 bits straight from mt19937, whose sequence the standard fixes;
+// uniform_real_distribution's output differs between standard libraries
+inline float randFloat(std::mt19937& rng, float a, float b) {
+    float u = static_cast<float>(rng() >> 8) * (1.0f / 16777216.0f);
+    return a + (b - a) * u;
+}
+
+// ----------------------
+// Simulation parameters
+// ----------------------
+enum SimIntegrator {
+    SIM_EULER    = 0,   // semi-implicit Euler: kick, then drift (one force eval)
+    SIM_LEAPFROG = 1    // kick-drift-kick, second order (two force evals)
+};
+
+struct SimParams {
+    float G         = 2.0f;     // grav. constant (sim units)
+    float M_bh      = 400.0f;   // black hole mass
+    float softening = 0.5f;     // avoids infinite accel at center
+
+    float v0        = 2.2f;     // dark matter flat-curve velocity
+    float r_core    = 1.2f;     // halo core radius
+
+    float dt        = 0.01f;    // time step
+    int   integrator = SIM_EULER;
+
+    // ------- PHASE 3: Accretion Disk Parameters -------
+    float viscosityBase  = 0.003f;   // base friction strength
+    float viscosityCore  = 1.0f;     // prevents infinite viscosity near r → 0
+    float heatScale      = 0.0012f;  // controls brightness generation
+    float brightnessCool = 0.997f;   // glow cool-down factor
+    float horizonRadius  = 7.0f;     // event horizon swallow radius
+    float respawnRMin    = 18.0f;    // outer disk respawn range
+    float respawnRMax    = 28.0f;
+
+    // ------- 3D mode (read by init / resize) -------
+    int   threeD            = 0;       // 1: z position / velocity
+    float thickness         = 0.6f;    // stars start within +-thickness of the plane
+    float verticalRestoring = 0.5f;    // disk self-gravity: a_z -= this * z
+};
+
+// Physics constants from the scene file
+inline void applySceneSim(SimParams& P, const SceneParams& s) {
+    P.G              = s.G;
+    P.M_bh           = s.M_bh;
+    P.softening      = s.softening;
+    P.v0             = s.v0;
+    P.r_core         = s.r_core;
+    P.dt             = s.dt;
+    P.integrator     = static_cast<int>(s.integrator);
+    P.viscosityBase  = s.viscosityBase;
+    P.viscosityCore  = s.viscosityCore;
+    P.heatScale      = s.heatScale;
+    P.brightnessCool = s.brightnessCool;
+    P.horizonRadius  = s.horizonRadius;
+    P.respawnRMin    = s.respawnRMin;
+    P.respawnRMax    = s.respawnRMax;
+    P.threeD         = s.galaxy3D != 0.0f ? 1 : 0;
+    P.thickness      = s.galaxyThickness;
+    P.verticalRestoring = s.verticalRestoring;
+}
+
+// ----------------------
+// Galaxy simulation (SoA)
+// ----------------------
+struct GalaxySim {
+    SimParams P;
+
+    std::vector<float> posX;
+    std::vector<float> posY;
+    std::vector<float> velX;
+    std::vector<float> velY;
+    std::vector<float> brightness;
+    std::vector<float> posZ;   // 3D mode only, empty in 2D
+    std::vector<float> velZ;
+
+    bool threeD = false;          // layout of the current arrays (P.threeD at init)
+    std::uint64_t captured = 0;   // stars swallowed (and respawned) since init
+
+    // Init and respawn draw from the sim's own generator, so sims on
+    // different threads don't share state. Seeded from random_device
+    // unless seed() pins it (headless golden runs)
+    std::mt19937 rng{ std::random_device{}() };
+
+    void seed(std::uint32_t s) { rng.seed(s); }
+
+    // ---------------------------------------------
+    // Respawn particle when it falls into the BH
+    // ---------------------------------------------
+    void respawnAtOuterRing(int i) {
+        float u = randFloat(rng, 0.0f, 1.0f);
+        float r = P.respawnRMin + (P.respawnRMax - P.respawnRMin) * u;
+        float theta = randFloat(rng, 0.0f, 2.0f * 3.14159265f);
+
+        float x = r * std::cos(theta);
+        float y = r * std::sin(theta);
+
+        posX[i] = x;
+        posY[i] = y;
+
+        float dist = std::max(std::sqrt(x * x + y * y), 0.1f);
+        float rx = x / dist;
+        float ry = y / dist;
+        float tx = -ry;
+        float ty =  rx;
+
+        float v_bh = std::sqrt(P.G * P.M_bh / (dist + P.softening)); 
+        float v_dm = P.v0;
+        float v_circ = std::sqrt(v_bh * v_bh + v_dm * v_dm);
+
+        float jitter = randFloat(rng, -0.05f, 0.05f);
+        float v = v_circ * 1.4f * (1.0f + jitter);
+
+        velX[i] = tx * v;
+        velY[i] = ty * v;
+
+        brightness[i] = 0.6f; 
+
+        if (threeD) {
+            posZ[i] = randFloat(rng, -P.thickness, P.thickness);
+            velZ[i] = 0.0f;
+        }
+    }
+
+    // ---------------------------------------------
+    // Fresh star in the initial disk
+    // ---------------------------------------------
+    void spawnInDisk(int i) {
+        const float R_MIN = 2.0f;
+        const float R_MAX = 30.0f;
+
+        float u = randFloat(rng, 0.0f, 1.0f);
+        float r = R_MIN + (R_MAX - R_MIN) * std::sqrt(u);
+        float theta = randFloat(rng, 0.0f, 2.0f * 3.14159265f);
+
+        float x = r * std::cos(theta);
+        float y = r * std::sin(theta);
+        posX[i] = x;
+        posY[i] = y;
+
+        float dist = std::max(std::sqrt(x * x + y * y), 0.1f);
+        float rx = x / dist;
+        float ry = y / dist;
+        float tx = -ry;
+        float ty =  rx;
+
+        float v_bh = std::sqrt(P.G * P.M_bh / (dist + P.softening));
+        float v_dm = P.v0;
+        float v_circ = std::sqrt(v_bh * v_bh + v_dm * v_dm);
+
+        float jitter = randFloat(rng, -0.05f, 0.05f);
+        float v = v_circ * 1.6f * (1.0f + jitter);
+
+        velX[i] = tx * v;
+        velY[i] = ty * v;
+
+        brightness[i] = randFloat(rng, 0.5f, 1.0f);
+
+        // Drawn after the 2D values, so 2D runs keep their sequence
+        if (threeD) {
+            posZ[i] = P.thickness * (randFloat(rng, -0.5f, 0.5f) + randFloat(rng, -0.5f, 0.5f));
+            velZ[i] = 0.0f;
+        }
+    }
+
+    void init(int count) {
+        captured = 0;
+        threeD = P.threeD != 0;
+        posX.resize(count);
+        posY.resize(count);
+        velX.resize(count);
+        velY.resize(count);
+        brightness.resize(count);
+        posZ.assign(threeD ? count : 0, 0.0f);
+        velZ.assign(threeD ? count : 0, 0.0f);
+
+        for (int i = 0; i < count; ++i) spawnInDisk(i);
+    }
+
+    // Change the star count without a reseed: fewer drops the tail,
+    // more adds fresh disk stars. The quality controller moves this
+    // while the galaxy runs, so the survivors keep their orbits
+    void resize(int count) {
+        const int old = static_cast<int>(posX.size());
+        posX.resize(count);
+        posY.resize(count);
+        velX.resize(count);
+        velY.resize(count);
+        brightness.resize(count);
+        if (threeD) {
+            posZ.resize(count);
+            velZ.resize(count);
+        }
+
+        for (int i = old; i < count; ++i) spawnInDisk(i);
+    }
+
+    // Pull of the softened black hole + halo at (x, y)
+    void acceleration(float x, float y, float& ax, float& ay) const {
+        float dist = std::sqrt(x * x + y * y) + 1e-3f;
+        float invDist = 1.0f / dist;
+
+        // direction towards center
+        float dx = -x * invDist;
+        float dy = -y * invDist;
+
+        // black hole acceleration
+        float a_bh_mag = P.G * P.M_bh / (dist * dist + P.softening);
+        float a_bh_x = dx * a_bh_mag;
+        float a_bh_y = dy * a_bh_mag;
+
+        // dark matter halo: flat rotation
+        float a_dm_mag = (P.v0 * P.v0) / (dist + P.r_core);
+        float a_dm_x = dx * a_dm_mag;
+        float a_dm_y = dy * a_dm_mag;
+
+        ax = a_bh_x + a_dm_x;
+        ay = a_bh_y + a_dm_y;
+    }
+
+    // Pull of the hole + halo along the 3D radius, plus the disk's
+    // restoring force toward the plane
+    void acceleration3D(float x, float y, float z, float& ax, float& ay, float& az) const {
+        float dist = std::sqrt(x * x + y * y + z * z) + 1e-3f;
+        float invDist = 1.0f / dist;
+
+        float a_mag = P.G * P.M_bh / (dist * dist + P.softening)
+                    + (P.v0 * P.v0) / (dist + P.r_core);
+        ax = -x * invDist * a_mag;
+        ay = -y * invDist * a_mag;
+        az = -z * invDist * a_mag - P.verticalRestoring * z;
+    }
+
+    void step() {
+        if (threeD) step3D();
+        else        step2D();
+    }
+
+    void step2D() {
+        const int n = static_cast<int>(posX.size());
+        for (int i = 0; i < n; ++i) {
+            float x = posX[i];
+            float y = posY[i];
+
+            float dist = std::sqrt(x * x + y * y) + 1e-3f;
+
+            float ax, ay;
+            acceleration(x, y, ax, ay);
+
+            if (P.integrator == SIM_LEAPFROG) {
+                // Half kick, drift, half kick at the new position
+                float halfDt = 0.5f * P.dt;
+                velX[i] += ax * halfDt;
+                velY[i] += ay * halfDt;
+
+                posX[i] += velX[i] * P.dt;
+                posY[i] += velY[i] * P.dt;
+
+                acceleration(posX[i], posY[i], ax, ay);
+                velX[i] += ax * halfDt;
+                velY[i] += ay * halfDt;
+            } else {
+                velX[i] += ax * P.dt;
+                velY[i] += ay * P.dt;
+
+                posX[i] += velX[i] * P.dt;
+                posY[i] += velY[i] * P.dt;
+            }
+
+            // --------------------------------------------------
+            // ------- PHASE 3: ACCRETION DISK PHYSICS -----------
+            // --------------------------------------------------
+
+            float eta = P.viscosityBase / (dist + P.viscosityCore);
+            if (eta > 0.02f) eta = 0.02f;
+
+            float vx = velX[i];
+            float vy = velY[i];
+            float speed2 = vx*vx + vy*vy;
+
+            float heat = P.heatScale * eta * speed2;
+            brightness[i] += heat;
+
+            if (brightness[i] > 2.0f) brightness[i] = 2.0f;
+
+            float damp = 1.0f - eta;
+            velX[i] *= damp;
+            velY[i] *= damp;
+
+            brightness[i] *= P.brightnessCool;
+            if (brightness[i] < 0.2f) brightness[i] = 0.2f;
+
+            if (dist < P.horizonRadius) {
+                respawnAtOuterRing(i);
+                ++captured;
+            }
+        }
+    }
+
+    // step2D with z: same integrators, viscosity on the 3D speed,
+    // capture inside the 3D horizon radius
+    void step3D() {
+        const int n = static_cast<int>(posX.size());
+        for (int i = 0; i < n; ++i) {
+            float x = posX[i];
+            float y = posY[i];
+            float z = posZ[i];
+
+            float dist = std::sqrt(x * x + y * y + z * z) + 1e-3f;
+
+            float ax, ay, az;
+            acceleration3D(x, y, z, ax, ay, az);
+
+            if (P.integrator == SIM_LEAPFROG) {
+                float halfDt = 0.5f * P.dt;
+                velX[i] += ax * halfDt;
+                velY[i] += ay * halfDt;
+                velZ[i] += az * halfDt;
+
+                posX[i] += velX[i] * P.dt;
+                posY[i] += velY[i] * P.dt;
+                posZ[i] += velZ[i] * P.dt;
+
+                acceleration3D(posX[i], posY[i], posZ[i], ax, ay, az);
+                velX[i] += ax * halfDt;
+                velY[i] += ay * halfDt;
+                velZ[i] += az * halfDt;
+            } else {
+                velX[i] += ax * P.dt;
+                velY[i] += ay * P.dt;
+                velZ[i] += az * P.dt;
+
+                posX[i] += velX[i] * P.dt;
+                posY[i] += velY[i] * P.dt;
+                posZ[i] += velZ[i] * P.dt;
+            }
+
+            float eta = P.viscosityBase / (dist + P.viscosityCore);
+            if (eta > 0.02f) eta = 0.02f;
+
+            float vx = velX[i];
+            float vy = velY[i];
+            float vz = velZ[i];
+            float speed2 = vx*vx + vy*vy + vz*vz;
+
+            brightness[i] += P.heatScale * eta * speed2;
+            if (brightness[i] > 2.0f) brightness[i] = 2.0f;
+
+            float damp = 1.0f - eta;
+            velX[i] *= damp;
+            velY[i] *= damp;
+            velZ[i] *= damp;
+
+            brightness[i] *= P.brightnessCool;
+            if (brightness[i] < 0.2f) brightness[i] = 0.2f;
+
+            if (dist < P.horizonRadius) {
+                respawnAtOuterRing(i);
+                ++captured;
+            }
+        }
+    }
+};
@@ -0,0 +1,282 @@
+// ============================================
+// Geodesic G-buffer cache for the CPU renderer
+// ============================================
+
+#pragma once
+
+#include "bh_raymarch_cpu.hpp"
+#include "edge_supersample.hpp"
+#include "kerr_geodesic.hpp"
+#include "progressive_refine.hpp"
+#include "schwarzschild_lut.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// ----------------------
+// Geodesic G-buffer: trace once, reshade every frame
+// ----------------------
+// With a still camera only uTime changes between frames, and it only
+// enters through the spinning band. The cache keeps, per pixel, the hit
+// type, diskR, disk angle and the time-independent brightness (radial
+// falloff x Doppler) and re-traces only when a uniform that affects the
+// geodesics or the baked brightness changes.
+//
+// With aa.budget > 0 pixels on a hit-type / diskR discontinuity also
+// keep a few sub-pixel samples (edge_supersample.hpp); shade() averages
+// them, so the extra rays are paid once per trace, not per frame.
+//
+// With progressive = true a change traces only phase 0 (one pixel per
+// 4x4 block, progressive_refine.hpp) and copies it over the block; each
+// later update() with unchanged params adds one phase until the buffer
+// matches a full trace. Edge samples are traced once it's complete.
+
+// True if a and b trace identical rays and bake identical brightness
+// (time, diskRotation and diskColorBase are applied at shade time).
+inline bool sameGeodesics(const RayMarchParams& a, const RayMarchParams& b) {
+    return a.resolutionX == b.resolutionX && a.resolutionY == b.resolutionY &&
+           a.camPos.x == b.camPos.x && a.camPos.y == b.camPos.y && a.camPos.z == b.camPos.z &&
+           a.camTarget.x == b.camTarget.x && a.camTarget.y == b.camTarget.y &&
+           a.camTarget.z == b.camTarget.z &&
+           a.fovFactor == b.fovFactor &&
+           a.bhRadius == b.bhRadius && a.diskInner == b.diskInner && a.diskOuter == b.diskOuter &&
+           a.diskHeight == b.diskHeight && a.diskTilt == b.diskTilt &&
+           a.gravStrength == b.gravStrength && a.stepSize == b.stepSize &&
+           a.stepTolerance == b.stepTolerance && a.spin == b.spin &&
+           a.influenceRadius == b.influenceRadius && a.diskModel == b.diskModel;
+}
+
+enum GeodesicTracer {
+    TRACE_MARCH             = 0,   // CPU port of the shader's ray march
+    TRACE_SCHWARZSCHILD_LUT = 1,   // O(1) table lookups, true GR bending
+    TRACE_KERR              = 2    // spinning hole, Carter-constant tracer
+};
+
+struct GeodesicCache {
+    int  width  = 0;
+    int  height = 0;
+    bool valid  = false;
+    RayMarchParams traced;        // params the buffer was traced with
+
+    GeodesicTracer tracer = TRACE_MARCH;
+    GeodesicTracer tracedWith = TRACE_MARCH;
+    int packetWidth = 8;          // TRACE_MARCH rays per packet, 8 or 16
+    SchwarzschildLut lut;
+
+    std::vector<std::uint8_t> hit;
+    std::vector<float> diskR;
+    std::vector<float> angle;     // atan(diskZc, diskXc)
+    std::vector<float> baseBright;
+
+    // Edge supersampling: aaPixel[k] owns samples [k * spp, (k + 1) * spp)
+    EdgeAAConfig aa;
+    EdgeAAConfig tracedAA;
+    EdgeAAStats  aaStats;
+    std::vector<int> aaPixel;
+    std::vector<std::uint8_t> aaHit;
+    std::vector<float> aaAngle;
+    std::vector<float> aaBaseBright;
+
+    // Progressive refinement: next phase to trace, PROGRESSIVE_PHASES = done
+    bool progressive = false;
+    int  phase = PROGRESSIVE_PHASES;
+
+    void invalidate() { valid = false; }
+    bool refining() const { return valid && phase < PROGRESSIVE_PHASES; }
+
+    // One ray with the selected tracer (sub-pixel samples)
+    RayResult traceOne(const RayMarchParams& p, const RayFrame& f, float fragX, float fragY) const {
+        if (tracer == TRACE_SCHWARZSCHILD_LUT) return traceRayLut(p, f, lut, fragX, fragY);
+        if (tracer == TRACE_KERR)              return traceRayKerr(p, f, fragX, fragY);
+        return traceRayReference(p, f, fragX, fragY);
+    }
+
+    // Re-trace (or refine) if needed; returns true if it traced anything
+    bool update(const RayMarchParams& p, int tileSize, int threads) {
+        bool same = valid && tracer == tracedWith && sameGeodesics(p, traced) &&
+                    aa.budget == tracedAA.budget && aa.samplesPerPixel == tracedAA.samplesPerPixel &&
+                    aa.diskREdge == tracedAA.diskREdge;
+        if (same && phase >= PROGRESSIVE_PHASES) return false;
+
+        RayFrame f = makeRayFrame(p);
+        if (same) {
+            // Still camera: one more phase, or all of them if progressive
+            // was switched off halfway
+            std::vector<RenderTile> tiles = makeTileGrid(width, height, tileSize);
+            estimateRayMarchTileCosts(p, f, tiles);
+            int last = progressive ? phase + 1 : PROGRESSIVE_PHASES;
+            for (; phase < last; ++phase) tracePhase(p, f, tiles, phase, threads);
+            if (phase == PROGRESSIVE_PHASES) traceEdges(p, f, threads);
+            return true;
+        }
+
+        width  = static_cast<int>(p.resolutionX);
+        height = static_cast<int>(p.resolutionY);
+        const size_t n = static_cast<size_t>(width) * height;
+        hit.assign(n, RAY_MISS);
+        diskR.assign(n, 0.0f);
+        angle.assign(n, 0.0f);
+        baseBright.assign(n, 0.0f);
+
+        std::vector<RenderTile> tiles = makeTileGrid(width, height, tileSize);
+        estimateRayMarchTileCosts(p, f, tiles);
+
+        if (tracer == TRACE_SCHWARZSCHILD_LUT) ensureLut(lut, p);
+
+        traced = p;
+        tracedWith = tracer;
+        tracedAA = aa;
+        valid = true;
+
+        if (progressive) {
+            tracePhase(p, f, tiles, 0, threads);
+            fillBlocks();
+            phase = 1;
+            traceEdges(p, f, threads, false);
+            return true;
+        }
+
+        auto store = [&](int x, int y, const RayResult& res) { storeResult(p, f, x, y, res); };
+
+        std::vector<TileWorkerStats> stats;
+        runTilesWorkStealing(tiles, threads,
+            [&](const RenderTile& t, int) {
+                if (tracer == TRACE_SCHWARZSCHILD_LUT) {
+                    traceRectLut(p, f, lut, t.x0, t.y0, t.x1, t.y1, store);
+                } else if (tracer == TRACE_KERR) {
+                    traceRectKerr(p, f, t.x0, t.y0, t.x1, t.y1, store);
+                } else if (packetWidth == 16) {
+                    traceRectPacket<16>(p, f, t.x0, t.y0, t.x1, t.y1, store);
+                } else {
+                    traceRectPacket<8>(p, f, t.x0, t.y0, t.x1, t.y1, store);
+                }
+            },
+            stats);
+
+        phase = PROGRESSIVE_PHASES;
+        traceEdges(p, f, threads);
+        return true;
+    }
+
+    void storeResult(const RayMarchParams& p, const RayFrame& f, int x, int y, const RayResult& res) {
+        size_t i = static_cast<size_t>(y) * width + x;
+        hit[i] = res.hit;
+        diskR[i]      = res.hit == RAY_DISK ? res.diskR : 0.0f;
+        angle[i]      = res.hit == RAY_DISK ? std::atan2(res.diskZc, res.diskXc) : 0.0f;
+        baseBright[i] = res.hit == RAY_DISK ? diskBaseBrightness(p, f, res) : 0.0f;
+    }
+
+    // Trace the pixels of one progressive phase
+    void tracePhase(const RayMarchParams& p, const RayFrame& f,
+                    const std::vector<RenderTile>& tiles, int k, int threads) {
+        auto store = [&](int x, int y, const RayResult& res) { storeResult(p, f, x, y, res); };
+
+        std::vector<TileWorkerStats> stats;
+        runTilesWorkStealing(tiles, threads,
+            [&](const RenderTile& t, int) {
+                if (tracer == TRACE_MARCH) {
+                    if (packetWidth == 16) traceRectPhasePacket<16>(p, f, t.x0, t.y0, t.x1, t.y1, k, store);
+                    else                   traceRectPhasePacket<8>(p, f, t.x0, t.y0, t.x1, t.y1, k, store);
+                    return;
+                }
+                forEachPhasePixel(t.x0, t.y0, t.x1, t.y1, k, [&](int x, int y) {
+                    store(x, y, traceOne(p, f, x + 0.5f, height - y - 0.5f));
+                });
+            },
+            stats);
+    }
+
+    // Copy each block's phase-0 pixel over the rest of the block
+    void fillBlocks() {
+        for (int y = 0; y < height; ++y) {
+            int ay = y & ~(PROGRESSIVE_BLOCK - 1);
+            for (int x = 0; x < width; ++x) {
+                size_t i = static_cast<size_t>(y) * width + x;
+                size_t a = static_cast<size_t>(ay) * width + (x & ~(PROGRESSIVE_BLOCK - 1));
+                hit[i]        = hit[a];
+                diskR[i]      = diskR[a];
+                angle[i]      = angle[a];
+                baseBright[i] = baseBright[a];
+            }
+        }
+    }
+
+    // enabled = false only clears the samples (buffer still refining)
+    void traceEdges(const RayMarchParams& p, const RayFrame& f, int threads, bool enabled = true) {
+        EdgeAAConfig cfg = aa;
+        if (!enabled) cfg.budget = 0;
+        aaPixel = selectEdgePixels(width, height, hit.data(), diskR.data(), RAY_DISK,
+                                   p.diskOuter - p.diskInner, cfg, aaStats);
+        const int spp = edgeAASamples(aa);
+        const size_t ns = aaPixel.size() * spp;
+        aaHit.assign(ns, RAY_MISS);
+        aaAngle.assign(ns, 0.0f);
+        aaBaseBright.assign(ns, 0.0f);
+        if (aaPixel.empty()) return;
+
+        // Edge pixels in chunks of 64 through the same scheduler (index
+        // ranges in x; they cluster near the hole, so costs are similar)
+        const int chunk = 64;
+        std::vector<RenderTile> work;
+        for (int k = 0; k < static_cast<int>(aaPixel.size()); k += chunk) {
+            RenderTile t;
+            t.x0 = k;
+            t.x1 = std::min(k + chunk, static_cast<int>(aaPixel.size()));
+            t.y1 = 1;
+            work.push_back(t);
+        }
+
+        std::vector<TileWorkerStats> stats;
+        runTilesWorkStealing(work, threads,
+            [&](const RenderTile& t, int) {
+                for (int k = t.x0; k < t.x1; ++k) {
+                    int x = aaPixel[k] % width;
+                    int y = aaPixel[k] / width;
+                    for (int s = 0; s < spp; ++s) {
+                        RayResult res = traceOne(p, f, x + EDGE_AA_OFFSETS[s][0],
+                                                 height - y - EDGE_AA_OFFSETS[s][1]);
+                        size_t j = static_cast<size_t>(k) * spp + s;
+                        aaHit[j] = res.hit;
+                        if (res.hit == RAY_DISK) {
+                            aaAngle[j]      = std::atan2(res.diskZc, res.diskXc);
+                            aaBaseBright[j] = diskBaseBrightness(p, f, res);
+                        }
+                    }
+                }
+            },
+            stats);
+    }
+
+    // Cheap per-frame pass: only the spinning band depends on time
+    void shade(const RayMarchParams& p, std::vector<float>& rgb) const {
+        const size_t n = static_cast<size_t>(width) * height;
+        for (size_t i = 0; i < n; ++i) {
+            float* px = &rgb[i * 3];
+            if (hit[i] != RAY_DISK) {
+                px[0] = px[1] = px[2] = 0.0f;
+                continue;
+            }
+            float brightness = baseBright[i] * diskBandFactor(p, angle[i]);
+            px[0] = p.diskColorBase.x * brightness;
+            px[1] = p.diskColorBase.y * brightness;
+            px[2] = p.diskColorBase.z * brightness;
+        }
+
+        // Edge pixels: average the pixel's own ray with its sub-samples
+        const int spp = edgeAASamples(tracedAA);
+        for (size_t k = 0; k < aaPixel.size(); ++k) {
+            size_t i = static_cast<size_t>(aaPixel[k]);
+            float sum = hit[i] == RAY_DISK ? baseBright[i] * diskBandFactor(p, angle[i]) : 0.0f;
+            for (int s = 0; s < spp; ++s) {
+                size_t j = k * spp + s;
+                if (aaHit[j] == RAY_DISK) sum += aaBaseBright[j] * diskBandFactor(p, aaAngle[j]);
+            }
+            float brightness = sum / (spp + 1);
+            float* px = &rgb[i * 3];
+            px[0] = p.diskColorBase.x * brightness;
+            px[1] = p.diskColorBase.y * brightness;
+            px[2] = p.diskColorBase.z * brightness;
+        }
+    }
+};
@@ -0,0 +1,276 @@
+// ============================================
+// Kerr (spinning) black hole geodesic tracer
+// ============================================
+//
+// Photons in Kerr have three constants of motion besides the null
+// condition: energy E, axial angular momentum L and the Carter constant
+// Q. With E = 1, xi = L/E, eta = Q/E^2 and Mino time lambda
+// (d tau = Sigma d lambda) the motion separates into
+//
+//   (dr/dl)^2     = R(r)     = (r^2 + a^2 - a xi)^2 - Delta (eta + (xi - a)^2)
+//   (dtheta/dl)^2 = Th(theta) = eta + a^2 cos^2 - xi^2 cot^2
+//   dphi/dl       = a/Delta (r^2 + a^2 - a xi) - a + xi / sin^2
+//
+// We integrate the second-order form r'' = R'/2, theta'' = Th'/2 (no
+// square-root sign flips at turning points), i.e. a 5-variable state
+// (r, theta, phi, r', theta') instead of the full 8D geodesic equation.
+//
+// Geometry: the spin axis is the disk normal, so the disk is theta = pi/2.
+// Boyer-Lindquist coordinates embed as oblate spheroidal coordinates,
+//   x = sqrt(r^2 + a^2) sin(theta) cos(phi), z = r cos(theta)
+// in the disk frame (diskX, diskZ, diskNormal). The camera is a zero
+// angular momentum observer (ZAMO). Mass M = bhRadius / 2 like the
+// Schwarzschild table, so spin = 0 reproduces schwarzschild_lut.hpp.
+//
+// bh_raymarch.frag has the same tracer behind uBendingModel = 1.
+
+#pragma once
+
+#include "bh_raymarch_cpu.hpp"
+
+#include <cmath>
+#include <vector>
+
+const int   KERR_MAX_STEPS = 300;
+const float KERR_MIN_STEP  = 0.02f;   // affine length per step, near the hole
+const float KERR_MAX_STEP  = 2.0f;    // ... and far away
+const float KERR_MAX_ANGLE = 0.1f;    // max dtheta / dphi per step (radians)
+
+struct KerrRay {
+    // Constants of motion (E = 1)
+    double xi = 0.0, eta = 0.0;
+    // State in Mino time
+    double r = 0.0, th = 0.0, ph = 0.0, pr = 0.0, pth = 0.0;
+};
+
+inline double kerrMass(const RayMarchParams& p) { return 0.5 * p.bhRadius; }
+
+inline double kerrHorizon(double M, double a) {
+    return M + std::sqrt(std::fmax(M * M - a * a, 0.0));
+}
+
+// ----------------------
+// Disk-frame Cartesian <-> Boyer-Lindquist
+// ----------------------
+inline void kerrToBL(double a, double x, double y, double z,
+                     double& r, double& th, double& ph) {
+    double R2 = x * x + y * y + z * z;
+    double w = R2 - a * a;
+    double r2 = 0.5 * (w + std::sqrt(w * w + 4.0 * a * a * z * z));
+    r  = std::sqrt(std::fmax(r2, 1e-12));
+    th = std::acos(std::fmax(-1.0, std::fmin(1.0, z / r)));
+    ph = std::atan2(y, x);
+}
+
+inline void kerrFromBL(double a, double r, double th, double ph,
+                       double& x, double& y, double& z) {
+    double rho = std::sqrt(r * r + a * a);
+    x = rho * std::sin(th) * std::cos(ph);
+    y = rho * std::sin(th) * std::sin(ph);
+    z = r * std::cos(th);
+}
+
+// ----------------------
+// Initial conditions: direction seen by a ZAMO at the camera
+// ----------------------
+inline KerrRay kerrInitRay(double M, double a, double x, double y, double z,
+                           double dx, double dy, double dz) {
+    KerrRay k;
+    kerrToBL(a, x, y, z, k.r, k.th, k.ph);
+
+    double r = k.r, th = k.th, ph = k.ph;
+    double st = std::fmax(std::sin(th), 1e-6), ct = std::cos(th);
+    double sp = std::sin(ph), cp = std::cos(ph);
+    double rho = std::sqrt(r * r + a * a);
+
+    // Orthonormal coordinate directions (oblate coords are orthogonal)
+    double erx = r / rho * st * cp, ery = r / rho * st * sp, erz = ct;
+    double etx = rho * ct * cp,     ety = rho * ct * sp,     etz = -r * st;
+    double epx = -sp,               epy = cp;
+    double ern = std::sqrt(erx * erx + ery * ery + erz * erz);
+    double etn = std::sqrt(etx * etx + ety * ety + etz * etz);
+
+    double nr  = (dx * erx + dy * ery + dz * erz) / ern;
+    double nth = (dx * etx + dy * ety + dz * etz) / etn;
+    double nph =  dx * epx + dy * epy;
+
+    double sig   = r * r + a * a * ct * ct;
+    double delta = r * r - 2.0 * M * r + a * a;
+    double A     = (r * r + a * a) * (r * r + a * a) - a * a * delta * st * st;
+    double alpha = std::sqrt(sig * delta / A);
+    double omega = 2.0 * M * a * r / A;
+    double varpi = std::sqrt(A / sig) * st;
+
+    // Covariant momentum for unit local energy
+    double pR  = std::sqrt(sig / delta) * nr;
+    double pTh = std::sqrt(sig) * nth;
+    double pPh = varpi * nph;
+    double E   = alpha + omega * pPh;
+
+    k.xi  = pPh / E;
+    k.eta = (pTh / E) * (pTh / E) + ct * ct * (k.xi * k.xi / (st * st) - a * a);
+    k.pr  = delta * pR / E;   // dr/dlambda = Delta p_r
+    k.pth = pTh / E;          // dtheta/dlambda = p_theta
+    return k;
+}
+
+// ----------------------
+// Reduced equations of motion
+// ----------------------
+struct KerrDeriv { double r, th, ph, pr, pth; };
+
+inline KerrDeriv kerrDeriv(double M, double a, double xi, double eta,
+                           double r, double th, double pr, double pth) {
+    double st = std::sin(th), ct = std::cos(th);
+    if (std::fabs(st) < 1e-6) st = st < 0.0 ? -1e-6 : 1e-6;
+
+    double delta = r * r - 2.0 * M * r + a * a;
+    double P = r * r + a * a - a * xi;
+    double K = eta + (xi - a) * (xi - a);
+
+    KerrDeriv d;
+    d.r   = pr;
+    d.th  = pth;
+    d.ph  = a / delta * P - a + xi / (st * st);
+    d.pr  = 2.0 * r * P - (r - M) * K;                              // R'/2
+    d.pth = -a * a * st * ct + xi * xi * ct / (st * st * st);       // Theta'/2
+    return d;
+}
+
+inline void kerrRK4(double M, double a, KerrRay& k, double h) {
+    KerrDeriv k1 = kerrDeriv(M, a, k.xi, k.eta, k.r, k.th, k.pr, k.pth);
+    KerrDeriv k2 = kerrDeriv(M, a, k.xi, k.eta, k.r + 0.5 * h * k1.r, k.th + 0.5 * h * k1.th,
+                             k.pr + 0.5 * h * k1.pr, k.pth + 0.5 * h * k1.pth);
+    KerrDeriv k3 = kerrDeriv(M, a, k.xi, k.eta, k.r + 0.5 * h * k2.r, k.th + 0.5 * h * k2.th,
+                             k.pr + 0.5 * h * k2.pr, k.pth + 0.5 * h * k2.pth);
+    KerrDeriv k4 = kerrDeriv(M, a, k.xi, k.eta, k.r + h * k3.r, k.th + h * k3.th,
+                             k.pr + h * k3.pr, k.pth + h * k3.pth);
+
+    k.r   += h / 6.0 * (k1.r   + 2.0 * k2.r   + 2.0 * k3.r   + k4.r);
+    k.th  += h / 6.0 * (k1.th  + 2.0 * k2.th  + 2.0 * k3.th  + k4.th);
+    k.ph  += h / 6.0 * (k1.ph  + 2.0 * k2.ph  + 2.0 * k3.ph  + k4.ph);
+    k.pr  += h / 6.0 * (k1.pr  + 2.0 * k2.pr  + 2.0 * k3.pr  + k4.pr);
+    k.pth += h / 6.0 * (k1.pth + 2.0 * k2.pth + 2.0 * k3.pth + k4.pth);
+}
+
+// ----------------------
+// One ray. Step length grows with distance from the horizon; the disk
+// (theta = pi/2) crossing is interpolated inside the step.
+// ----------------------
+inline RayResult traceRayKerr(const RayMarchParams& p, const RayFrame& f,
+                              float fragX, float fragY) {
+    RayResult res;
+
+    const double M  = kerrMass(p);
+    const double a  = p.spin * M;
+    const double rH = kerrHorizon(M, a);
+
+    Vec3 d = makeRayDirection(p, f, fragX, fragY);
+    Vec3 c = p.camPos;
+
+    KerrRay k = kerrInitRay(M, a,
+        dot(c, f.diskX), dot(c, f.diskZ), dot(c, f.diskNormal),
+        dot(d, f.diskX), dot(d, f.diskZ), dot(d, f.diskNormal));
+
+    // Outgoing rays can't turn back outside the photon region (r <= 4M
+    // for any spin), so with the influence sphere on they stop there
+    const float  rInf    = influenceRadius(p);
+    const double escapeR = rInf > 0.0f ? std::fmax(4.0 * M, static_cast<double>(rInf))
+                                       : static_cast<double>(RAY_MAX_DIST);
+
+    for (int i = 0; i < KERR_MAX_STEPS; ++i) {
+        res.steps = i + 1;
+
+        if (k.r < rH * 1.01) {
+            res.hit = RAY_HORIZON;
+            return res;
+        }
+        if (k.r > escapeR && k.pr > 0.0) {
+            return res;
+        }
+
+        double len = std::fmin(std::fmax(0.1 * (k.r - rH), KERR_MIN_STEP), KERR_MAX_STEP);
+        double sig = k.r * k.r + a * a * std::cos(k.th) * std::cos(k.th);
+        double h = len / sig;
+
+        // Near the spin axis phi whips around (xi / sin^2) and theta is
+        // pushed back hard (xi^2 / sin^3): also cap the angular change per step
+        KerrDeriv d0 = kerrDeriv(M, a, k.xi, k.eta, k.r, k.th, k.pr, k.pth);
+        double angRate = std::fmax(std::fabs(d0.ph), std::fabs(d0.th));
+        h = std::fmin(h, KERR_MAX_ANGLE / std::fmax(angRate, 1e-12));
+        h = std::fmin(h, std::sqrt(KERR_MAX_ANGLE / std::fmax(std::fabs(d0.pth), 1e-12)));
+
+        // A substep landing right on the axis can still blow up: reject
+        // steps that move theta / phi much further than the cap allows
+        KerrRay prev = k;
+        for (int retry = 0; retry < 8; ++retry) {
+            k = prev;
+            kerrRK4(M, a, k, h);
+            if (std::fabs(k.th - prev.th) < 2.0 * KERR_MAX_ANGLE &&
+                std::fabs(k.ph - prev.ph) < 4.0 * KERR_MAX_ANGLE) break;
+            h *= 0.25;
+        }
+
+        // Crossing the axis kicks theta' off the first integral; put it
+        // back on (dtheta/dl)^2 = Theta(theta), keeping the sign
+        double ct = std::cos(k.th), st = std::sin(k.th);
+        double Th = k.eta + ct * ct * (a * a - k.xi * k.xi / std::fmax(st * st, 1e-12));
+        if (Th > 0.0) k.pth = std::copysign(std::sqrt(Th), k.pth);
+
+        double c0 = std::cos(prev.th), c1 = std::cos(k.th);
+        if ((c0 > 0.0 && c1 <= 0.0) || (c0 < 0.0 && c1 >= 0.0)) {
+            double t  = c0 / (c0 - c1);
+            double rr = prev.r  + (k.r  - prev.r)  * t;
+            double pp = prev.ph + (k.ph - prev.ph) * t;
+
+            if (rr > p.diskInner && rr < p.diskOuter) {
+                double x0, y0, z0, x1, y1, z1;
+                kerrFromBL(a, prev.r, prev.th, prev.ph, x0, y0, z0);
+                kerrFromBL(a, k.r, k.th, k.ph, x1, y1, z1);
+                Vec3 step = f.diskX * static_cast<float>(x1 - x0) +
+                            f.diskZ * static_cast<float>(y1 - y0) +
+                            f.diskNormal * static_cast<float>(z1 - z0);
+
+                double rho = std::sqrt(rr * rr + a * a);
+                res.hit    = RAY_DISK;
+                res.diskR  = static_cast<float>(rr);
+                res.diskXc = static_cast<float>(rho * std::cos(pp));
+                res.diskZc = static_cast<float>(rho * std::sin(pp));
+                res.dir    = normalize(step);
+                return res;
+            }
+        }
+    }
+    return res;
+}
+
+template <class ResultFn>
+inline void traceRectKerr(const RayMarchParams& p, const RayFrame& f,
+                          int rx0, int ry0, int rx1, int ry1, ResultFn onResult) {
+    const int hgt = static_cast<int>(p.resolutionY);
+    for (int y = ry0; y < ry1; ++y) {
+        for (int x = rx0; x < rx1; ++x) {
+            onResult(x, y, traceRayKerr(p, f, x + 0.5f, hgt - y - 0.5f));
+        }
+    }
+}
+
+inline double renderTiledKerr(const RayMarchParams& p, std::vector<float>& rgb,
+                              int tileSize, int threads, std::vector<TileWorkerStats>& stats) {
+    RayFrame f = makeRayFrame(p);
+    const int w = static_cast<int>(p.resolutionX);
+
+    std::vector<RenderTile> tiles = makeTileGrid(w, static_cast<int>(p.resolutionY), tileSize);
+    estimateRayMarchTileCosts(p, f, tiles);
+
+    return runTilesWorkStealing(tiles, threads,
+        [&](const RenderTile& t, int) {
+            traceRectKerr(p, f, t.x0, t.y0, t.x1, t.y1,
+                [&](int x, int y, const RayResult& res) {
+                    Vec3 col = shadeRay(p, f, res);
+                    float* px = &rgb[(static_cast<size_t>(y) * w + x) * 3];
+                    px[0] = col.x; px[1] = col.y; px[2] = col.z;
+                });
+        },
+        stats);
+}
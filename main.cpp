@@ -1,8 +1,16 @@
 #include <SFML/Graphics.hpp>
 #include <cmath>
 #include <bits/stdc++.h>
+#include "auto_tuner.hpp"
+#include "frame_profiler.hpp"
+#include "geodesic_cache.hpp"
+#include "param_block.hpp"
+#include "quality_controller.hpp"
+#include "ray_stats.hpp"
+#include "scene_config.hpp"
+#include "shader_variants.hpp"
 using namespace std;
-int main() {
+int main(int argc, char** argv) {
     const unsigned WINDOW_W = 1280;
     const unsigned WINDOW_H = 720;
 
@@ -13,24 +21,273 @@ int main() {
     );
     window.setFramerateLimit(60);
 
-    sf::Shader bhShader;
-    if (!bhShader.loadFromFile("bh_raymarch.frag", sf::Shader::Fragment)) {
+    // Scene file (first argument, default scene.cfg), hot-reloaded
+    SceneFile scene;
+    scene.load(argc > 1 ? argv[1] : "scene.cfg");
+
+    // Ray-march shader variants (shader_variants.hpp): the quality tier
+    // (T cycles) and the disk / bending models are compiled in as
+    // #defines; each combination is built once, on first use
+    ShaderVariantCache<sf::Shader> bhVariants;
+    if (!bhVariants.loadSource("bh_raymarch.frag")) {
         return 1;
     }
+    QualityTier tier     = TIER_MEDIUM;   // in use this frame
+    QualityTier userTier = TIER_MEDIUM;   // picked with T; the controller may go below it
+    sf::Shader* bhShader = nullptr;
+    std::string bhVariant;
+
+    // Geodesic G-buffer: bh_raymarch.frag traces into gBufferRT only when
+    // the camera/scene changes, bh_shade.frag reshades it every frame
+    sf::Shader shadeShader;
+    if (!shadeShader.loadFromFile("bh_shade.frag", sf::Shader::Fragment)) {
+        return 1;
+    }
+    sf::RenderTexture gBufferRT;
+    if (!gBufferRT.create(WINDOW_W, WINDOW_H)) return 1;
+
+    bool useGBuffer   = true;    // G toggles
+    bool gBufferValid = false;
+
+    // Edge supersampling (X toggles): pass 1 traces color + edge key
+    // into edgeRT, pass 2 re-traces extra sub-pixel rays on edges only.
+    // The CPU renderer gets the same through lutCache.aa
+    bool useEdgeAA      = false;
+    int  edgeSamples    = 4;         // extra rays per edge pixel (1..8)
+    int  cpuEdgeBudget  = 100000;    // extra rays per CPU trace
+    sf::RenderTexture edgeRT;
+    if (!edgeRT.create(WINDOW_W, WINDOW_H)) return 1;
+
+    // Progressive refinement (P toggles): after a camera move only one
+    // pixel per 4x4 block is traced into coarseRT and filled over its
+    // block; each still frame then traces the next 1/16 of the pixels
+    // into gBufferRT (progressive_refine.hpp, same for lutCache)
+    bool useProgressive = true;
+    int  progressPhase  = PROGRESSIVE_PHASES;   // next phase, 16 = done
+    sf::RenderTexture coarseRT;
+    if (!coarseRT.create((WINDOW_W + PROGRESSIVE_BLOCK - 1) / PROGRESSIVE_BLOCK,
+                         (WINDOW_H + PROGRESSIVE_BLOCK - 1) / PROGRESSIVE_BLOCK)) return 1;
 
     // Fullscreen quad
     sf::RectangleShape screen(sf::Vector2f(WINDOW_W, WINDOW_H));
     screen.setPosition(0.f, 0.f);
 
+    // Uniforms of both shaders as dirty-tracked blocks: only changed
+    // values are uploaded. Everything the traced geodesics depend on
+    // is in BH_TRACE (not uTime / rotation / color), and the G-buffer
+    // re-traces when that group's version moves
+    const unsigned BH_TRACE = 1u << 0;
+    const float    DEG = 3.14159265f / 180.0f;
+    const SceneParams& s0 = scene.params;
+
+    ParamBlock bh;
+    const ParamBlock::Id pResolution   = bh.addVec2("uResolution", WINDOW_W, WINDOW_H, BH_TRACE);  // full size unless scaled below
+    const ParamBlock::Id pTime         = bh.addFloat("uTime", 0.0f);
+    const ParamBlock::Id pCamPos       = bh.addVec3 ("uCamPos", s0.camPos[0], s0.camPos[1], s0.camPos[2], BH_TRACE);
+    const ParamBlock::Id pCamTarget    = bh.addVec3 ("uCamTarget", s0.camTarget[0], s0.camTarget[1], s0.camTarget[2], BH_TRACE);
+    const ParamBlock::Id pFovFactor    = bh.addFloat("uFovFactor", 1.0f, BH_TRACE);
+    const ParamBlock::Id pBhRadius     = bh.addFloat("uBhRadius", s0.bhRadius, BH_TRACE);
+    const ParamBlock::Id pDiskInner    = bh.addFloat("uDiskInner", s0.diskInner, BH_TRACE);
+    const ParamBlock::Id pDiskOuter    = bh.addFloat("uDiskOuter", s0.diskOuter, BH_TRACE);
+    const ParamBlock::Id pDiskHeight   = bh.addFloat("uDiskHeight", s0.diskHeight, BH_TRACE);
+    const ParamBlock::Id pDiskTilt     = bh.addFloat("uDiskTilt", s0.diskTiltDegrees * DEG, BH_TRACE);
+    const ParamBlock::Id pGrav         = bh.addFloat("uGravStrength", s0.gravStrength, BH_TRACE);
+    const ParamBlock::Id pStepSize     = bh.addFloat("uStepSize", s0.stepSize, BH_TRACE);
+    const ParamBlock::Id pStepTol      = bh.addFloat("uStepTolerance", s0.stepTolerance, BH_TRACE);
+    const ParamBlock::Id pSpin         = bh.addFloat("uSpin", s0.spin, BH_TRACE);      // a/M
+    const ParamBlock::Id pInfluence    = bh.addFloat("uInfluenceRadius", s0.influenceRadius, BH_TRACE);
+    const ParamBlock::Id pDiskRotation = bh.addFloat("uDiskRotation", s0.diskRotation);
+    const ParamBlock::Id pDiskColor    = bh.addVec3 ("uDiskColorBase", s0.diskColorBase[0],
+                                                     s0.diskColorBase[1], s0.diskColorBase[2]);
+    // Per-pass switches
+    const ParamBlock::Id pWriteGBuffer = bh.addBool ("uWriteGBuffer", false);
+    const ParamBlock::Id pEdgeAAPass   = bh.addInt  ("uEdgeAAPass", 0);
+    const ParamBlock::Id pEdgeSamples  = bh.addInt  ("uEdgeSamples", 4);
+    bh.addFloat("uEdgeThreshold", 0.05f);
+    const ParamBlock::Id pProgressPass = bh.addInt  ("uProgressPass", 0);
+    const ParamBlock::Id pProgressPhase = bh.addInt ("uProgressPhase", 0);
+    std::uint64_t tracedVersion = 0;
+
+    ParamBlock shadeParams;
+    shadeParams.addVec2("uResolution", WINDOW_W, WINDOW_H);
+    const ParamBlock::Id sTime         = shadeParams.addFloat("uTime", 0.0f);
+    const ParamBlock::Id sDiskRotation = shadeParams.addFloat("uDiskRotation", s0.diskRotation);
+    const ParamBlock::Id sDiskColor    = shadeParams.addVec3 ("uDiskColorBase", s0.diskColorBase[0],
+                                                              s0.diskColorBase[1], s0.diskColorBase[2]);
+
+    // Texture uniforms bind the render texture itself, so once is enough
+    shadeShader.setUniform("uGBuffer", gBufferRT.getTexture());
+
+    auto drawBh = [&](sf::RenderTarget& target, sf::RenderStates states) {
+        PROFILE_SCOPE("ray march");
+        bh.upload<sf::Glsl::Vec2, sf::Glsl::Vec3>(*bhShader);
+        states.shader = bhShader;
+        target.draw(screen, states);
+    };
+
+    // CPU Schwarzschild table renderer (L toggles): O(1) lookups per pixel
+    // with true GR bending, traced through the same geodesic cache idea
+    // on the CPU and uploaded as a texture
+    bool useLutRenderer = false;
+    GeodesicCache lutCache;
+    lutCache.tracer = TRACE_SCHWARZSCHILD_LUT;
+
+    // The scene as the CPU tracers see it (uniform block -> params)
+    auto cpuParams = [&](float time) {
+        const float* cp = bh.getVec(pCamPos);
+        const float* ct = bh.getVec(pCamTarget);
+        const float* dc = bh.getVec(pDiskColor);
+        RayMarchParams rp;
+        rp.resolutionX  = static_cast<float>(WINDOW_W);
+        rp.resolutionY  = static_cast<float>(WINDOW_H);
+        rp.time         = time;
+        rp.camPos       = Vec3(cp[0], cp[1], cp[2]);
+        rp.camTarget    = Vec3(ct[0], ct[1], ct[2]);
+        rp.fovFactor    = bh.getFloat(pFovFactor);
+        rp.bhRadius     = bh.getFloat(pBhRadius);
+        rp.diskInner    = bh.getFloat(pDiskInner);
+        rp.diskOuter    = bh.getFloat(pDiskOuter);
+        rp.diskHeight   = bh.getFloat(pDiskHeight);
+        rp.diskRotation = bh.getFloat(pDiskRotation);
+        rp.diskTilt     = bh.getFloat(pDiskTilt);
+        rp.gravStrength = bh.getFloat(pGrav);
+        rp.stepSize     = bh.getFloat(pStepSize);
+        rp.stepTolerance = bh.getFloat(pStepTol);
+        rp.spin         = bh.getFloat(pSpin);
+        rp.influenceRadius = bh.getFloat(pInfluence);
+        rp.diskColorBase = Vec3(dc[0], dc[1], dc[2]);
+        return rp;
+    };
+
+    // Threads and tile size for it from the host's "lut" tuning cache.
+    // The first L on a new host calibrates the table tracer on the
+    // current scene in the background (a few seconds); the GPU path
+    // keeps drawing until the settings are in
+    TunedSettings cpuTune;
+    std::future<TunedSettings> cpuTuneJob;
+
+    // Kerr geodesics in the shader (K toggles): slower, true GR with spin
+    bool useKerr = false;
+
+    // Volumetric thick disk (V toggles): integrates through uDiskHeight.
+    // The band is inside the integral, so it can't use the G-buffer
+    bool useVolume = false;
+
+    // Switch to the variant for the current tier / models. A new program
+    // has none of the uniforms yet, so the whole block goes up again and
+    // the G-buffer is re-traced. false if it failed to compile (the
+    // previous variant stays in use)
+    auto selectBhVariant = [&]() {
+        ShaderDefines defines = raymarchDefines(tier, useVolume ? 1 : 0, useKerr ? 1 : 0);
+        std::string key = shaderVariantKey(defines);
+        if (key == bhVariant) return true;
+
+        sf::Shader* shader = bhVariants.get(defines);
+        if (!shader) return false;
+        bhShader  = shader;
+        bhVariant = key;
+
+        if (QUALITY_TIERS[tier].edgeAA) bhShader->setUniform("uFirstPass", edgeRT.getTexture());
+        bhShader->setUniform("uCoarse", coarseRT.getTexture());
+        bh.markAllDirty();
+        gBufferValid = false;
+        return true;
+    };
+    if (!selectBhVariant()) {
+        return 1;
+    }
+
+    // Ray-march stats (H): one frame through the BH_DEBUG_STATS variant
+    // of the current shader, read back into steps / exit histograms and
+    // a heatmap (ray_stats.hpp)
+    bool captureStats = false;
+    auto captureRayStats = [&]() {
+        ShaderDefines defines = raymarchDefines(tier, useVolume ? 1 : 0, useKerr ? 1 : 0);
+        defines["BH_DEBUG_STATS"] = "1";
+        sf::Shader* statsShader = bhVariants.get(defines);
+        sf::RenderTexture statsRT;
+        if (!statsShader || !statsRT.create(WINDOW_W, WINDOW_H)) return;
+
+        // Uniforms are per program: give the debug one everything, then
+        // make sure the display variant gets this frame's changes too
+        bh.markAllDirty();
+        bh.upload<sf::Glsl::Vec2, sf::Glsl::Vec3>(*statsShader);
+        bh.markAllDirty();
+        sf::RenderStates states(statsShader);
+        states.blendMode = sf::BlendNone;
+        statsRT.clear(sf::Color::Black);
+        statsRT.draw(screen, states);
+        statsRT.display();
+
+        sf::Image image = statsRT.getTexture().copyToImage();
+        const sf::Uint8* px = image.getPixelsPtr();
+        RayMarchStats stats;
+        stats.reset(WINDOW_W, WINDOW_H, QUALITY_TIERS[tier].maxSteps);
+        for (unsigned y = 0; y < WINDOW_H; ++y) {
+            for (unsigned x = 0; x < WINDOW_W; ++x) {
+                int steps, exit;
+                decodeDebugStatsPixel(px + (static_cast<size_t>(y) * WINDOW_W + x) * 4, steps, exit);
+                stats.record(x, y, steps, exit);
+            }
+        }
+        stats.finalize();
+        printf("ray-march stats (%s tier)\n", QUALITY_TIERS[tier].name);
+        printRayMarchStats(stats);
+        if (writeStepHeatmap("bh_steps.ppm", stats)) printf("wrote bh_steps.ppm\n");
+    };
+
+    // Frame-budget controller (Q toggles, log in quality_log.csv): holds
+    // 60 fps by coarsening the step (tolerance, or step size when it is
+    // 0), then the resolution of the direct ray march, then the tier,
+    // and restores them in reverse when there is headroom. Resolution
+    // only applies to the direct path: the G-buffer and progressive
+    // paths already trace once per camera change
+    QualityController quality;
+    const int qStep = quality.addKnob("step", 1.0, 4.0, 1.25, true);
+    const int qRes  = quality.addKnob("resolution", 1.0, 0.5, 0.85, true);
+    const int qTier = quality.addKnob("tier", userTier, TIER_LOW, -1.0, false);
+    bool qualityOn = false;
+    sf::Clock workClock;
+
+    sf::RenderTexture scaledRT;   // direct path below full resolution
+    sf::Sprite scaledSprite;
+    sf::Vector2u scaledSize(WINDOW_W, WINDOW_H);
+
+    vector<float> cpuRGB(static_cast<size_t>(WINDOW_W) * WINDOW_H * 3);
+    vector<sf::Uint8> cpuPixels(static_cast<size_t>(WINDOW_W) * WINDOW_H * 4, 255);
+    sf::Texture cpuTexture;
+    if (!cpuTexture.create(WINDOW_W, WINDOW_H)) return 1;
+    sf::Sprite cpuSprite(cpuTexture);
+
     sf::Clock clock;
 
-    // Camera setup
-    sf::Glsl::Vec3 camPos(0.f, 1.0f, 12.0f);   // above + in front
-    sf::Glsl::Vec3 camTarget(0.f, 0.f, 0.f);  // look near origin
-    float fovDegrees = 55.0f;
-    float fovFactor = std::tan(fovDegrees * 3.14159265f / 360.0f); // tan(FOV/2)
+    // Camera setup: orbits camTarget (arrows), W / S zoom. Starts at
+    // the scene's camPos, and goes back there when the file changes it
+    sf::Glsl::Vec3 camTarget;
+    float camYaw = 0.0f, camPitch = 0.0f, camDist = 1.0f;
+    auto resetOrbit = [&]() {
+        const SceneParams& s = scene.params;
+        camTarget = sf::Glsl::Vec3(s.camTarget[0], s.camTarget[1], s.camTarget[2]);
+        float dx = s.camPos[0] - s.camTarget[0];
+        float dy = s.camPos[1] - s.camTarget[1];
+        float dz = s.camPos[2] - s.camTarget[2];
+        camDist  = std::sqrt(dx * dx + dy * dy + dz * dz);
+        camYaw   = std::atan2(dx, dz);
+        camPitch = std::atan2(dy, std::sqrt(dx * dx + dz * dz));
+    };
+    // Frame profiler (F9 toggles, F10 writes bh_trace.json): per-stage
+    // timings, summarized every few seconds while it runs
+    FrameProfiler& profiler = FrameProfiler::instance();
+    profiler.setThreadName("main");
+    const double profileWindow = 5.0;
+    sf::Clock profileClock;
+
+    resetOrbit();
+    sf::Clock frameClock;
 
     while (window.isOpen()) {
+        PROFILE_SCOPE("frame");
+        workClock.restart();
         sf::Event e;
         while (window.pollEvent(e)) {
             if (e.type == sf::Event::Closed)
@@ -38,38 +295,277 @@ int main() {
             if (e.type == sf::Event::KeyPressed &&
                 e.key.code == sf::Keyboard::Escape)
                 window.close();
+            if (e.type == sf::Event::KeyPressed &&
+                e.key.code == sf::Keyboard::G) {
+                useGBuffer = !useGBuffer;
+                gBufferValid = false;
+            }
+            if (e.type == sf::Event::KeyPressed &&
+                e.key.code == sf::Keyboard::L) {
+                useLutRenderer = !useLutRenderer;
+                if (useLutRenderer && cpuTune.threads == 0 && !cpuTuneJob.valid()) {
+                    RayMarchParams tuneScene = cpuParams(clock.getElapsedTime().asSeconds());
+                    cpuTuneJob = std::async(std::launch::async, [tuneScene]() {
+                        return loadOrTuneRayMarch(".", tuneScene, TRACE_SCHWARZSCHILD_LUT, false, true);
+                    });
+                }
+            }
+            if (e.type == sf::Event::KeyPressed &&
+                e.key.code == sf::Keyboard::K)
+                useKerr = !useKerr;
+            if (e.type == sf::Event::KeyPressed &&
+                e.key.code == sf::Keyboard::V)
+                useVolume = !useVolume;
+            if (e.type == sf::Event::KeyPressed &&
+                e.key.code == sf::Keyboard::X)
+                useEdgeAA = !useEdgeAA;
+            if (e.type == sf::Event::KeyPressed &&
+                e.key.code == sf::Keyboard::P) {
+                useProgressive = !useProgressive;
+                gBufferValid = false;
+            }
+            if (e.type == sf::Event::KeyPressed &&
+                e.key.code == sf::Keyboard::T) {
+                userTier = static_cast<QualityTier>((userTier + 1) % QUALITY_TIER_COUNT);
+                quality.rebase(qTier, userTier);
+                printf("quality tier: %s\n", QUALITY_TIERS[userTier].name);
+            }
+            if (e.type == sf::Event::KeyPressed &&
+                e.key.code == sf::Keyboard::Q) {
+                qualityOn = !qualityOn;
+                quality.reset();
+                if (qualityOn) quality.openLog("quality_log.csv");
+                else           quality.closeLog();
+                // The controller paces frames itself (end of the loop)
+                window.setFramerateLimit(qualityOn ? 0 : 60);
+                printf("quality controller %s (%.2f ms budget)\n", qualityOn ? "on" : "off",
+                       quality.config.budgetMs);
+            }
+            if (e.type == sf::Event::KeyPressed &&
+                e.key.code == sf::Keyboard::H)
+                captureStats = true;
+            if (e.type == sf::Event::KeyPressed &&
+                e.key.code == sf::Keyboard::F9) {
+                profiler.setEnabled(!profiler.enabled());
+                profileClock.restart();
+                printf("profiler %s\n", profiler.enabled() ? "on" : "off");
+            }
+            if (e.type == sf::Event::KeyPressed &&
+                e.key.code == sf::Keyboard::F10) {
+                if (profiler.writeChromeTrace("bh_trace.json")) printf("wrote bh_trace.json\n");
+                printProfileSummary(profiler.summarize(profileWindow), profileWindow);
+            }
+        }
+
+        if (cpuTuneJob.valid() &&
+            cpuTuneJob.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            cpuTune = cpuTuneJob.get();
+            lutCache.packetWidth = cpuTune.packetWidth;
         }
+        const bool cpuRenderer = useLutRenderer && cpuTune.threads > 0;
+
+        // Knobs that do nothing on the current path stay where they are
+        const bool directPath = !cpuRenderer && !(useEdgeAA && QUALITY_TIERS[tier].edgeAA) &&
+                                !(useGBuffer && !useVolume);
+        quality.setActive(qRes, directPath);
+        quality.setActive(qTier, !cpuRenderer);
+        tier = qualityOn ? static_cast<QualityTier>(static_cast<int>(quality.value(qTier))) : userTier;
+        selectBhVariant();
 
+        // Hot reload: drop only what the changed keys feed
+        // (trace keys reach the G-buffer through the BH_TRACE version and
+        // lutCache through its own params check; shade keys touch neither)
+        int changed = scene.poll();
+        printSceneReload(scene.path, changed);
+        if (changed & SCENE_CAMERA) resetOrbit();
+        const SceneParams& sp = scene.params;
+
+        // Orbit camera (held keys, frame-rate independent)
+        float dt = frameClock.restart().asSeconds();
+        const float orbitSpeed = 1.0f;                  // rad/s
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left))  camYaw   -= orbitSpeed * dt;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right)) camYaw   += orbitSpeed * dt;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Up))    camPitch += orbitSpeed * dt;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Down))  camPitch -= orbitSpeed * dt;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::W))     camDist  *= 1.0f - 0.8f * dt;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::S))     camDist  *= 1.0f + 0.8f * dt;
+        camPitch = max(-1.5f, min(1.5f, camPitch));
+        camDist  = max(sp.bhRadius + 1.0f, min(200.0f, camDist));
+
+        sf::Glsl::Vec3 camPos(
+            camTarget.x + camDist * std::cos(camPitch) * std::sin(camYaw),
+            camTarget.y + camDist * std::sin(camPitch),
+            camTarget.z + camDist * std::cos(camPitch) * std::cos(camYaw));
+
+        float fovFactor = std::tan(sp.fovDegrees * 3.14159265f / 360.0f); // tan(FOV/2)
         float time = clock.getElapsedTime().asSeconds();
 
-        // Set uniforms
-        bhShader.setUniform("uResolution", sf::Glsl::Vec2(WINDOW_W, WINDOW_H));
-        bhShader.setUniform("uTime", time);
-
-        bhShader.setUniform("uCamPos", camPos);
-        bhShader.setUniform("uCamTarget", camTarget);
-        bhShader.setUniform("uFovFactor", fovFactor);
-
-        // Scene params
-        bhShader.setUniform("uBhRadius", 3.0f);
-        bhShader.setUniform("uDiskInner", 4.0f);
-        bhShader.setUniform("uDiskOuter", 10.0f);
-        bhShader.setUniform("uDiskHeight", 0.5f);
-        bhShader.setUniform("uDiskRotation", 0.5f); // spin speed
-
-        // PHASE G2: static tilt ~30 degrees
-        float tiltDegrees = 27.0f;
-        float tiltRadians = tiltDegrees * 3.14159265f / 180.0f;
-        bhShader.setUniform("uDiskTilt", tiltRadians);
-        
-        //PHASE G3:ray bending controls
-        bhShader.setUniform("uGravStrength", 0.8f);      // bending strength
-        bhShader.setUniform("uStepSize", 0.10f);        // quality vs performance
-        bhShader.setUniform("uDiskColorBase", sf::Glsl::Vec3(1.2f, 0.9f, 1.4f));
+        // Parameters for this frame; unchanged values cost nothing
+        bh.set(pTime, time);
+        bh.set(pCamPos, camPos.x, camPos.y, camPos.z);
+        bh.set(pCamTarget, camTarget.x, camTarget.y, camTarget.z);
+        bh.set(pFovFactor, fovFactor);
+        bh.set(pBhRadius, sp.bhRadius);
+        bh.set(pDiskInner, sp.diskInner);
+        bh.set(pDiskOuter, sp.diskOuter);
+        bh.set(pDiskHeight, sp.diskHeight);
+        bh.set(pDiskTilt, sp.diskTiltDegrees * DEG);         // PHASE G2: static tilt
+        bh.set(pGrav, sp.gravStrength);                      // PHASE G3: ray bending controls
+        // The controller's step knob coarsens whichever one is in use
+        const float stepScale = qualityOn ? static_cast<float>(quality.value(qStep)) : 1.0f;
+        const bool  adaptive  = sp.stepTolerance > 0.0f;
+        bh.set(pStepSize, adaptive ? sp.stepSize : sp.stepSize * stepScale);   // fixed step (tolerance = 0)
+        bh.set(pStepTol, sp.stepTolerance * stepScale);      // adaptive: bending per step
+        bh.set(pSpin, sp.spin);
+
+        // Jump rays onto the smallest sphere holding the scene, stop them
+        // once they leave it outward
+        bh.set(pInfluence, sp.influenceRadius);
+        bh.set(pDiskRotation, sp.diskRotation);              // spin speed
+        bh.set(pDiskColor, sp.diskColorBase[0], sp.diskColorBase[1], sp.diskColorBase[2]);
+
+        shadeParams.set(sTime, time);
+        shadeParams.set(sDiskRotation, sp.diskRotation);
+        shadeParams.set(sDiskColor, sp.diskColorBase[0], sp.diskColorBase[1], sp.diskColorBase[2]);
+
+        if (captureStats) {
+            captureStats = false;
+            bh.set(pResolution, static_cast<float>(WINDOW_W), static_cast<float>(WINDOW_H));
+            captureRayStats();
+        }
+
+        // Direct path below full resolution: traced into scaledRT, drawn
+        // stretched. The size only changes when the controller moves
+        const float resScale = qualityOn && directPath ? static_cast<float>(quality.value(qRes)) : 1.0f;
+        sf::Vector2u wantSize(max(1u, static_cast<unsigned>(WINDOW_W * resScale)),
+                              max(1u, static_cast<unsigned>(WINDOW_H * resScale)));
+        if (resScale < 1.0f && wantSize != scaledSize) {
+            if (scaledRT.create(wantSize.x, wantSize.y)) {
+                scaledRT.setSmooth(true);
+                scaledSprite.setTexture(scaledRT.getTexture(), true);
+                scaledSprite.setScale(static_cast<float>(WINDOW_W) / wantSize.x,
+                                      static_cast<float>(WINDOW_H) / wantSize.y);
+                scaledSize = wantSize;
+            }
+        }
+        const bool scaled = resScale < 1.0f && scaledSize.x < WINDOW_W;
+        if (scaled) bh.set(pResolution, static_cast<float>(scaledSize.x), static_cast<float>(scaledSize.y));
+        else        bh.set(pResolution, static_cast<float>(WINDOW_W), static_cast<float>(WINDOW_H));
 
         window.clear(sf::Color::Black);
-        window.draw(screen, &bhShader);
-        window.display();
+
+        if (cpuRenderer) {
+            RayMarchParams rp = cpuParams(time);
+
+            lutCache.aa.budget          = useEdgeAA ? cpuEdgeBudget : 0;
+            lutCache.aa.samplesPerPixel = edgeSamples;
+            lutCache.progressive        = useProgressive;
+            {
+                PROFILE_SCOPE("cpu trace");
+                lutCache.update(rp, cpuTune.tileSize, cpuTune.threads);
+            }
+            PROFILE_SCOPE("cpu shade + upload");
+            lutCache.shade(rp, cpuRGB);
+
+            for (size_t i = 0; i < cpuRGB.size() / 3; ++i) {
+                for (int c = 0; c < 3; ++c) {
+                    float v = clampf(cpuRGB[i * 3 + c], 0.0f, 1.0f);
+                    cpuPixels[i * 4 + c] = static_cast<sf::Uint8>(v * 255.0f);
+                }
+            }
+            cpuTexture.update(cpuPixels.data());
+            window.draw(cpuSprite);
+        } else if (useEdgeAA && QUALITY_TIERS[tier].edgeAA) {
+            bh.set(pWriteGBuffer, false);
+            bh.set(pProgressPass, 0);
+            bh.set(pEdgeSamples, edgeSamples);
+
+            // Pass 1: the key lives in alpha, so no blending
+            bh.set(pEdgeAAPass, 1);
+            sf::RenderStates keyStates;
+            keyStates.blendMode = sf::BlendNone;
+            edgeRT.clear(sf::Color::Black);
+            drawBh(edgeRT, keyStates);
+            edgeRT.display();
+
+            // Pass 2: copy, plus extra rays where the key jumps
+            bh.set(pEdgeAAPass, 2);
+            drawBh(window, sf::RenderStates());
+        } else if (useGBuffer && !useVolume) {
+            // Re-trace only when something the geodesics depend on
+            // changed; progressive mode refines over the next frames
+            bool retrace = !gBufferValid || bh.version(BH_TRACE) != tracedVersion;
+            if (retrace || progressPhase < PROGRESSIVE_PHASES) {
+                bh.set(pWriteGBuffer, true);
+                bh.set(pEdgeAAPass, 0);
+
+                // BlendNone: the packed alpha channel is data, not coverage
+                sf::RenderStates traceStates;
+                traceStates.blendMode = sf::BlendNone;
+
+                if (retrace && useProgressive) {
+                    bh.set(pProgressPass, 1);
+                    coarseRT.clear(sf::Color::Black);
+                    drawBh(coarseRT, traceStates);
+                    coarseRT.display();
+
+                    bh.set(pProgressPass, 2);
+                    gBufferRT.clear(sf::Color::Black);
+                    drawBh(gBufferRT, traceStates);
+                    progressPhase = 1;
+                } else if (retrace) {
+                    bh.set(pProgressPass, 0);
+                    gBufferRT.clear(sf::Color::Black);
+                    drawBh(gBufferRT, traceStates);
+                    progressPhase = PROGRESSIVE_PHASES;
+                } else {
+                    // Still camera: next phase on top of what's there
+                    bh.set(pProgressPass, 3);
+                    bh.set(pProgressPhase, progressPhase);
+                    drawBh(gBufferRT, traceStates);
+                    ++progressPhase;
+                }
+                gBufferRT.display();
+
+                tracedVersion = bh.version(BH_TRACE);
+                gBufferValid = true;
+            }
+
+            PROFILE_SCOPE("shade");
+            shadeParams.upload<sf::Glsl::Vec2, sf::Glsl::Vec3>(shadeShader);
+            window.draw(screen, &shadeShader);
+        } else {
+            bh.set(pWriteGBuffer, false);
+            bh.set(pEdgeAAPass, 0);
+            bh.set(pProgressPass, 0);
+            if (scaled) {
+                scaledRT.clear(sf::Color::Black);
+                drawBh(scaledRT, sf::RenderStates());
+                scaledRT.display();
+                window.draw(scaledSprite);
+            } else {
+                drawBh(window, sf::RenderStates());
+            }
+        }
+
+        {
+            PROFILE_SCOPE("present");
+            window.display();
+        }
+
+        // Work time excludes the pacing sleep, which is the headroom
+        if (qualityOn) {
+            double workMs = workClock.getElapsedTime().asMicroseconds() / 1000.0;
+            quality.frame(workMs);
+            if (workMs < quality.config.budgetMs) {
+                sf::sleep(sf::microseconds(static_cast<sf::Int64>((quality.config.budgetMs - workMs) * 1000.0)));
+            }
+        }
+
+        if (profiler.enabled() && profileClock.getElapsedTime().asSeconds() > profileWindow) {
+            printProfileSummary(profiler.summarize(profileWindow), profileWindow);
+            profileClock.restart();
+        }
     }
 
     return 0;
@@ -3,187 +3,15 @@
 #include <cmath>
 #include <random>
 #include <algorithm>
+#include "frame_profiler.hpp"
+#include "galaxy_diagnostics.hpp"
+#include "galaxy_frame_cpu.hpp"
+#include "galaxy_sim.hpp"
+#include "param_block.hpp"
+#include "quality_controller.hpp"
+#include "scene_config.hpp"
 using namespace std;
 
-// ----------------------
-// Simple random helper
-// ----------------------
-float randFloat(float a, float b) {
-    static mt19937 rng{ std::random_device{}() };
-    uniform_real_distribution<float> dist(a, b);
-    return dist(rng);
-}
-
-// ----------------------
-// Simulation parameters
-// ----------------------
-struct SimParams {
-    float G         = 2.0f;     // grav. constant (sim units)
-    float M_bh      = 400.0f;   // black hole mass
-    float softening = 0.5f;     // avoids infinite accel at center
-
-    float v0        = 2.2f;     // dark matter flat-curve velocity
-    float r_core    = 1.2f;     // halo core radius
-
-    float dt        = 0.01f;    // time step
-
-    // ------- PHASE 3: Accretion Disk Parameters -------
-    float viscosityBase  = 0.003f;   // base friction strength
-    float viscosityCore  = 1.0f;     // prevents infinite viscosity near r → 0
-    float heatScale      = 0.0012f;  // controls brightness generation
-    float brightnessCool = 0.997f;   // glow cool-down factor
-    float horizonRadius  = 7.0f;     // event horizon swallow radius
-    float respawnRMin    = 18.0f;    // outer disk respawn range
-    float respawnRMax    = 28.0f;
-};
-
-// ----------------------
-// Galaxy simulation (SoA)
-// ----------------------
-struct GalaxySim {
-    SimParams P;
-
-    vector<float> posX;
-    vector<float> posY;
-    vector<float> velX;
-    vector<float> velY;
-    vector<float> brightness;
-
-    // ---------------------------------------------
-    // Respawn particle when it falls into the BH
-    // ---------------------------------------------
-    void respawnAtOuterRing(int i) {
-        float u = randFloat(0.0f, 1.0f);
-        float r = P.respawnRMin + (P.respawnRMax - P.respawnRMin) * u;
-        float theta = randFloat(0.0f, 2.0f * 3.14159265f);
-
-        float x = r * cos(theta);
-        float y = r * sin(theta);
-
-        posX[i] = x;
-        posY[i] = y;
-
-        float dist = max(sqrt(x * x + y * y), 0.1f);
-        float rx = x / dist;
-        float ry = y / dist;
-        float tx = -ry;
-        float ty =  rx;
-
-        float v_bh = sqrt(P.G * P.M_bh / (dist + P.softening)); 
-        float v_dm = P.v0;
-        float v_circ = sqrt(v_bh * v_bh + v_dm * v_dm);
-
-        float jitter = randFloat(-0.05f, 0.05f);
-        float v = v_circ * 1.4f * (1.0f + jitter);
-
-        velX[i] = tx * v;
-        velY[i] = ty * v;
-
-        brightness[i] = 0.6f; 
-    }
-
-    void init(int count) {
-        posX.resize(count);
-        posY.resize(count);
-        velX.resize(count);
-        velY.resize(count);
-        brightness.resize(count);
-
-        const float R_MIN = 2.0f;
-        const float R_MAX = 30.0f;
-
-        for (int i = 0; i < count; ++i) {
-            float u = randFloat(0.0f, 1.0f);
-            float r = R_MIN + (R_MAX - R_MIN) * sqrt(u);
-            float theta = randFloat(0.0f, 2.0f * 3.14159265f);
-
-            float x = r * cos(theta);
-            float y = r * sin(theta);
-            posX[i] = x;
-            posY[i] = y;
-
-            float dist = std::max(sqrt(x * x + y * y), 0.1f);
-            float rx = x / dist;
-            float ry = y / dist;
-            float tx = -ry;
-            float ty =  rx;
-
-            float v_bh = sqrt(P.G * P.M_bh / (dist + P.softening));
-            float v_dm = P.v0;
-            float v_circ = sqrt(v_bh * v_bh + v_dm * v_dm);
-
-            float jitter = randFloat(-0.05f, 0.05f);
-            float v = v_circ * 1.6f * (1.0f + jitter);
-
-            velX[i] = tx * v;
-            velY[i] = ty * v;
-
-            brightness[i] = randFloat(0.5f, 1.0f);
-        }
-    }
-
-    void step() {
-        const int n = static_cast<int>(posX.size());
-        for (int i = 0; i < n; ++i) {
-            float x = posX[i];
-            float y = posY[i];
-
-            float dist = sqrt(x * x + y * y) + 1e-3f;
-            float invDist = 1.0f / dist;
-
-            // direction towards center
-            float dx = -x * invDist;
-            float dy = -y * invDist;
-
-            // black hole acceleration
-            float a_bh_mag = P.G * P.M_bh / (dist * dist + P.softening);
-            float a_bh_x = dx * a_bh_mag;
-            float a_bh_y = dy * a_bh_mag;
-
-            // dark matter halo: flat rotation
-            float a_dm_mag = (P.v0 * P.v0) / (dist + P.r_core);
-            float a_dm_x = dx * a_dm_mag;
-            float a_dm_y = dy * a_dm_mag;
-
-            float ax = a_bh_x + a_dm_x;
-            float ay = a_bh_y + a_dm_y;
-
-            velX[i] += ax * P.dt;
-            velY[i] += ay * P.dt;
-
-            posX[i] += velX[i] * P.dt;
-            posY[i] += velY[i] * P.dt;
-
-            // --------------------------------------------------
-            // ------- PHASE 3: ACCRETION DISK PHYSICS -----------
-            // --------------------------------------------------
-
-            float eta = P.viscosityBase / (dist + P.viscosityCore);
-            if (eta > 0.02f) eta = 0.02f;
-
-            float vx = velX[i];
-            float vy = velY[i];
-            float speed2 = vx*vx + vy*vy;
-
-            float heat = P.heatScale * eta * speed2;
-            brightness[i] += heat;
-
-            if (brightness[i] > 2.0f) brightness[i] = 2.0f;
-
-            float damp = 1.0f - eta;
-            velX[i] *= damp;
-            velY[i] *= damp;
-
-            brightness[i] *= P.brightnessCool;
-            if (brightness[i] < 0.2f) brightness[i] = 0.2f;
-
-            if (dist < P.horizonRadius) {
-                respawnAtOuterRing(i);
-            }
-        }
-    }
-};
-
 // ----------------------
 // Color based on speed + brightness
 // ----------------------
@@ -203,7 +31,7 @@ sf::Color starColor(float vx, float vy, float bright) {
 // ----------------------
 // Main
 // ----------------------
-int main() {
+int main(int argc, char** argv) {
     const unsigned WINDOW_W = 1280;
     const unsigned WINDOW_H = 720;
 
@@ -214,12 +42,16 @@ int main() {
     );
     window.setFramerateLimit(60);
 
+    // Scene file (first argument, default scene.cfg), hot-reloaded
+    SceneFile scene;
+    scene.load(argc > 1 ? argv[1] : "scene.cfg");
+
     sf::Vector2f centerScreen(WINDOW_W / 2.f, WINDOW_H / 2.f);
-    float scale = 12.0f;
 
     GalaxySim sim;
-    const int NUM_STARS = 10000;
-    sim.init(NUM_STARS);
+    applySceneSim(sim.P, scene.params);
+    int numStars = max(1, static_cast<int>(scene.params.numStars));
+    sim.init(numStars);
 
     // ---- Phase 2: render texture for trails ----
     sf::RenderTexture trailRT;
@@ -227,7 +59,7 @@ int main() {
     trailRT.clear(sf::Color(0, 0, 10));
     trailRT.display();
 
-    sf::VertexArray starVertices(sf::Points, NUM_STARS);
+    sf::VertexArray starVertices(sf::Points, numStars);
 
     // rectangle to gently fade old pixels (trail effect)
     sf::RectangleShape fadeRect(sf::Vector2f(WINDOW_W, WINDOW_H));
@@ -237,9 +69,67 @@ int main() {
     sf::Shader lensShader;
     lensShader.loadFromFile("lensing.frag", sf::Shader::Fragment);
 
+    // Lens uniforms as a dirty-tracked block: a frame only uploads what
+    // the scene file changed. LENS_WARP's version moves whenever the
+    // screen-space warp does, for anything that caches it
+    const unsigned LENS_WARP = 1u << 0;
+    const SceneParams& s0 = scene.params;
+
+    ParamBlock lens;
+    lens.addVec2("resolution", WINDOW_W, WINDOW_H, LENS_WARP);
+    lens.addVec2("center", centerScreen.x, centerScreen.y, LENS_WARP);
+    const ParamBlock::Id lStrength   = lens.addFloat("lensStrength", s0.lensStrength, LENS_WARP);   // radial lensing
+    const ParamBlock::Id lRingRadius = lens.addFloat("ringRadius", s0.ringRadius);      // photon ring radius (in pixels)
+    const ParamBlock::Id lRingWidth  = lens.addFloat("ringWidth", s0.ringWidth);        // ring thickness
+    const ParamBlock::Id lRingBoost  = lens.addFloat("ringBoost", s0.ringBoost);        // how bright the ring is
+    const ParamBlock::Id lDoppler    = lens.addFloat("dopplerBoost", s0.dopplerBoost);  // stronger asymmetry
+    const ParamBlock::Id lTint       = lens.addVec3 ("tint", s0.tint[0], s0.tint[1], s0.tint[2]);
+
+    // PHASE 5: 3D disk warping controls
+    const ParamBlock::Id lWarp       = lens.addFloat("verticalWarpStrength", s0.verticalWarpStrength, LENS_WARP); // how high the disk bends
+    const ParamBlock::Id lFalloff    = lens.addFloat("verticalWarpFalloff", s0.verticalWarpFalloff, LENS_WARP);   // larger = bend farther out
+    const ParamBlock::Id lShear      = lens.addFloat("shearStrength", s0.shearStrength, LENS_WARP);               // twisting around BH
+    const ParamBlock::Id lEcc        = lens.addFloat("ringEccentricity", s0.ringEccentricity);                    // >1 = taller photon ring
+
+    // Binds the render texture itself, so once is enough
+    lensShader.setUniform("tex", trailRT.getTexture());
+
     sf::Clock clock;
 
+    // View tilt / yaw (Up / Down, Left / Right, held) on top of the
+    // scene's viewTiltDegrees / viewYawDegrees; a 3D galaxy shows its
+    // thickness when tilted, a 2D one is a flat sheet
+    float tiltOffset = 0.0f, yawOffset = 0.0f;
+    sf::Clock viewClock;
+
+    // Frame profiler (F9 toggles, F10 writes galaxy_trace.json): per-stage
+    // timings, summarized every few seconds while it runs
+    FrameProfiler& profiler = FrameProfiler::instance();
+    profiler.setThreadName("main");
+    const double profileWindow = 5.0;
+    sf::Clock profileClock;
+
+    // Hardware counters (C toggles; the report prints when turned off):
+    // cycles, IPC, LLC and branch misses per star for each stage
+    PerfCounters& counters = PerfCounters::instance();
+    counters.setThreadName("main");
+
+    // Conservation diagnostics (D toggles): energy, angular momentum,
+    // captures and brightness every few steps, streamed to CSV
+    GalaxyDiagnosticsSampler diagnostics;
+    const int diagnosticsEvery = 10;
+
+    // Frame-budget controller (Q toggles): drops stars down to 10% of the
+    // scene's count while frames run over 60 fps, adds them back when
+    // there is headroom. Adjustments go to galaxy_quality.csv
+    QualityController quality;
+    const int qStars = quality.addKnob("stars", 1.0, 0.1, 0.8, true);
+    bool qualityOn = false;
+    sf::Clock workClock;
+
     while (window.isOpen()) {
+        PROFILE_SCOPE("frame");
+        workClock.restart();
         sf::Event e;
         while (window.pollEvent(e)) {
             if (e.type == sf::Event::Closed)
@@ -249,67 +139,184 @@ int main() {
                 if (e.key.code == sf::Keyboard::Escape)
                     window.close();
                 if (e.key.code == sf::Keyboard::R)
-                    sim.init(NUM_STARS);  // reseed galaxy
+                    sim.init(numStars);  // reseed galaxy
+                if (e.key.code == sf::Keyboard::D) {
+                    if (diagnostics.every > 0) {
+                        diagnostics.every = 0;
+                        diagnostics.csv.close();
+                        printf("diagnostics off\n");
+                    } else if (diagnostics.csv.open("galaxy_diag.csv")) {
+                        diagnostics.every = diagnosticsEvery;
+                        diagnostics.steps = 0;
+                        diagnostics.time  = 0.0;
+                        printf("diagnostics -> galaxy_diag.csv every %d steps\n", diagnosticsEvery);
+                    }
+                }
+                if (e.key.code == sf::Keyboard::C) {
+                    if (counters.enabled()) {
+                        counters.setEnabled(false);
+                        printf("counters, %d stars\n", numStars);
+                        for (const PerfStageTotals& s : counters.perStage()) {
+                            if (s.stage == "frame") continue;
+                            printPerfStage(s, static_cast<double>(s.totals.calls) * numStars, "star");
+                        }
+                    } else {
+                        counters.reset();
+                        if (!counters.setEnabled(true)) {
+                            printf("counters: timing only, %s\n", counters.unavailableReason().c_str());
+                        } else {
+                            printf("counters on\n");
+                        }
+                    }
+                }
+                if (e.key.code == sf::Keyboard::Q) {
+                    qualityOn = !qualityOn;
+                    quality.reset();
+                    if (qualityOn) quality.openLog("galaxy_quality.csv");
+                    else           quality.closeLog();
+                    // The controller paces frames itself (below)
+                    window.setFramerateLimit(qualityOn ? 0 : 60);
+                    printf("quality controller %s (%.2f ms budget)\n", qualityOn ? "on" : "off",
+                           quality.config.budgetMs);
+                }
+                if (e.key.code == sf::Keyboard::F9) {
+                    profiler.setEnabled(!profiler.enabled());
+                    profileClock.restart();
+                    printf("profiler %s\n", profiler.enabled() ? "on" : "off");
+                }
+                if (e.key.code == sf::Keyboard::F10) {
+                    if (profiler.writeChromeTrace("galaxy_trace.json")) printf("wrote galaxy_trace.json\n");
+                    printProfileSummary(profiler.summarize(profileWindow), profileWindow);
+                }
             }
         }
 
+        // Hot reload: physics in place, re-seed only for the star count;
+        // lens / view values are read below every frame
+        int changed = scene.poll();
+        printSceneReload(scene.path, changed);
+        const SceneParams& sp = scene.params;
+        if (changed & (SCENE_SIM | SCENE_SIM_RESET)) applySceneSim(sim.P, sp);
+        if (changed & SCENE_SIM_RESET) {
+            numStars = max(1, static_cast<int>(sp.numStars));
+            sim.init(numStars);
+            starVertices.resize(numStars);
+        }
+
+        // Star count the controller currently allows
+        const int sceneStars = max(1, static_cast<int>(sp.numStars));
+        const int wantStars  = qualityOn
+            ? max(1, static_cast<int>(sceneStars * quality.value(qStars)))
+            : sceneStars;
+        if (wantStars != numStars) {
+            numStars = wantStars;
+            sim.resize(numStars);
+            starVertices.resize(numStars);
+        }
+        float scale = sp.viewScale;
+
+        const float viewDt = viewClock.restart().asSeconds();
+        const float viewSpeed = 45.0f;   // degrees per second
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Up))    tiltOffset += viewSpeed * viewDt;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Down))  tiltOffset -= viewSpeed * viewDt;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left))  yawOffset  -= viewSpeed * viewDt;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right)) yawOffset  += viewSpeed * viewDt;
+        const float tilt = max(-90.0f, min(90.0f, sp.viewTiltDegrees + tiltOffset));
+        tiltOffset = tilt - sp.viewTiltDegrees;
+        const float DEG = 3.14159265f / 180.0f;
+        const GalaxyProjection view(centerScreen.x, centerScreen.y, scale, tilt * DEG,
+                                    (sp.viewYawDegrees + yawOffset) * DEG);
+
         (void)clock.restart();
 
         // ---- Phase 1: update simulation ----
-        sim.step();
+        {
+            PROFILE_SCOPE("sim step");
+            sim.step();
+            diagnostics.afterStep(sim);
+        }
 
         // ---- Phase 2: update vertices ----
-        for (int i = 0; i < NUM_STARS; ++i) {
-            float x = sim.posX[i];
-            float y = sim.posY[i];
-
-            sf::Vector2f screenPos(
-                centerScreen.x + x * scale,
-                centerScreen.y + y * scale
-            );
-
-            starVertices[i].position = screenPos;
-            starVertices[i].color =
-                starColor(sim.velX[i], sim.velY[i], sim.brightness[i]);
+        {
+            PROFILE_SCOPE("vertex build");
+            if (!sim.threeD && view.faceOn()) {
+                for (int i = 0; i < numStars; ++i) {
+                    float x = sim.posX[i];
+                    float y = sim.posY[i];
+
+                    sf::Vector2f screenPos(
+                        centerScreen.x + x * scale,
+                        centerScreen.y + y * scale
+                    );
+
+                    starVertices[i].position = screenPos;
+                    starVertices[i].color =
+                        starColor(sim.velX[i], sim.velY[i], sim.brightness[i]);
+                }
+            } else {
+                for (int i = 0; i < numStars; ++i) {
+                    float sx, sy;
+                    view.project(sim.posX[i], sim.posY[i], sim.threeD ? sim.posZ[i] : 0.0f, sx, sy);
+                    starVertices[i].position = sf::Vector2f(sx, sy);
+                    starVertices[i].color =
+                        starColor(sim.velX[i], sim.velY[i], sim.brightness[i]);
+                }
+            }
         }
 
         // ---- Draw into trailRT ----
-        trailRT.setView(trailRT.getDefaultView());
+        {
+            PROFILE_SCOPE("trail fade + draw");
+            trailRT.setView(trailRT.getDefaultView());
 
-        trailRT.draw(fadeRect, sf::BlendAlpha);
-        trailRT.draw(starVertices, sf::BlendAdd);
+            trailRT.draw(fadeRect, sf::BlendAlpha);
+            trailRT.draw(starVertices, sf::BlendAdd);
 
 
-        trailRT.display();
+            trailRT.display();
+        }
 
         // ---- PHASE 4: Apply lensing shader ----
-                // ---- PHASE 4: Apply lensing shader ----
-        lensShader.setUniform("tex", trailRT.getTexture());
-        lensShader.setUniform("resolution", sf::Vector2f(WINDOW_W, WINDOW_H));
-        lensShader.setUniform("center", centerScreen);
-
-        // A+ enhanced values (with 3D warp)
-        lensShader.setUniform("lensStrength", 18000.0f);          // radial lensing
-        lensShader.setUniform("ringRadius", 110.0f);              // photon ring radius (in pixels)
-        lensShader.setUniform("ringWidth", 3.0f);                 // ring thickness
-        lensShader.setUniform("ringBoost", 3.5f);                 // how bright the ring is
-        lensShader.setUniform("dopplerBoost", 0.7f);              // stronger asymmetry
-        lensShader.setUniform("tint", sf::Glsl::Vec3(1.1f, 1.05f, 0.95f));
-
-        // PHASE 5: 3D disk warping controls
-        lensShader.setUniform("verticalWarpStrength", 40.0f);     // how high the disk bends
-        lensShader.setUniform("verticalWarpFalloff", 260.0f);     // larger = bend farther out
-        lensShader.setUniform("shearStrength", 9000.0f);          // twisting around BH
-        lensShader.setUniform("ringEccentricity", 1.4f);          // >1 = taller photon ring
-
+        lens.set(lStrength, sp.lensStrength);
+        lens.set(lRingRadius, sp.ringRadius);
+        lens.set(lRingWidth, sp.ringWidth);
+        lens.set(lRingBoost, sp.ringBoost);
+        lens.set(lDoppler, sp.dopplerBoost);
+        lens.set(lTint, sp.tint[0], sp.tint[1], sp.tint[2]);
+        lens.set(lWarp, sp.verticalWarpStrength);
+        lens.set(lFalloff, sp.verticalWarpFalloff);
+        lens.set(lShear, sp.shearStrength);
+        lens.set(lEcc, sp.ringEccentricity);
+
+        {
+            PROFILE_SCOPE("lens pass");
+            lens.upload<sf::Glsl::Vec2, sf::Glsl::Vec3>(lensShader);
+
+            // ---- Present on window ----
+            window.clear(sf::Color::Black);
+
+            sf::Sprite finalImage(trailRT.getTexture());
+            window.draw(finalImage, &lensShader);
+        }
 
-        // ---- Present on window ----
-        window.clear(sf::Color::Black);
+        {
+            PROFILE_SCOPE("present");
+            window.display();
+        }
 
-        sf::Sprite finalImage(trailRT.getTexture());
-        window.draw(finalImage, &lensShader);
+        // Work time excludes the pacing sleep, which is the headroom
+        if (qualityOn) {
+            double workMs = workClock.getElapsedTime().asMicroseconds() / 1000.0;
+            quality.frame(workMs);
+            if (workMs < quality.config.budgetMs) {
+                sf::sleep(sf::microseconds(static_cast<sf::Int64>((quality.config.budgetMs - workMs) * 1000.0)));
+            }
+        }
 
-        window.display();
+        if (profiler.enabled() && profileClock.getElapsedTime().asSeconds() > profileWindow) {
+            printProfileSummary(profiler.summarize(profileWindow), profileWindow);
+            profileClock.restart();
+        }
     }
 
     return 0;
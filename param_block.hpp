@@ -0,0 +1,134 @@
+// ============================================
+// Dirty-tracked shader parameter blocks
+// ============================================
+//
+// One typed field per shader uniform. set() compares against the stored
+// value and only a real change marks the field dirty; upload() pushes
+// the dirty fields and nothing else. Uniform values live in the GL
+// program, so a value uploaded once stays until it changes.
+//
+// Each field also carries group bits (caller-defined, e.g. "affects the
+// traced geodesics"). Every real change bumps a version counter for
+// each of its groups, so a cache keys on version(GROUP) instead of
+// comparing copies of the parameters.
+//
+// No SFML here: upload<Vec2, Vec3>(shader) works with anything that has
+// setUniform(name, float / int / bool / Vec2 / Vec3).
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum ParamType { PARAM_FLOAT, PARAM_INT, PARAM_BOOL, PARAM_VEC2, PARAM_VEC3 };
+
+const int PARAM_MAX_GROUPS = 8;
+
+class ParamBlock {
+public:
+    using Id = int;
+
+    Id addFloat(const char* name, float v, unsigned groups = 0) { return add(name, PARAM_FLOAT, groups, v, 0, 0, 0); }
+    Id addInt  (const char* name, int v,   unsigned groups = 0) { return add(name, PARAM_INT,   groups, 0, 0, 0, v); }
+    Id addBool (const char* name, bool v,  unsigned groups = 0) { return add(name, PARAM_BOOL,  groups, 0, 0, 0, v ? 1 : 0); }
+    Id addVec2 (const char* name, float x, float y, unsigned groups = 0) {
+        return add(name, PARAM_VEC2, groups, x, y, 0, 0);
+    }
+    Id addVec3 (const char* name, float x, float y, float z, unsigned groups = 0) {
+        return add(name, PARAM_VEC3, groups, x, y, z, 0);
+    }
+
+    // Setters return true if the value actually changed
+    bool set(Id id, float v)  { return assign(id, v, 0, 0, 0); }
+    bool set(Id id, int v)    { return assign(id, 0, 0, 0, v); }
+    bool set(Id id, bool v)   { return assign(id, 0, 0, 0, v ? 1 : 0); }
+    bool set(Id id, float x, float y)          { return assign(id, x, y, 0, 0); }
+    bool set(Id id, float x, float y, float z) { return assign(id, x, y, z, 0); }
+
+    float getFloat(Id id) const { return fields[id].f[0]; }
+    int   getInt(Id id)   const { return fields[id].i; }
+    bool  getBool(Id id)  const { return fields[id].i != 0; }
+    const float* getVec(Id id) const { return fields[id].f; }
+
+    // Number of real changes to fields in group (a single bit)
+    std::uint64_t version(unsigned group) const {
+        for (int g = 0; g < PARAM_MAX_GROUPS; ++g) {
+            if (group == (1u << g)) return versions[g];
+        }
+        return 0;
+    }
+
+    int dirtyCount() const {
+        int n = 0;
+        for (const Field& f : fields) n += f.dirty ? 1 : 0;
+        return n;
+    }
+
+    // Force a full upload (e.g. after the shader is reloaded)
+    void markAllDirty() {
+        for (Field& f : fields) f.dirty = true;
+    }
+
+    // Push dirty fields; returns how many were uploaded
+    template <class Vec2, class Vec3, class Shader>
+    int upload(Shader& shader) {
+        int n = 0;
+        for (Field& f : fields) {
+            if (!f.dirty) continue;
+            switch (f.type) {
+                case PARAM_FLOAT: shader.setUniform(f.name, f.f[0]); break;
+                case PARAM_INT:   shader.setUniform(f.name, f.i); break;
+                case PARAM_BOOL:  shader.setUniform(f.name, f.i != 0); break;
+                case PARAM_VEC2:  shader.setUniform(f.name, Vec2(f.f[0], f.f[1])); break;
+                case PARAM_VEC3:  shader.setUniform(f.name, Vec3(f.f[0], f.f[1], f.f[2])); break;
+            }
+            f.dirty = false;
+            ++n;
+        }
+        uploads += n;
+        return n;
+    }
+
+    std::uint64_t uploads = 0;   // total setUniform calls issued
+
+private:
+    struct Field {
+        std::string name;
+        ParamType   type;
+        unsigned    groups;
+        float       f[3];
+        int         i;
+        bool        dirty;
+    };
+
+    std::vector<Field> fields;
+    std::uint64_t versions[PARAM_MAX_GROUPS] = {};
+
+    Id add(const char* name, ParamType type, unsigned groups, float x, float y, float z, int i) {
+        Field f;
+        f.name   = name;
+        f.type   = type;
+        f.groups = groups;
+        f.f[0] = x; f.f[1] = y; f.f[2] = z;
+        f.i      = i;
+        f.dirty  = true;     // first upload sends everything
+        fields.push_back(f);
+        return static_cast<Id>(fields.size() - 1);
+    }
+
+    bool assign(Id id, float x, float y, float z, int i) {
+        Field& f = fields[id];
+        bool same = f.f[0] == x && f.i == i &&
+                    (f.type != PARAM_VEC2 || f.f[1] == y) &&
+                    (f.type != PARAM_VEC3 || (f.f[1] == y && f.f[2] == z));
+        if (same) return false;
+        f.f[0] = x; f.f[1] = y; f.f[2] = z;
+        f.i = i;
+        f.dirty = true;
+        for (int g = 0; g < PARAM_MAX_GROUPS; ++g) {
+            if (f.groups & (1u << g)) ++versions[g];
+        }
+        return true;
+    }
+};
@@ -0,0 +1,417 @@
+// ============================================
+// Hardware performance counters per profiled stage
+// ============================================
+//
+// Timing says how long step() or the vertex build took, not whether it
+// waited on memory or on arithmetic. With counters on, every
+// PROFILE_SCOPE also reads cycles, instructions, last-level cache
+// misses and branch misses for the calling thread at entry and exit,
+// and adds the difference to that stage's totals for the thread. Low
+// IPC with many LLC misses per item is memory bound; high IPC is
+// compute bound.
+//
+// Linux perf_event_open, one counter group per thread (the four events
+// are scheduled on the PMU together), user space only, so
+// perf_event_paranoid <= 2 is enough. If the PMU is shared and the
+// group only ran part of the time, a scope's counts are scaled by the
+// time enabled / time running that passed during that scope.
+//
+// Where the events can't be opened (no PMU in most VMs, paranoid 3,
+// not Linux) setEnabled(true) returns false with the reason in
+// unavailableReason(), and stages still get calls and time. An event that
+// alone fails (some CPUs lack a generic LLC miss event) is left out.
+//
+// Off by default: a scope then costs one more relaxed load. A read is
+// a syscall (about a microsecond), so counters suit coarse stages such
+// as a step or a tile. Building with -DBH_PERF=0 removes them.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef BH_PERF
+#ifdef __linux__
+#define BH_PERF 1
+#else
+#define BH_PERF 0
+#endif
+#endif
+
+#if BH_PERF
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+enum PerfEvent {
+    PERF_CYCLES        = 0,
+    PERF_INSTRUCTIONS  = 1,
+    PERF_LLC_MISSES    = 2,
+    PERF_BRANCH_MISSES = 3,
+    PERF_EVENT_COUNT   = 4
+};
+
+inline const char* perfEventName(int e) {
+    static const char* names[PERF_EVENT_COUNT] = { "cycles", "instructions", "LLC misses",
+                                                   "branch misses" };
+    return e >= 0 && e < PERF_EVENT_COUNT ? names[e] : "?";
+}
+
+// Raw counts since the thread's group was opened, with the group's
+// time enabled / running. Scaling waits for the scope's exit: the
+// cumulative ratio can drop between two readings, so scaled totals
+// would not be monotonic
+struct PerfReading {
+    std::uint64_t value[PERF_EVENT_COUNT] = {};
+    std::uint64_t enabledNs = 0;
+    std::uint64_t runningNs = 0;
+    bool valid = false;   // false: this thread has no counters
+};
+
+struct PerfOpenScope {
+    PerfReading   reading;
+    std::uint64_t startNs = 0;
+};
+
+struct PerfTotals {
+    std::uint64_t calls = 0;
+    std::uint64_t ns    = 0;
+    std::uint64_t value[PERF_EVENT_COUNT] = {};
+
+    void add(const PerfTotals& o) {
+        calls += o.calls;
+        ns    += o.ns;
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) value[e] += o.value[e];
+    }
+
+    double ipc() const {
+        return value[PERF_CYCLES] ? static_cast<double>(value[PERF_INSTRUCTIONS]) / value[PERF_CYCLES]
+                                  : 0.0;
+    }
+};
+
+// One stage on one lane (thread), or on all lanes when lane < 0
+struct PerfStageTotals {
+    std::string stage;
+    int         lane = -1;
+    std::string threadName;
+    PerfTotals  totals;
+};
+
+// ----------------------
+// One thread's counter group and stage totals
+// ----------------------
+struct PerfThreadCounters {
+    int fd[PERF_EVENT_COUNT];
+    std::uint64_t id[PERF_EVENT_COUNT] = {};
+    int         lane = 0;
+    const char* threadName = nullptr;
+    bool        attempted = false;   // open() tried for the current thread
+    std::vector<PerfOpenScope> scopeStack;   // scopes entered, innermost last
+
+    // Owner adds, report reads
+    std::mutex lock;
+    std::map<const char*, PerfTotals> stages;   // stage names are literals
+
+    PerfThreadCounters() {
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) fd[e] = -1;
+    }
+    ~PerfThreadCounters() { close(); }
+
+    // Opens the group for the calling thread; returns the events that
+    // opened as a bit mask (0 = none), errno of the first failure in err
+    unsigned open(int& err) {
+        close();
+        attempted = true;
+        err = 0;
+        unsigned opened = 0;
+#if BH_PERF
+        static const std::uint64_t config[PERF_EVENT_COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+        int leader = -1;
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size           = sizeof(attr);
+            attr.type           = PERF_TYPE_HARDWARE;
+            attr.config         = config[e];
+            attr.exclude_kernel = 1;
+            attr.exclude_hv     = 1;
+            attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_ID |
+                                  PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            int f = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+            if (f < 0) {
+                if (!err) err = errno;
+                continue;
+            }
+            ioctl(f, PERF_EVENT_IOC_ID, &id[e]);
+            fd[e] = f;
+            opened |= 1u << e;
+            if (leader < 0) leader = f;
+        }
+#endif
+        return opened;
+    }
+
+    void close() {
+        attempted = false;
+#if BH_PERF
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+            if (fd[e] >= 0) ::close(fd[e]);
+            fd[e] = -1;
+        }
+#endif
+    }
+
+    bool read(PerfReading& out) const {
+#if BH_PERF
+        int leader = -1;
+        for (int e = 0; e < PERF_EVENT_COUNT && leader < 0; ++e) leader = fd[e];
+        if (leader < 0) return false;
+
+        // nr, time enabled, time running, then (value, id) per event
+        std::uint64_t buf[3 + 2 * PERF_EVENT_COUNT];
+        ssize_t got = ::read(leader, buf, sizeof(buf));
+        if (got < static_cast<ssize_t>(3 * sizeof(std::uint64_t))) return false;
+
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) out.value[e] = 0;
+        const std::uint64_t maxEvents = PERF_EVENT_COUNT;
+        const std::uint64_t nr = buf[0] < maxEvents ? buf[0] : maxEvents;
+        out.enabledNs = buf[1];
+        out.runningNs = buf[2];
+        for (std::uint64_t i = 0; i < nr; ++i) {
+            for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+                if (fd[e] >= 0 && id[e] == buf[4 + 2 * i]) out.value[e] = buf[3 + 2 * i];
+            }
+        }
+        out.valid = true;
+        return true;
+#else
+        (void)out;
+        return false;
+#endif
+    }
+};
+
+// ----------------------
+// Process-wide counters
+// ----------------------
+// Lanes are handed out and returned like the frame profiler's rings:
+// a returning lane keeps its totals and reopens its group for the new
+// thread, so per-frame worker threads fold into a few lanes.
+class PerfCounters {
+public:
+    static PerfCounters& instance() {
+        static PerfCounters counters;
+        return counters;
+    }
+
+    // Static, so an idle scope checks it without the instance() guard
+    static bool enabled() { return on.load(std::memory_order_relaxed); }
+
+    // Probes on the calling thread; false when no event opens (stages
+    // are then timed only)
+    bool setEnabled(bool v) {
+        on.store(v, std::memory_order_relaxed);
+        if (!v) return true;
+        PerfThreadCounters& t = threadCounters();
+        if (!t.attempted) {
+            int err = 0;
+            unsigned opened = t.open(err);
+            noteOpen(opened, err);
+        }
+        return openedEvents != 0;
+    }
+
+    bool eventAvailable(int e) const { return (openedEvents >> e) & 1u; }
+    const std::string& unavailableReason() const { return reason; }
+
+    void setThreadName(const char* name) { threadCounters().threadName = name; }
+
+    // Scope entry and exit. Scopes nest, so the entry readings live on
+    // a per-thread stack rather than in the scope object. A thread's
+    // group is opened on its first scope after enabling (when the probe
+    // found any events)
+    void begin() {
+        PerfThreadCounters& t = threadCounters();
+        if (!t.attempted && openedEvents) {
+            int err = 0;
+            t.open(err);
+        }
+        t.scopeStack.emplace_back();
+        t.read(t.scopeStack.back().reading);
+        t.scopeStack.back().startNs = nowNs();
+    }
+
+    void end(const char* stage) {
+        std::uint64_t endNs = nowNs();
+        PerfThreadCounters& t = threadCounters();
+        if (t.scopeStack.empty()) return;   // enabled inside the scope
+        PerfOpenScope start = t.scopeStack.back();
+        t.scopeStack.pop_back();
+        PerfReading now;
+        bool counted = start.reading.valid && t.read(now);
+
+        std::lock_guard<std::mutex> guard(t.lock);
+        PerfTotals& s = t.stages[stage];
+        ++s.calls;
+        s.ns += endNs - start.startNs;
+        if (!counted) return;
+        // The group did not run during the scope: nothing to scale
+        const std::uint64_t running = now.runningNs - start.reading.runningNs;
+        if (running == 0) return;
+        const double scale = static_cast<double>(now.enabledNs - start.reading.enabledNs) / running;
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+            const std::uint64_t raw = now.value[e] - start.reading.value[e];
+            s.value[e] += static_cast<std::uint64_t>(raw * scale + 0.5);
+        }
+    }
+
+    // Per stage and lane, ordered by stage
+    std::vector<PerfStageTotals> perLane() const {
+        std::map<std::pair<std::string, int>, PerfStageTotals> merged;
+        std::lock_guard<std::mutex> lock(registry);
+        for (const auto& t : lanes) {
+            std::lock_guard<std::mutex> guard(t->lock);
+            for (const auto& kv : t->stages) {
+                PerfStageTotals& s = merged[std::make_pair(std::string(kv.first), t->lane)];
+                s.stage      = kv.first;
+                s.lane       = t->lane;
+                s.threadName = t->threadName ? t->threadName : "worker";
+                s.totals.add(kv.second);
+            }
+        }
+        std::vector<PerfStageTotals> out;
+        for (auto& kv : merged) out.push_back(kv.second);
+        return out;
+    }
+
+    // Per stage, summed over lanes
+    std::vector<PerfStageTotals> perStage() const {
+        std::map<std::string, PerfStageTotals> merged;
+        for (const PerfStageTotals& s : perLane()) {
+            PerfStageTotals& m = merged[s.stage];
+            m.stage = s.stage;
+            m.totals.add(s.totals);
+        }
+        std::vector<PerfStageTotals> out;
+        for (auto& kv : merged) out.push_back(kv.second);
+        return out;
+    }
+
+    void reset() {
+        std::lock_guard<std::mutex> lock(registry);
+        for (const auto& t : lanes) {
+            std::lock_guard<std::mutex> guard(t->lock);
+            t->stages.clear();
+        }
+    }
+
+private:
+    static inline std::atomic<bool> on{false};
+    std::atomic<unsigned> openedEvents{0};   // events the first group opened
+    std::string reason;
+    const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    mutable std::mutex registry;
+    std::vector<std::unique_ptr<PerfThreadCounters>> lanes;
+    std::vector<PerfThreadCounters*> freeLanes;
+
+    PerfCounters() = default;
+
+    std::uint64_t nowNs() const {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch).count());
+    }
+
+    void noteOpen(unsigned opened, int err) {
+        std::lock_guard<std::mutex> lock(registry);
+        if (opened) {
+            openedEvents = opened;
+            reason.clear();
+            return;
+        }
+#if BH_PERF
+        reason = std::string("perf_event_open: ") + std::strerror(err);
+        if (err == ENOENT || err == EOPNOTSUPP) reason += " (no hardware PMU, e.g. a VM)";
+        if (err == EACCES || err == EPERM)      reason += " (see /proc/sys/kernel/perf_event_paranoid)";
+#else
+        (void)err;
+        reason = "hardware counters need Linux perf_event_open";
+#endif
+    }
+
+    struct LaneHandle {
+        PerfThreadCounters* lane = nullptr;
+        ~LaneHandle() {
+            if (lane) PerfCounters::instance().release(lane);
+        }
+    };
+
+    PerfThreadCounters& threadCounters() {
+        thread_local LaneHandle handle;
+        if (!handle.lane) handle.lane = acquire();
+        return *handle.lane;
+    }
+
+    PerfThreadCounters* acquire() {
+        std::lock_guard<std::mutex> lock(registry);
+        if (!freeLanes.empty()) {
+            PerfThreadCounters* t = freeLanes.back();
+            freeLanes.pop_back();
+            return t;
+        }
+        lanes.emplace_back(new PerfThreadCounters());
+        lanes.back()->lane = static_cast<int>(lanes.size()) - 1;
+        return lanes.back().get();
+    }
+
+    // Counters count the thread that opened them, so the next owner
+    // reopens
+    void release(PerfThreadCounters* t) {
+        t->close();
+        t->scopeStack.clear();
+        std::lock_guard<std::mutex> lock(registry);
+        freeLanes.push_back(t);
+    }
+};
+
+// ----------------------
+// Report
+// ----------------------
+// Per item (star, ray, ...): ns, cycles, LLC and branch misses; n/a for
+// events this machine doesn't count
+inline void printPerfStage(const PerfStageTotals& s, double items, const char* itemName) {
+    const PerfCounters& pc = PerfCounters::instance();
+    const PerfTotals& t = s.totals;
+    const double n = items > 0.0 ? items : 1.0;
+
+    char lane[48] = "";
+    if (s.lane >= 0) std::snprintf(lane, sizeof(lane), " [%d %s]", s.lane, s.threadName.c_str());
+    std::printf("  %-20s%-12s %7llu calls  %8.2f ns/%s", s.stage.c_str(), lane,
+                static_cast<unsigned long long>(t.calls), t.ns / n, itemName);
+
+    auto column = [&](int e, const char* fmt, double v) {
+        if (pc.eventAvailable(e)) std::printf(fmt, v);
+        else                      std::printf("  %s n/a", perfEventName(e));
+    };
+    column(PERF_CYCLES, "  %8.1f cyc", t.value[PERF_CYCLES] / n);
+    if (pc.eventAvailable(PERF_CYCLES) && pc.eventAvailable(PERF_INSTRUCTIONS)) {
+        std::printf("  IPC %4.2f", t.ipc());
+    }
+    column(PERF_LLC_MISSES,    "  %7.3f LLC miss", t.value[PERF_LLC_MISSES] / n);
+    column(PERF_BRANCH_MISSES, "  %7.3f br miss", t.value[PERF_BRANCH_MISSES] / n);
+    std::printf("\n");
+}
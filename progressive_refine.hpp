@@ -0,0 +1,63 @@
+// ============================================
+// Progressive refinement for interactive camera moves
+// ============================================
+//
+// When the camera moves, only one pixel per 4x4 block is traced (1/16
+// of the rays) and copied over its block. While the camera then stays
+// still, each following frame traces the next 1/16 of the pixels, in
+// 4x4 Bayer order so every phase is spread evenly over the image, until
+// all 16 phases are in and the buffer equals a full trace.
+//
+// Pixel (x, y) belongs to phase BAYER4[y & 3][x & 3]; phase 0 is the
+// block anchor (x % 4 == 0, y % 4 == 0). bh_raymarch.frag uses the same
+// table (uProgressPass), counted in gl_FragCoord space.
+
+#pragma once
+
+#include "bh_raymarch_cpu.hpp"
+
+const int PROGRESSIVE_BLOCK  = 4;
+const int PROGRESSIVE_PHASES = PROGRESSIVE_BLOCK * PROGRESSIVE_BLOCK;
+
+const int BAYER4[4][4] = {
+    {  0,  8,  2, 10 },
+    { 12,  4, 14,  6 },
+    {  3, 11,  1,  9 },
+    { 15,  7, 13,  5 },
+};
+
+inline int progressivePhase(int x, int y) { return BAYER4[y & 3][x & 3]; }
+
+// Calls fn(x, y) for the pixels of the rect that belong to `phase`
+template <class PixelFn>
+inline void forEachPhasePixel(int rx0, int ry0, int rx1, int ry1, int phase, PixelFn fn) {
+    for (int y = ry0; y < ry1; ++y) {
+        for (int x = rx0; x < rx1; ++x) {
+            if (progressivePhase(x, y) == phase) fn(x, y);
+        }
+    }
+}
+
+// traceRectPacket for one phase: the phase's pixels are gathered and
+// traced W at a time. Lanes don't interact, so each pixel gets
+// exactly the result a full trace would give it.
+template <int W, class ResultFn>
+inline void traceRectPhasePacket(const RayMarchParams& p, const RayFrame& f,
+                                 int rx0, int ry0, int rx1, int ry1, int phase,
+                                 ResultFn onResult) {
+    const int hgt = static_cast<int>(p.resolutionY);
+
+    std::vector<int> pixX, pixY;
+    forEachPhasePixel(rx0, ry0, rx1, ry1, phase, [&](int x, int y) {
+        pixX.push_back(x);
+        pixY.push_back(y);
+    });
+
+    RayPacket<W> packet;
+    packet.traceStream(p, f, static_cast<int>(pixX.size()),
+        [&](int i, float& fragX, float& fragY) {
+            fragX = pixX[i] + 0.5f;
+            fragY = hgt - pixY[i] - 0.5f;
+        },
+        [&](int i, const RayResult& res) { onResult(pixX[i], pixY[i], res); });
+}
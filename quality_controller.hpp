@@ -0,0 +1,224 @@
+// ============================================
+// Frame-budget quality controller
+// ============================================
+//
+// Holds the frame time at a budget (16.7 ms for 60 fps, or a fixed
+// frame time for video capture) by moving quality knobs within their
+// bounds: step tolerance / size, resolution scale and quality tier for
+// the ray march, star count for the galaxy.
+//
+// The mains feed it each frame's work time, from the top of the loop
+// through display(). While it runs they switch SFML's frame limiter
+// off and sleep out the rest of the budget themselves, so the
+// controller sees real cost and headroom, not the limiter's sleep.
+//
+// Decisions use the 90th percentile of the last `window` frames:
+//   p90 > budget * overBudget    degrade one notch
+//   p90 < budget * underBudget   restore one notch
+// and nothing changes in between (the hysteresis band). After a change
+// the window restarts, so the next decision only sees frames rendered
+// with the new setting, and `cooldown` more frames pass before it.
+// A restore that has to be undone within a few windows means that
+// notch is bigger than the headroom; restores then need twice as many
+// consecutive under-budget frames (up to 8 windows), so the controller
+// settles instead of flapping.
+//
+// Knobs form a ladder in the order they are added (least visible
+// first). Degrading moves the first active knob that is not yet at its
+// bound; restoring moves the last degraded one back. Every adjustment
+// is printed, and also written to the CSV log if one is open.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct FrameBudgetConfig {
+    double budgetMs    = 1000.0 / 60.0;
+    double overBudget  = 1.05;   // p90 above budget * this: degrade
+    double underBudget = 0.70;   // p90 below budget * this: restore
+    int    window      = 30;     // frames per decision
+    int    cooldown    = 15;     // frames after a change before measuring again
+};
+
+// ----------------------
+// Knob: `best` is full quality, `worst` the bound. Multiplicative
+// knobs move by factor `step` per notch (e.g. 0.85 for a scale that
+// shrinks, 1.25 for a tolerance that grows), additive ones by `step`
+// ----------------------
+struct QualityKnob {
+    std::string name;
+    double value    = 1.0;
+    double best     = 1.0;
+    double worst    = 1.0;
+    double step     = 1.0;
+    bool   multiply = true;
+    bool   active   = true;    // false: no effect in the current mode, skipped
+
+    bool atWorst() const { return std::fabs(value - worst) < 1e-9; }
+    bool atBest()  const { return std::fabs(value - best) < 1e-9; }
+
+    double clampToRange(double v) const {
+        return std::min(std::max(v, std::min(best, worst)), std::max(best, worst));
+    }
+
+    void degrade() { value = clampToRange(multiply ? value * step : value + step); }
+
+    void restore() {
+        value = clampToRange(multiply ? value / step : value - step);
+        // Land exactly on best, not a float hair away after n notches
+        if (std::fabs(value - best) < std::fabs(best) * 1e-6 + 1e-9) value = best;
+    }
+};
+
+struct QualityAdjustment {
+    std::uint64_t frame = 0;
+    double p90Ms  = 0.0;
+    int    knob   = -1;
+    double from   = 0.0;
+    double to     = 0.0;
+    bool   degrade = false;
+};
+
+class QualityController {
+public:
+    FrameBudgetConfig config;
+
+    int addKnob(const std::string& name, double best, double worst, double step, bool multiply) {
+        QualityKnob k;
+        k.name     = name;
+        k.value    = best;
+        k.best     = best;
+        k.worst    = worst;
+        k.step     = step;
+        k.multiply = multiply;
+        knobs.push_back(k);
+        return static_cast<int>(knobs.size()) - 1;
+    }
+
+    double value(int knob) const { return knobs[knob].value; }
+    const QualityKnob& knob(int knob) const { return knobs[knob]; }
+    void setActive(int knob, bool active) { knobs[knob].active = active; }
+
+    // New full-quality point (e.g. the user picked another tier): the
+    // knob starts from it again
+    void rebase(int knob, double best) {
+        knobs[knob].best  = best;
+        knobs[knob].value = best;
+    }
+
+    // Everything back to full quality, measurements dropped
+    void reset() {
+        for (QualityKnob& k : knobs) k.value = k.best;
+        recent.clear();
+        wait = 0;
+        underStreak = 0;
+        restoreBackoff = 1;
+    }
+
+    bool openLog(const char* path) {
+        closeLog();
+        log = std::fopen(path, "w");
+        if (!log) return false;
+        std::fprintf(log, "frame,p90_ms,budget_ms,knob,from,to,direction\n");
+        return true;
+    }
+
+    void closeLog() {
+        if (log) std::fclose(log);
+        log = nullptr;
+    }
+
+    ~QualityController() { closeLog(); }
+
+    // One frame's work time; true when a knob moved this frame
+    bool frame(double workMs) {
+        ++frames;
+        if (wait > 0) {
+            --wait;
+            return false;
+        }
+        recent.push_back(workMs);
+        if (static_cast<int>(recent.size()) < config.window) return false;
+
+        double p90 = percentile(0.90);
+        recent.erase(recent.begin());
+
+        const bool under = p90 < config.budgetMs * config.underBudget;
+        underStreak = under ? underStreak + 1 : 0;
+
+        int target = -1;
+        bool degrade = false;
+        if (p90 > config.budgetMs * config.overBudget) {
+            for (size_t i = 0; i < knobs.size() && target < 0; ++i) {
+                if (knobs[i].active && !knobs[i].atWorst()) target = static_cast<int>(i);
+            }
+            degrade = true;
+        } else if (under && underStreak > (restoreBackoff - 1) * config.window) {
+            for (size_t i = knobs.size(); i-- > 0 && target < 0;) {
+                if (knobs[i].active && !knobs[i].atBest()) target = static_cast<int>(i);
+            }
+        }
+        if (target < 0) return false;
+
+        // Undoing the last restore: that notch doesn't fit, back off
+        if (degrade && adjustments > 0 && !last.degrade && last.knob == target &&
+            frames - last.frame < static_cast<std::uint64_t>(3 * (config.window + config.cooldown))) {
+            restoreBackoff = std::min(restoreBackoff * 2, 8);
+        }
+
+        QualityAdjustment a;
+        a.frame   = frames;
+        a.p90Ms   = p90;
+        a.knob    = target;
+        a.from    = knobs[target].value;
+        a.degrade = degrade;
+        if (degrade) knobs[target].degrade();
+        else         knobs[target].restore();
+        a.to = knobs[target].value;
+
+        last = a;
+        ++adjustments;
+        report(a);
+        recent.clear();
+        underStreak = 0;
+        wait = config.cooldown;
+        return true;
+    }
+
+    std::uint64_t frames      = 0;
+    std::uint64_t adjustments = 0;
+    QualityAdjustment last;
+
+private:
+    std::vector<QualityKnob> knobs;
+    std::vector<double> recent;   // work ms, oldest first
+    int   wait = 0;
+    int   underStreak    = 0;   // consecutive decisions under budget
+    int   restoreBackoff = 1;   // restores wait (backoff - 1) windows of those
+    FILE* log  = nullptr;
+
+    double percentile(double q) const {
+        std::vector<double> sorted(recent);
+        std::sort(sorted.begin(), sorted.end());
+        size_t i = static_cast<size_t>(q * sorted.size());
+        return sorted[std::min(i, sorted.size() - 1)];
+    }
+
+    void report(const QualityAdjustment& a) const {
+        const QualityKnob& k = knobs[a.knob];
+        std::printf("quality: frame %llu p90 %.2f ms (budget %.2f) -> %s %s %.4g -> %.4g\n",
+                    static_cast<unsigned long long>(a.frame), a.p90Ms, config.budgetMs,
+                    a.degrade ? "lower" : "raise", k.name.c_str(), a.from, a.to);
+        if (log) {
+            std::fprintf(log, "%llu,%.3f,%.3f,%s,%.6g,%.6g,%s\n",
+                         static_cast<unsigned long long>(a.frame), a.p90Ms, config.budgetMs,
+                         k.name.c_str(), a.from, a.to, a.degrade ? "lower" : "raise");
+            std::fflush(log);
+        }
+    }
+};
@@ -0,0 +1,192 @@
+// ============================================
+// Ray-march statistics: step counts and exit reasons
+// ============================================
+//
+// Per-pixel steps and RayExit codes for one frame, plus the histograms
+// used to tune uStepSize / uStepTolerance and the step cap against real
+// cost: how many steps rays actually take, why they stop, and where the
+// step budget goes (rays that hit the cap spend the most and buy
+// nothing).
+//
+// Filled either from the CPU packet tracer (collectRayMarchStats) or
+// from a readback of the shader's BH_DEBUG_STATS variant
+// (decodeDebugStatsPixel). writeStepHeatmap draws the step counts as a
+// false-color PPM, with capped rays in white.
+
+#pragma once
+
+#include "bh_raymarch_cpu.hpp"
+#include "tile_scheduler.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+inline const char* rayExitName(int code) {
+    switch (code) {
+        case RAY_EXIT_HORIZON:  return "horizon";
+        case RAY_EXIT_DISK:     return "disk";
+        case RAY_EXIT_ESCAPE:   return "escape (maxDist)";
+        case RAY_EXIT_LEAVING:  return "left influence";
+        case RAY_EXIT_SKIPPED:  return "missed influence";
+        case RAY_EXIT_STEP_CAP: return "step cap";
+        default:                return "unknown";
+    }
+}
+
+struct RayMarchStats {
+    int width = 0, height = 0;
+    int maxSteps = 0;
+
+    // Per pixel, row 0 = top
+    std::vector<std::uint16_t> steps;
+    std::vector<std::uint8_t>  exits;
+
+    // Built by finalize()
+    std::vector<std::uint64_t> stepHistogram;   // [0, maxSteps]
+    std::uint64_t exitRays[RAY_EXIT_COUNT]  = {};
+    std::uint64_t exitSteps[RAY_EXIT_COUNT] = {};
+    std::uint64_t totalSteps = 0;
+    int           mostSteps  = 0;
+
+    void reset(int w, int h, int cap) {
+        width    = w;
+        height   = h;
+        maxSteps = cap;
+        steps.assign(static_cast<size_t>(w) * h, 0);
+        exits.assign(static_cast<size_t>(w) * h, RAY_EXIT_NONE);
+    }
+
+    // Pixels are independent, so tiles may record concurrently
+    void record(int x, int y, int n, int exit) {
+        size_t i = static_cast<size_t>(y) * width + x;
+        steps[i] = static_cast<std::uint16_t>(n < 0 ? 0 : (n > 65535 ? 65535 : n));
+        exits[i] = static_cast<std::uint8_t>(exit < RAY_EXIT_COUNT ? exit : RAY_EXIT_NONE);
+    }
+
+    void finalize() {
+        int top = maxSteps;
+        for (std::uint16_t n : steps) top = n > top ? n : top;
+        stepHistogram.assign(top + 1, 0);
+        for (int e = 0; e < RAY_EXIT_COUNT; ++e) exitRays[e] = exitSteps[e] = 0;
+        totalSteps = 0;
+        mostSteps  = 0;
+
+        for (size_t i = 0; i < steps.size(); ++i) {
+            ++stepHistogram[steps[i]];
+            ++exitRays[exits[i]];
+            exitSteps[exits[i]] += steps[i];
+            totalSteps += steps[i];
+            mostSteps = steps[i] > mostSteps ? steps[i] : mostSteps;
+        }
+    }
+
+    size_t rays() const { return steps.size(); }
+
+    double meanSteps() const { return rays() ? static_cast<double>(totalSteps) / rays() : 0.0; }
+
+    // Smallest step count that q of the rays stay within
+    int stepPercentile(double q) const {
+        std::uint64_t want = static_cast<std::uint64_t>(q * rays() + 0.5);
+        std::uint64_t seen = 0;
+        for (size_t n = 0; n < stepHistogram.size(); ++n) {
+            seen += stepHistogram[n];
+            if (seen >= want && seen > 0) return static_cast<int>(n);
+        }
+        return mostSteps;
+    }
+};
+
+// ----------------------
+// CPU: packet tracer over work-stealing tiles
+// ----------------------
+template <class V = RayTierMedium>
+inline double collectRayMarchStats(const RayMarchParams& p, RayMarchStats& out, int threads) {
+    const int w = static_cast<int>(p.resolutionX);
+    const int h = static_cast<int>(p.resolutionY);
+    out.reset(w, h, V::maxSteps);
+
+    RayFrame f = makeRayFrame(p);
+    std::vector<RenderTile> tiles = makeTileGrid(w, h, 32);
+    estimateRayMarchTileCosts(p, f, tiles);
+
+    std::vector<TileWorkerStats> workers;
+    double seconds = runTilesWorkStealing(tiles, threads,
+        [&](const RenderTile& t, int) {
+            traceRectPacket<8, V>(p, f, t.x0, t.y0, t.x1, t.y1,
+                [&](int x, int y, const RayResult& res) { out.record(x, y, res.steps, res.exit); });
+        },
+        workers);
+
+    out.finalize();
+    return seconds;
+}
+
+// ----------------------
+// GPU: one RGBA8 pixel of the BH_DEBUG_STATS variant
+// (steps as 16-bit fixed point in r, g; exit code in b)
+// ----------------------
+inline void decodeDebugStatsPixel(const std::uint8_t* rgba, int& steps, int& exit) {
+    steps = rgba[0] * 256 + rgba[1];
+    exit  = rgba[2];
+}
+
+// ----------------------
+// Output
+// ----------------------
+// Black -> blue -> magenta -> orange -> yellow by steps / maxSteps,
+// white where the ray ran out of steps
+inline void stepHeatColor(float t, unsigned char rgb[3]) {
+    static const float ramp[5][3] = {
+        { 0.00f, 0.00f, 0.00f },
+        { 0.10f, 0.10f, 0.60f },
+        { 0.70f, 0.10f, 0.60f },
+        { 1.00f, 0.50f, 0.10f },
+        { 1.00f, 0.95f, 0.30f },
+    };
+    t = clampf(t, 0.0f, 1.0f) * 4.0f;
+    int   i = t >= 4.0f ? 3 : static_cast<int>(t);
+    float u = t - i;
+    for (int c = 0; c < 3; ++c) {
+        float v = ramp[i][c] + (ramp[i + 1][c] - ramp[i][c]) * u;
+        rgb[c] = static_cast<unsigned char>(v * 255.0f + 0.5f);
+    }
+}
+
+inline bool writeStepHeatmap(const char* path, const RayMarchStats& s) {
+    FILE* f = std::fopen(path, "wb");
+    if (!f) return false;
+    std::fprintf(f, "P6\n%d %d\n255\n", s.width, s.height);
+
+    std::vector<unsigned char> row(static_cast<size_t>(s.width) * 3);
+    const float scale = 1.0f / (s.maxSteps > 0 ? s.maxSteps : 1);
+    for (int y = 0; y < s.height; ++y) {
+        for (int x = 0; x < s.width; ++x) {
+            size_t i = static_cast<size_t>(y) * s.width + x;
+            unsigned char* px = &row[static_cast<size_t>(x) * 3];
+            if (s.exits[i] == RAY_EXIT_STEP_CAP) {
+                px[0] = px[1] = px[2] = 255;
+            } else {
+                stepHeatColor(s.steps[i] * scale, px);
+            }
+        }
+        std::fwrite(row.data(), 1, row.size(), f);
+    }
+    return std::fclose(f) == 0;
+}
+
+inline void printRayMarchStats(const RayMarchStats& s) {
+    const double n = s.rays() ? static_cast<double>(s.rays()) : 1.0;
+    const double total = s.totalSteps ? static_cast<double>(s.totalSteps) : 1.0;
+    std::printf("  steps/ray mean %.2f  p50 %d  p95 %d  p99 %d  max %d  (cap %d)\n",
+                s.meanSteps(), s.stepPercentile(0.50), s.stepPercentile(0.95),
+                s.stepPercentile(0.99), s.mostSteps, s.maxSteps);
+    std::printf("  exit                  rays   %% rays  %% of steps  steps/ray\n");
+    for (int e = 0; e < RAY_EXIT_COUNT; ++e) {
+        if (!s.exitRays[e]) continue;
+        std::printf("  %-18s %8llu  %6.2f%%  %9.2f%%  %9.2f\n", rayExitName(e),
+                    static_cast<unsigned long long>(s.exitRays[e]), s.exitRays[e] * 100.0 / n,
+                    s.exitSteps[e] * 100.0 / total,
+                    static_cast<double>(s.exitSteps[e]) / s.exitRays[e]);
+    }
+}
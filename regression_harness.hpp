@@ -0,0 +1,305 @@
+// ============================================
+// Golden-image and timing regression harness
+// ============================================
+//
+// Renders fixed scenes headless (ray-march camera poses, the galaxy
+// after K steps from a fixed seed), compares each image to a stored
+// golden PPM with a tolerance, and compares its time to a stored
+// baseline. Meant to run before landing an optimization in the marcher
+// or GalaxySim::step: a visual change or a slowdown fails the run.
+//
+// Images: pixels whose largest channel difference is above
+// badThreshold (of 255) count as bad. A case fails if too many pixels
+// are bad or the mean difference is too high. That lets rays that
+// graze the horizon or a disk edge, and chaotic stars after many steps,
+// flip on last-ulp differences without hiding a real change. A failing
+// case leaves <name>.out.ppm and <name>.diff.ppm next to its golden.
+//
+// Timing: `repeats` runs of the case's timed section, taken round-robin
+// across the suite and summarized as the best run and the spread (75th
+// percentile minus best), against timings.txt in the golden directory.
+// Best-of is the least noisy estimate on a shared machine, and the
+// spread is how noisy the host is. Host contention comes in stretches
+// of seconds, so back-to-back runs would all share one. A case is slow
+// when its best run exceeds the baseline's by more than `slowdown`, and
+// by more than `noiseK` times the larger of the recorded and the current
+// spread, and still does after as many rounds again. So the limit never
+// sits inside the measured jitter.
+//
+// Goldens and baselines are per machine: FMA contraction and libm
+// differ between compilers and CPUs, and times only compare on the
+// host that recorded them. Record them with update = true.
+
+#pragma once
+
+#include "galaxy_frame_cpu.hpp"
+#include "galaxy_sim.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// ----------------------
+// 8-bit RGB image
+// ----------------------
+struct RegressImage {
+    int width = 0, height = 0;
+    std::vector<std::uint8_t> rgb;
+
+    void resize(int w, int h) {
+        width  = w;
+        height = h;
+        rgb.assign(static_cast<size_t>(w) * h * 3, 0);
+    }
+};
+
+// Float RGB in [0, 1] (the renderers' output) to 8-bit, as writePPM does
+inline void regressImageFromFloat(const std::vector<float>& rgb, int w, int h, RegressImage& out) {
+    out.resize(w, h);
+    for (size_t i = 0; i < out.rgb.size(); ++i) {
+        float v = rgb[i] < 0.0f ? 0.0f : (rgb[i] > 1.0f ? 1.0f : rgb[i]);
+        out.rgb[i] = static_cast<std::uint8_t>(v * 255.0f + 0.5f);
+    }
+}
+
+inline bool writeRegressImage(const std::string& path, const RegressImage& img) {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    std::fprintf(f, "P6\n%d %d\n255\n", img.width, img.height);
+    std::fwrite(img.rgb.data(), 1, img.rgb.size(), f);
+    return std::fclose(f) == 0;
+}
+
+// Binary P6 with maxval 255, as written above
+inline bool readRegressImage(const std::string& path, RegressImage& img) {
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return false;
+    int w = 0, h = 0, maxval = 0;
+    bool ok = std::fscanf(f, "P6 %d %d %d", &w, &h, &maxval) == 3 && maxval == 255 &&
+              w > 0 && h > 0 && std::fgetc(f) != EOF;
+    if (ok) {
+        img.resize(w, h);
+        ok = std::fread(img.rgb.data(), 1, img.rgb.size(), f) == img.rgb.size();
+    }
+    std::fclose(f);
+    return ok;
+}
+
+// ----------------------
+// Comparison
+// ----------------------
+struct RegressTolerance {
+    int    badThreshold = 24;      // channel difference (of 255) that makes a pixel bad
+    double badFraction  = 0.002;   // allowed fraction of bad pixels
+    double meanAbs      = 0.5;     // allowed mean channel difference (of 255)
+    double slowdown     = 0.20;    // allowed time over baseline, at least...
+    double noiseK       = 3.0;     // ...and at least this many spreads
+};
+
+struct ImageDiff {
+    bool   sameSize = false;
+    double meanAbs  = 0.0;   // per channel, of 255
+    int    maxAbs   = 0;
+    double badFraction = 0.0;
+};
+
+// Also fills diff (grey = largest channel difference, x4) when given
+inline ImageDiff compareImages(const RegressImage& a, const RegressImage& b, int badThreshold,
+                               RegressImage* diff = nullptr) {
+    ImageDiff d;
+    d.sameSize = a.width == b.width && a.height == b.height;
+    if (!d.sameSize) return d;
+    if (diff) diff->resize(a.width, a.height);
+
+    const size_t pixels = static_cast<size_t>(a.width) * a.height;
+    std::uint64_t sum = 0, bad = 0;
+    for (size_t i = 0; i < pixels; ++i) {
+        int worst = 0;
+        for (int c = 0; c < 3; ++c) {
+            int e = std::abs(a.rgb[i * 3 + c] - b.rgb[i * 3 + c]);
+            sum += e;
+            worst = std::max(worst, e);
+        }
+        d.maxAbs = std::max(d.maxAbs, worst);
+        if (worst > badThreshold) ++bad;
+        if (diff) {
+            std::uint8_t g = static_cast<std::uint8_t>(std::min(255, worst * 4));
+            diff->rgb[i * 3 + 0] = diff->rgb[i * 3 + 1] = diff->rgb[i * 3 + 2] = g;
+        }
+    }
+    d.meanAbs     = pixels ? static_cast<double>(sum) / (pixels * 3) : 0.0;
+    d.badFraction = pixels ? static_cast<double>(bad) / pixels : 0.0;
+    return d;
+}
+
+// ----------------------
+// Timing baselines: "name best spread" per line, in seconds
+// ----------------------
+struct RegressTiming {
+    double best   = 0.0;   // fastest run
+    double spread = 0.0;   // 75th percentile - best: the host's jitter
+};
+
+inline RegressTiming summarizeTimes(std::vector<double> seconds) {
+    RegressTiming t;
+    if (seconds.empty()) return t;
+    std::sort(seconds.begin(), seconds.end());
+    t.best   = seconds.front();
+    t.spread = seconds[(seconds.size() - 1) * 3 / 4] - t.best;
+    return t;
+}
+
+// Files from before the spread was recorded read with spread 0
+inline std::map<std::string, RegressTiming> readTimingBaselines(const std::string& path) {
+    std::map<std::string, RegressTiming> out;
+    FILE* f = std::fopen(path.c_str(), "r");
+    if (!f) return out;
+    char line[256];
+    while (std::fgets(line, sizeof(line), f)) {
+        char name[128];
+        RegressTiming t;
+        if (std::sscanf(line, "%127s %lf %lf", name, &t.best, &t.spread) >= 2) out[name] = t;
+    }
+    std::fclose(f);
+    return out;
+}
+
+inline bool writeTimingBaselines(const std::string& path,
+                                 const std::map<std::string, RegressTiming>& t) {
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    for (const auto& kv : t) {
+        std::fprintf(f, "%s %.6f %.6f\n", kv.first.c_str(), kv.second.best, kv.second.spread);
+    }
+    return std::fclose(f) == 0;
+}
+
+// ----------------------
+// Cases
+// ----------------------
+// render fills the image and returns the seconds of the section being
+// guarded (e.g. the sim steps, not the splat that makes them visible)
+struct RegressCase {
+    std::string name;
+    std::function<double(RegressImage&)> render;
+};
+
+struct RegressResult {
+    std::string name;
+    bool   haveGolden = false;
+    bool   imageOk    = false;
+    ImageDiff diff;
+    RegressTiming timing;
+    RegressTiming baseline;  // best 0 = none recorded
+    double limit    = 0.0;   // slowest best run that still passes
+    bool   timeOk   = true;
+};
+
+// Runs every case `repeats` times, round-robin: a case's runs are spread
+// over the whole suite rather than back to back, so a few seconds of
+// host contention land in its spread instead of shifting all its runs.
+// Slow cases trigger up to `repeats` more rounds of the whole suite
+// (a real slowdown stays slow, a contended stretch has moved on).
+inline std::vector<RegressResult> runRegressSuite(const std::vector<RegressCase>& cases,
+                                                  const std::string& dir, bool update,
+                                                  const RegressTolerance& tol, int repeats,
+                                                  std::map<std::string, RegressTiming>& baselines) {
+    const size_t n = cases.size();
+    std::vector<RegressResult> results(n);
+    std::vector<RegressImage> images(n);
+    std::vector<std::vector<double>> seconds(n);
+
+    auto round = [&]() {
+        for (size_t i = 0; i < n; ++i) {
+            RegressImage again;
+            seconds[i].push_back(cases[i].render(seconds[i].empty() ? images[i] : again));
+            results[i].timing = summarizeTimes(seconds[i]);
+        }
+    };
+    for (int i = 0; i < repeats; ++i) round();
+
+    // Limit: over the baseline by `slowdown` and by noiseK spreads,
+    // taking the noisier of the recorded host and this one
+    auto judge = [&]() {
+        bool allOk = true;
+        for (RegressResult& r : results) {
+            if (r.baseline.best <= 0.0) continue;
+            double noise = tol.noiseK * std::max(r.baseline.spread, r.timing.spread);
+            r.limit  = r.baseline.best + std::max(r.baseline.best * tol.slowdown, noise);
+            r.timeOk = r.timing.best <= r.limit;
+            allOk = allOk && r.timeOk;
+        }
+        return allOk;
+    };
+
+    for (size_t i = 0; i < n; ++i) {
+        RegressResult& r = results[i];
+        r.name = cases[i].name;
+        const std::string golden = dir + "/" + r.name + ".ppm";
+        if (update) {
+            r.haveGolden = r.imageOk = writeRegressImage(golden, images[i]);
+            baselines[r.name] = r.timing;
+            continue;
+        }
+
+        auto base = baselines.find(r.name);
+        if (base != baselines.end()) r.baseline = base->second;
+
+        RegressImage ref;
+        r.haveGolden = readRegressImage(golden, ref);
+        if (!r.haveGolden) continue;
+
+        RegressImage diffImg;
+        r.diff = compareImages(images[i], ref, tol.badThreshold, &diffImg);
+        r.imageOk = r.diff.sameSize && r.diff.badFraction <= tol.badFraction &&
+                    r.diff.meanAbs <= tol.meanAbs;
+        if (!r.imageOk) {
+            writeRegressImage(dir + "/" + r.name + ".out.ppm", images[i]);
+            if (r.diff.sameSize) writeRegressImage(dir + "/" + r.name + ".diff.ppm", diffImg);
+        }
+    }
+
+    if (!update) {
+        for (int i = 0; i < repeats && !judge(); ++i) round();
+    }
+    return results;
+}
+
+inline void printRegressResult(const RegressResult& r) {
+    if (!r.haveGolden) {
+        std::printf("  %-20s  no golden\n", r.name.c_str());
+        return;
+    }
+    char timing[64] = "";
+    if (r.baseline.best > 0.0) {
+        std::snprintf(timing, sizeof(timing), "%8.1f ms (%+5.1f%%, limit %+5.1f%%)",
+                      r.timing.best * 1e3, (r.timing.best / r.baseline.best - 1.0) * 100.0,
+                      (r.limit / r.baseline.best - 1.0) * 100.0);
+    } else {
+        std::snprintf(timing, sizeof(timing), "%8.1f ms (no baseline)", r.timing.best * 1e3);
+    }
+    if (!r.diff.sameSize) {
+        std::printf("  %-20s  size differs from golden  %s\n", r.name.c_str(), timing);
+        return;
+    }
+    std::printf("  %-20s  mean %.3f  max %3d  bad %.4f%%  %s  %s%s\n", r.name.c_str(),
+                r.diff.meanAbs, r.diff.maxAbs, r.diff.badFraction * 100.0, timing,
+                r.imageOk ? "" : "IMAGE ", r.timeOk ? "" : "SLOW");
+}
+
+// ----------------------
+// Galaxy frame
+// ----------------------
+// The galaxy viewer's star pass without trails or lens
+// (galaxy_frame_cpu.hpp), over the trail background
+inline void renderGalaxyFrame(const GalaxySim& sim, int w, int h, float scale, RegressImage& out) {
+    out.resize(w, h);
+    for (size_t i = 0; i < out.rgb.size(); i += 3) out.rgb[i + 2] = 10;
+    splatGalaxyStars(sim, w, h, scale, out.rgb.data());
+}
@@ -0,0 +1,407 @@
+// ============================================
+// Distributed tile rendering over TCP
+// ============================================
+//
+// A coordinator cuts a still into tiles and hands them to worker
+// processes (same host or other machines) over TCP. Workers trace
+// each tile with the packet tracer and stream it back as 8-bit RGB.
+// The coordinator writes it into the output file at its offsets
+// (StillFile, tiled_still.hpp), so it never holds the frame either.
+//
+// Protocol, host byte order (farm nodes run the same build):
+//   on connect   coordinator -> worker  FARM_MAGIC, sizeof(params), params
+//   per tile     coordinator -> worker  FarmTileMsg (id < 0 = no more work)
+//                worker -> coordinator  FarmTileMsg, tile rows as RGB8
+//
+// Each worker has one tile in flight. A worker that disconnects or
+// errors out loses its tile back to the front of the queue, where the
+// next idle worker picks it up; workers may join at any time. With no
+// workers left the coordinator keeps waiting for new ones.
+//
+// A node that hangs or drops off the network sends no FIN, so each
+// tile also has a deadline (tileTimeout): past it the worker is
+// dropped and the tile requeued. Results are read without blocking,
+// into a per-worker buffer, so a peer that stalls mid-tile only holds
+// up its own tile. TCP keepalive on both ends finds dead idle peers.
+//
+// POSIX sockets (the render farm nodes are Linux). Building with
+// -DBH_FARM=0, or on Windows, leaves the farm out.
+
+#pragma once
+
+#ifndef BH_FARM
+#ifdef _WIN32
+#define BH_FARM 0
+#else
+#define BH_FARM 1
+#endif
+#endif
+
+#if BH_FARM
+
+#include "bh_raymarch_cpu.hpp"
+#include "tiled_still.hpp"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+const std::uint32_t FARM_MAGIC = 0x42484652;   // "BHFR"
+const double FARM_TILE_TIMEOUT = 60.0;          // seconds a tile may be out
+
+struct FarmTileMsg {
+    std::int32_t id = -1;
+    std::int32_t x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+};
+
+struct FarmStats {
+    double seconds     = 0.0;
+    int    tiles       = 0;
+    int    workersSeen = 0;
+    int    workersLost = 0;
+    int    timedOut    = 0;   // of those, dropped for missing a deadline
+    int    reassigned  = 0;   // tiles handed out again after a loss
+};
+
+// ----------------------
+// Socket helpers: whole-buffer send / receive, false on EOF or error
+// ----------------------
+inline bool farmSendAll(int fd, const void* data, size_t n) {
+    const char* p = static_cast<const char*>(data);
+    while (n > 0) {
+        ssize_t k = ::send(fd, p, n, MSG_NOSIGNAL);
+        if (k <= 0) return false;
+        p += k;
+        n -= static_cast<size_t>(k);
+    }
+    return true;
+}
+
+inline bool farmRecvAll(int fd, void* data, size_t n) {
+    char* p = static_cast<char*>(data);
+    while (n > 0) {
+        ssize_t k = ::recv(fd, p, n, 0);
+        if (k <= 0) return false;
+        p += k;
+        n -= static_cast<size_t>(k);
+    }
+    return true;
+}
+
+// Whatever has arrived, up to n bytes: the count, 0 if nothing is
+// waiting, -1 on EOF or error
+inline long farmRecvSome(int fd, void* data, size_t n) {
+    ssize_t k = ::recv(fd, data, n, MSG_DONTWAIT);
+    if (k > 0) return static_cast<long>(k);
+    if (k < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 0;
+    return -1;
+}
+
+// Keepalive probes after 10 s idle, so a peer that vanished without a
+// FIN shows up as an error instead of silence; sends give up after
+// 10 s instead of blocking on a full buffer
+inline void farmSetSocketOptions(int fd) {
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    ::setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+#ifdef TCP_KEEPIDLE
+    int idle = 10, interval = 5, count = 3;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+    ::setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    ::setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+#endif
+    timeval sendTimeout;
+    sendTimeout.tv_sec  = 10;
+    sendTimeout.tv_usec = 0;
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &sendTimeout, sizeof(sendTimeout));
+}
+
+// Listening socket on port (0 = any free port); boundPort gets the port
+inline int farmListen(int port, int& boundPort) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port        = htons(static_cast<std::uint16_t>(port));
+    socklen_t len = sizeof(addr);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(fd, 64) != 0 ||
+        ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    boundPort = ntohs(addr.sin_port);
+    return fd;
+}
+
+// Connect, retrying for up to `seconds` while the coordinator starts
+inline int farmConnect(const char* host, int port, double seconds) {
+    char service[16];
+    std::snprintf(service, sizeof(service), "%d", port);
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    auto start = std::chrono::steady_clock::now();
+    while (true) {
+        addrinfo* list = nullptr;
+        if (::getaddrinfo(host, service, &hints, &list) == 0) {
+            for (addrinfo* a = list; a; a = a->ai_next) {
+                int fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+                if (fd < 0) continue;
+                if (::connect(fd, a->ai_addr, a->ai_addrlen) == 0) {
+                    ::freeaddrinfo(list);
+                    farmSetSocketOptions(fd);
+                    return fd;
+                }
+                ::close(fd);
+            }
+            ::freeaddrinfo(list);
+        }
+        std::chrono::duration<double> waited = std::chrono::steady_clock::now() - start;
+        if (waited.count() > seconds) return -1;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+}
+
+// ----------------------
+// Coordinator: hand out tiles of p to whoever connects on listenFd,
+// write results into path. A tile not back within tileTimeout seconds
+// goes to another worker. Returns false on a file error.
+// ----------------------
+inline bool runFarmCoordinator(const RayMarchParams& p, int listenFd, const char* path,
+                               int tileSize, FarmStats& stats,
+                               double tileTimeout = FARM_TILE_TIMEOUT) {
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+
+    const int w = static_cast<int>(p.resolutionX);
+    const int h = static_cast<int>(p.resolutionY);
+
+    StillFile file;
+    if (!file.open(path, w, h)) {
+        file.close();
+        return false;
+    }
+
+    RayFrame f = makeRayFrame(p);
+    std::vector<RenderTile> tiles = makeTileGrid(w, h, tileSize);
+    estimateRayMarchTileCosts(p, f, tiles);
+    std::stable_sort(tiles.begin(), tiles.end(),
+                     [](const RenderTile& a, const RenderTile& b) { return a.cost > b.cost; });
+
+    // Expensive tiles first, so the tail of the frame is cheap
+    std::deque<int> pending;
+    for (int i = 0; i < static_cast<int>(tiles.size()); ++i) pending.push_back(i);
+
+    // The result of the tile in flight arrives in pieces: header, then
+    // rows, `got` bytes of the two so far
+    struct Worker {
+        int fd       = -1;
+        int inFlight = -1;
+        Clock::time_point deadline;
+        FarmTileMsg header;
+        size_t got = 0;
+        std::vector<unsigned char> rgb8;
+    };
+    std::vector<Worker> workers;
+    const auto timeout = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(tileTimeout));
+
+    stats = FarmStats();
+    stats.tiles = static_cast<int>(tiles.size());
+    int done = 0;
+    bool ok = true;
+
+    auto sendTile = [&](Worker& wk, int id) {
+        FarmTileMsg m;
+        m.id = id;
+        if (id >= 0) {
+            const RenderTile& t = tiles[id];
+            m.x0 = t.x0; m.y0 = t.y0; m.x1 = t.x1; m.y1 = t.y1;
+        }
+        return farmSendAll(wk.fd, &m, sizeof(m));
+    };
+
+    auto drop = [&](Worker& wk) {
+        ::close(wk.fd);
+        wk.fd = -1;
+        ++stats.workersLost;
+        if (wk.inFlight >= 0) {
+            pending.push_front(wk.inFlight);
+            ++stats.reassigned;
+            wk.inFlight = -1;
+        }
+    };
+
+    // Reads what has arrived; a complete tile goes to the file. false
+    // on EOF, error or a reply that isn't the tile in flight
+    auto receive = [&](Worker& wk) {
+        const size_t head = sizeof(FarmTileMsg);
+        while (true) {
+            long k;
+            if (wk.got < head) {
+                k = farmRecvSome(wk.fd, reinterpret_cast<char*>(&wk.header) + wk.got, head - wk.got);
+            } else {
+                k = farmRecvSome(wk.fd, wk.rgb8.data() + (wk.got - head), wk.rgb8.size() - (wk.got - head));
+            }
+            if (k < 0) return false;
+            if (k == 0) return true;
+            wk.got += static_cast<size_t>(k);
+
+            if (wk.got == head) {
+                if (wk.inFlight < 0 || wk.header.id != wk.inFlight) return false;
+                const RenderTile& t = tiles[wk.inFlight];
+                wk.rgb8.resize(static_cast<size_t>(t.x1 - t.x0) * (t.y1 - t.y0) * 3);
+            }
+            if (wk.got > head && wk.got == head + wk.rgb8.size()) {
+                if (!file.writeTile(tiles[wk.inFlight], wk.rgb8.data())) ok = false;
+                wk.inFlight = -1;
+                wk.got = 0;
+                ++done;
+                return true;
+            }
+        }
+    };
+
+    while (done < stats.tiles && ok) {
+        // Idle workers get the next tile
+        for (Worker& wk : workers) {
+            if (wk.fd < 0 || wk.inFlight >= 0 || pending.empty()) continue;
+            int id = pending.front();
+            pending.pop_front();
+            wk.inFlight = id;
+            wk.got      = 0;
+            wk.deadline = Clock::now() + timeout;
+            if (!sendTile(wk, id)) drop(wk);
+        }
+        workers.erase(std::remove_if(workers.begin(), workers.end(),
+                                     [](const Worker& wk) { return wk.fd < 0; }),
+                      workers.end());
+
+        std::vector<pollfd> fds(1 + workers.size());
+        fds[0].fd = listenFd;
+        fds[0].events = POLLIN;
+        for (size_t i = 0; i < workers.size(); ++i) {
+            fds[i + 1].fd = workers[i].fd;
+            fds[i + 1].events = POLLIN;
+        }
+        int ready = ::poll(fds.data(), fds.size(), 250);
+
+        for (size_t i = 0; ready > 0 && i < workers.size(); ++i) {
+            if (!(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            if (!receive(workers[i])) drop(workers[i]);
+        }
+
+        // Hung or unreachable: the tile goes back to the queue
+        const auto now = Clock::now();
+        for (Worker& wk : workers) {
+            if (wk.fd >= 0 && wk.inFlight >= 0 && now > wk.deadline) {
+                ++stats.timedOut;
+                drop(wk);
+            }
+        }
+        if (ready <= 0) continue;
+
+        if (fds[0].revents & POLLIN) {
+            Worker wk;
+            wk.fd = ::accept(listenFd, nullptr, nullptr);
+            if (wk.fd >= 0) {
+                std::uint32_t hello[2] = { FARM_MAGIC, static_cast<std::uint32_t>(sizeof(RayMarchParams)) };
+                farmSetSocketOptions(wk.fd);
+                if (farmSendAll(wk.fd, hello, sizeof(hello)) &&
+                    farmSendAll(wk.fd, &p, sizeof(p))) {
+                    workers.push_back(wk);
+                    ++stats.workersSeen;
+                } else {
+                    ::close(wk.fd);
+                }
+            }
+        }
+    }
+
+    // Tell everyone to stop
+    for (Worker& wk : workers) {
+        sendTile(wk, -1);
+        ::close(wk.fd);
+    }
+    if (!file.close()) ok = false;
+
+    stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return ok;
+}
+
+// ----------------------
+// Worker: render tiles until told to stop. For worker-loss testing,
+// dieAfter > 0 drops the connection mid-tile after that many tiles;
+// stallAfter > 0 then sends half a tile and goes silent with the
+// connection open, like a hung node, until the coordinator gives up.
+// Returns the number of tiles rendered, -1 on a protocol error.
+// ----------------------
+inline int runFarmWorker(const char* host, int port, int dieAfter, int stallAfter = 0) {
+    int fd = farmConnect(host, port, 10.0);
+    if (fd < 0) return -1;
+
+    std::uint32_t hello[2];
+    RayMarchParams p;
+    if (!farmRecvAll(fd, hello, sizeof(hello)) || hello[0] != FARM_MAGIC ||
+        hello[1] != sizeof(RayMarchParams) || !farmRecvAll(fd, &p, sizeof(p))) {
+        ::close(fd);
+        return -1;
+    }
+
+    RayFrame f = makeRayFrame(p);
+    std::vector<float> rgb;
+    std::vector<unsigned char> rgb8;
+    int rendered = 0;
+
+    FarmTileMsg m;
+    while (farmRecvAll(fd, &m, sizeof(m)) && m.id >= 0) {
+        if (dieAfter > 0 && rendered == dieAfter) break;
+
+        RenderTile t;
+        t.x0 = m.x0; t.y0 = m.y0; t.x1 = m.x1; t.y1 = m.y1;
+        size_t n = static_cast<size_t>(t.x1 - t.x0) * (t.y1 - t.y0) * 3;
+        rgb.resize(n);
+        rgb8.resize(n);
+        renderTileRGB8(p, f, t, rgb.data(), rgb8.data());
+
+        if (stallAfter > 0 && rendered == stallAfter) {
+            if (farmSendAll(fd, &m, sizeof(m)) && farmSendAll(fd, rgb8.data(), n / 2)) {
+                char c;
+                while (::recv(fd, &c, 1, 0) > 0) {}
+            }
+            break;
+        }
+        if (!farmSendAll(fd, &m, sizeof(m)) || !farmSendAll(fd, rgb8.data(), n)) break;
+        ++rendered;
+    }
+    ::close(fd);
+    return rendered;
+}
+
+#endif // BH_FARM
@@ -0,0 +1,289 @@
+// ============================================
+// Scene description file with hot reload
+// ============================================
+//
+// Plain "key = value" lines; vectors are three numbers ("camPos = 0 1 12").
+// '#' starts a comment. Keys not in the file take the defaults below.
+// The bending keys default like RayMarchParams (fixed step, no influence
+// skip, spin 0); the shipped scene.cfg opts in to the adaptive step, the
+// influence skip and a spinning hole. A line that fails to parse keeps
+// the key's last good value, so a half-typed edit doesn't snap the key
+// back to its default and re-trace a different scene.
+//
+// Every key belongs to one domain, and a reload reports the union of
+// the domains whose keys changed. Callers only drop the caches those
+// domains feed:
+//
+//   SCENE_TRACE      geodesics: G-buffer, CPU geodesic cache, LUT
+//   SCENE_SHADE      per-frame shading only (band, color) - no re-trace
+//   SCENE_CAMERA     resets the orbit camera; traced data follows
+//   SCENE_LENS       galaxy view / lensing uniforms only
+//   SCENE_SIM        galaxy physics constants, applied in place
+//   SCENE_SIM_RESET  galaxy star count / layout: re-seed
+//
+// The file is polled by mtime once per frame (one stat call).
+
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+enum SceneDomain {
+    SCENE_TRACE     = 1 << 0,
+    SCENE_SHADE     = 1 << 1,
+    SCENE_CAMERA    = 1 << 2,
+    SCENE_LENS      = 1 << 3,
+    SCENE_SIM       = 1 << 4,
+    SCENE_SIM_RESET = 1 << 5
+};
+
+struct SceneParams {
+    // Camera (main.cpp)
+    float camPos[3]    = { 0.0f, 1.0f, 12.0f };   // above + in front
+    float camTarget[3] = { 0.0f, 0.0f, 0.0f };
+    float fovDegrees   = 55.0f;
+
+    // Ray-march scene (main.cpp, bh_raymarch.frag)
+    float bhRadius        = 3.0f;
+    float diskInner       = 4.0f;
+    float diskOuter       = 10.0f;
+    float diskHeight      = 0.5f;
+    float diskTiltDegrees = 27.0f;
+    float gravStrength    = 0.8f;
+    float stepSize        = 0.10f;
+    float stepTolerance   = 0.0f;    // 0 = fixed stepSize
+    float spin            = 0.0f;    // a/M, Kerr only
+    float influenceRadius = 0.0f;    // 0 = off; clamped up to the disk
+    float diskRotation    = 0.5f;
+    float diskColorBase[3] = { 1.2f, 0.9f, 1.4f };
+
+    // Galaxy lensing (main_galaxy.cpp, lensing.frag)
+    float lensStrength         = 18000.0f;
+    float ringRadius           = 110.0f;
+    float ringWidth            = 3.0f;
+    float ringBoost            = 3.5f;
+    float dopplerBoost         = 0.7f;
+    float tint[3]              = { 1.1f, 1.05f, 0.95f };
+    float verticalWarpStrength = 40.0f;
+    float verticalWarpFalloff  = 260.0f;
+    float shearStrength        = 9000.0f;
+    float ringEccentricity     = 1.4f;
+
+    // Galaxy simulation (main_galaxy.cpp SimParams)
+    float G              = 2.0f;
+    float M_bh           = 400.0f;
+    float softening      = 0.5f;
+    float v0             = 2.2f;
+    float r_core         = 1.2f;
+    float dt             = 0.01f;
+    float integrator     = 0.0f;     // SimIntegrator: 0 Euler, 1 leapfrog
+    float viscosityBase  = 0.003f;
+    float viscosityCore  = 1.0f;
+    float heatScale      = 0.0012f;
+    float brightnessCool = 0.997f;
+    float horizonRadius  = 7.0f;
+    float respawnRMin    = 18.0f;
+    float respawnRMax    = 28.0f;
+    float numStars       = 10000.0f;
+    float galaxy3D          = 0.0f;   // 1: z position / velocity (GalaxySim 3D mode)
+    float galaxyThickness   = 0.6f;   // initial half-thickness of the 3D disk
+    float verticalRestoring = 0.5f;   // disk self-gravity toward the plane
+    float viewScale      = 12.0f;    // pixels per sim unit
+    float viewTiltDegrees = 0.0f;    // galaxy view: 0 face-on, 90 edge-on
+    float viewYawDegrees  = 0.0f;    // galaxy view: turn about the disk axis
+};
+
+struct SceneKey {
+    const char* name;
+    float*      value;
+    int         count;    // 1 or 3
+    int         domain;
+};
+
+inline std::vector<SceneKey> sceneKeys(SceneParams& s) {
+    return {
+        { "camPos",               s.camPos,                3, SCENE_CAMERA },
+        { "camTarget",            s.camTarget,             3, SCENE_CAMERA },
+        { "fovDegrees",           &s.fovDegrees,           1, SCENE_TRACE },
+        { "bhRadius",             &s.bhRadius,             1, SCENE_TRACE },
+        { "diskInner",            &s.diskInner,            1, SCENE_TRACE },
+        { "diskOuter",            &s.diskOuter,            1, SCENE_TRACE },
+        { "diskHeight",           &s.diskHeight,           1, SCENE_TRACE },
+        { "diskTiltDegrees",      &s.diskTiltDegrees,      1, SCENE_TRACE },
+        { "gravStrength",         &s.gravStrength,         1, SCENE_TRACE },
+        { "stepSize",             &s.stepSize,             1, SCENE_TRACE },
+        { "stepTolerance",        &s.stepTolerance,        1, SCENE_TRACE },
+        { "spin",                 &s.spin,                 1, SCENE_TRACE },
+        { "influenceRadius",      &s.influenceRadius,      1, SCENE_TRACE },
+        { "diskRotation",         &s.diskRotation,         1, SCENE_SHADE },
+        { "diskColorBase",        s.diskColorBase,         3, SCENE_SHADE },
+        { "lensStrength",         &s.lensStrength,         1, SCENE_LENS },
+        { "ringRadius",           &s.ringRadius,           1, SCENE_LENS },
+        { "ringWidth",            &s.ringWidth,            1, SCENE_LENS },
+        { "ringBoost",            &s.ringBoost,            1, SCENE_LENS },
+        { "dopplerBoost",         &s.dopplerBoost,         1, SCENE_LENS },
+        { "tint",                 s.tint,                  3, SCENE_LENS },
+        { "verticalWarpStrength", &s.verticalWarpStrength, 1, SCENE_LENS },
+        { "verticalWarpFalloff",  &s.verticalWarpFalloff,  1, SCENE_LENS },
+        { "shearStrength",        &s.shearStrength,        1, SCENE_LENS },
+        { "ringEccentricity",     &s.ringEccentricity,     1, SCENE_LENS },
+        { "G",                    &s.G,                    1, SCENE_SIM },
+        { "M_bh",                 &s.M_bh,                 1, SCENE_SIM },
+        { "softening",            &s.softening,            1, SCENE_SIM },
+        { "v0",                   &s.v0,                   1, SCENE_SIM },
+        { "r_core",               &s.r_core,               1, SCENE_SIM },
+        { "dt",                   &s.dt,                   1, SCENE_SIM },
+        { "integrator",           &s.integrator,           1, SCENE_SIM },
+        { "viscosityBase",        &s.viscosityBase,        1, SCENE_SIM },
+        { "viscosityCore",        &s.viscosityCore,        1, SCENE_SIM },
+        { "heatScale",            &s.heatScale,            1, SCENE_SIM },
+        { "brightnessCool",       &s.brightnessCool,       1, SCENE_SIM },
+        { "horizonRadius",        &s.horizonRadius,        1, SCENE_SIM },
+        { "respawnRMin",          &s.respawnRMin,          1, SCENE_SIM },
+        { "respawnRMax",          &s.respawnRMax,          1, SCENE_SIM },
+        { "numStars",             &s.numStars,             1, SCENE_SIM_RESET },
+        { "galaxy3D",             &s.galaxy3D,             1, SCENE_SIM_RESET },
+        { "galaxyThickness",      &s.galaxyThickness,      1, SCENE_SIM_RESET },
+        { "verticalRestoring",    &s.verticalRestoring,    1, SCENE_SIM },
+        { "viewScale",            &s.viewScale,            1, SCENE_LENS },
+        { "viewTiltDegrees",      &s.viewTiltDegrees,      1, SCENE_LENS },
+        { "viewYawDegrees",       &s.viewYawDegrees,       1, SCENE_LENS },
+    };
+}
+
+// ----------------------
+// Parsing: bad lines are reported and skipped, never fatal, so a
+// half-typed edit can't take the window down
+// ----------------------
+// `out` holds the current scene on entry. Keys the file sets are
+// overwritten, keys it doesn't mention go back to their defaults, and
+// keys whose only lines were rejected keep the value they had.
+inline std::string sceneTrim(const std::string& s) {
+    size_t a = s.find_first_not_of(" \t\r");
+    size_t b = s.find_last_not_of(" \t\r");
+    return a == std::string::npos ? std::string() : s.substr(a, b - a + 1);
+}
+
+inline bool parseSceneFile(const std::string& path, SceneParams& out) {
+    std::ifstream in(path);
+    if (!in) return false;
+
+    std::vector<SceneKey> keys = sceneKeys(out);
+    std::vector<bool> mentioned(keys.size(), false);
+
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+        ++lineNo;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        line = sceneTrim(line);
+        if (line.empty()) continue;
+
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            std::fprintf(stderr, "%s:%d: expected key = value\n", path.c_str(), lineNo);
+            continue;
+        }
+        std::string name  = sceneTrim(line.substr(0, eq));
+        std::string value = line.substr(eq + 1);
+
+        const SceneKey* key = nullptr;
+        for (size_t k = 0; k < keys.size(); ++k) {
+            if (name == keys[k].name) {
+                key = &keys[k];
+                mentioned[k] = true;
+            }
+        }
+        if (!key) {
+            std::fprintf(stderr, "%s:%d: unknown key '%s'\n", path.c_str(), lineNo, name.c_str());
+            continue;
+        }
+
+        float v[3];
+        const char* p = value.c_str();
+        int n = 0;
+        for (; n < key->count; ++n) {
+            char* end = nullptr;
+            v[n] = std::strtof(p, &end);
+            if (end == p) break;
+            p = end;
+        }
+        if (n != key->count || !sceneTrim(p).empty()) {
+            std::fprintf(stderr, "%s:%d: '%s' needs %d number%s\n", path.c_str(), lineNo,
+                         name.c_str(), key->count, key->count > 1 ? "s" : "");
+            continue;
+        }
+        for (int i = 0; i < n; ++i) key->value[i] = v[i];
+    }
+
+    SceneParams defaults;
+    std::vector<SceneKey> defaultKeys = sceneKeys(defaults);
+    for (size_t k = 0; k < keys.size(); ++k) {
+        if (mentioned[k]) continue;
+        for (int i = 0; i < keys[k].count; ++i) keys[k].value[i] = defaultKeys[k].value[i];
+    }
+    return true;
+}
+
+// Domains whose keys differ between a and b
+inline int sceneDiff(SceneParams a, SceneParams b) {
+    std::vector<SceneKey> ka = sceneKeys(a);
+    std::vector<SceneKey> kb = sceneKeys(b);
+    int mask = 0;
+    for (size_t i = 0; i < ka.size(); ++i) {
+        for (int c = 0; c < ka[i].count; ++c) {
+            if (ka[i].value[c] != kb[i].value[c]) mask |= ka[i].domain;
+        }
+    }
+    return mask;
+}
+
+// ----------------------
+// File + mtime watch
+// ----------------------
+struct SceneFile {
+    std::string path;
+    SceneParams params;
+    std::filesystem::file_time_type stamp{};
+    bool present = false;
+
+    // Initial load; a missing file keeps the defaults
+    void load(const std::string& p) {
+        path = p;
+        std::error_code ec;
+        stamp   = std::filesystem::last_write_time(path, ec);
+        present = !ec && parseSceneFile(path, params);
+        if (!present) std::fprintf(stderr, "%s not found, using built-in scene\n", path.c_str());
+    }
+
+    // Re-read if the file changed; returns the changed domains (0 = none)
+    int poll() {
+        std::error_code ec;
+        auto now = std::filesystem::last_write_time(path, ec);
+        if (ec || (present && now == stamp)) return 0;
+        stamp = now;
+
+        SceneParams next = params;
+        if (!parseSceneFile(path, next)) return 0;
+        present = true;
+        int changed = sceneDiff(params, next);
+        params = next;
+        return changed;
+    }
+};
+
+inline void printSceneReload(const std::string& path, int changed) {
+    if (!changed) return;
+    std::printf("%s reloaded:%s%s%s%s%s%s\n", path.c_str(),
+                changed & SCENE_TRACE     ? " re-trace" : "",
+                changed & SCENE_SHADE     ? " shading"  : "",
+                changed & SCENE_CAMERA    ? " camera"   : "",
+                changed & SCENE_LENS      ? " lens"     : "",
+                changed & SCENE_SIM       ? " physics"  : "",
+                changed & SCENE_SIM_RESET ? " re-seed"  : "");
+}
@@ -0,0 +1,456 @@
+// ============================================
+// Schwarzschild deflection lookup table
+// O(1) per-pixel lensing for a non-spinning hole
+// ============================================
+//
+// Every photon orbit around a Schwarzschild hole lies in a plane and
+// obeys the Binet equation
+//
+//     u'' + u = 3 M u^2,      u = 1/r,  ' = d/dphi
+//
+// so its shape depends only on the impact parameter b. We integrate it
+// once per b for a photon coming in from infinity (u = 0, u' = 1/b) and
+// tabulate
+//
+//   U(b, psi)     u and du/dpsi after sweeping psi radians, through
+//                 periapsis, until capture (u = 1/2M) or escape (u = 0)
+//   PsiIn(b, u)   psi at which the ingoing branch first reaches u
+//                 (the "emission radius" axis, r = 1/u)
+//
+// A camera ray is a point on one of these orbits: ingoing rays continue
+// forward along U from psi_c = PsiIn(b, 1/r_cam); outgoing rays are the
+// time-reverse of an ingoing one and run backwards from psi_c to 0. The
+// orbit plane meets the disk plane in a line through the hole, so the
+// disk can only be hit at psi_c +- (delta0 + k*pi). Each pixel costs a
+// handful of table lookups instead of up to RAY_MAX_STEPS march steps.
+//
+// Mass: the horizon (r = 2M) is put at bhRadius, i.e. M = bhRadius / 2.
+// This is true GR bending, so images differ from the 1/r^2 marcher.
+
+#pragma once
+
+#include "bh_raymarch_cpu.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+const float LUT_PI = 3.14159265f;
+
+struct SchwarzschildLut {
+    enum OrbitEnd : std::uint8_t {
+        END_ESCAPED  = 0,
+        END_CAPTURED = 1,
+        END_WINDING  = 2    // still circling at psiMax (near-critical b)
+    };
+
+    float M      = 0.0f;
+    float bMax   = 0.0f;
+    float psiMax = 0.0f;
+    float dPsi   = 0.0f;
+    float uMax   = 0.0f;    // 1 / 2M (horizon)
+    int   nb = 0, npsi = 0, nu = 0;
+
+    std::vector<float> u, du;           // [row * npsi + j]
+    std::vector<float> psiEnd;          // [row]
+    std::vector<std::uint8_t> endType;  // [row]
+    std::vector<float> psiIn;           // [row * nu + k], -1 if unreachable
+
+    bool matches(float mass, float maxB) const {
+        return !u.empty() && M == mass && bMax >= maxB;
+    }
+
+    float rowB(int i) const { return bMax * (i + 0.5f) / nb; }
+
+    // ----------------------
+    // Build: one RK4 integration per impact parameter
+    // ----------------------
+    void build(float mass, float maxB, int bSamples = 1024, int psiSamples = 2048,
+               int uSamples = 512, float maxPsi = 4.0f * LUT_PI) {
+        M = mass;
+        bMax = maxB;
+        nb = bSamples;
+        npsi = psiSamples;
+        nu = uSamples;
+        psiMax = maxPsi;
+        dPsi = psiMax / (npsi - 1);
+        uMax = 1.0f / (2.0f * M);
+
+        u.assign(static_cast<size_t>(nb) * npsi, 0.0f);
+        du.assign(static_cast<size_t>(nb) * npsi, 0.0f);
+        psiEnd.assign(nb, psiMax);
+        endType.assign(nb, END_WINDING);
+        psiIn.assign(static_cast<size_t>(nb) * nu, -1.0f);
+
+        const int sub = 8;
+        const double h = static_cast<double>(dPsi) / sub;
+        const double m3 = 3.0 * M;
+
+        for (int i = 0; i < nb; ++i) {
+            float* U  = &u[static_cast<size_t>(i) * npsi];
+            float* DU = &du[static_cast<size_t>(i) * npsi];
+
+            // Double precision: near-critical orbits are very sensitive
+            double y = 0.0, v = 1.0 / rowB(i);
+            U[0] = 0.0f;
+            DU[0] = static_cast<float>(v);
+
+            for (int j = 1; j < npsi; ++j) {
+                bool ended = false;
+                for (int s = 0; s < sub && !ended; ++s) {
+                    double k1y = v,               k1v = m3 * y * y - y;
+                    double y2 = y + 0.5 * h * k1y, v2 = v + 0.5 * h * k1v;
+                    double k2y = v2,              k2v = m3 * y2 * y2 - y2;
+                    double y3 = y + 0.5 * h * k2y, v3 = v + 0.5 * h * k2v;
+                    double k3y = v3,              k3v = m3 * y3 * y3 - y3;
+                    double y4 = y + h * k3y,       v4 = v + h * k3v;
+                    double k4y = v4,              k4v = m3 * y4 * y4 - y4;
+
+                    double ny = y + h / 6.0 * (k1y + 2.0 * k2y + 2.0 * k3y + k4y);
+                    double nv = v + h / 6.0 * (k1v + 2.0 * k2v + 2.0 * k3v + k4v);
+
+                    double psi0 = (j - 1) * static_cast<double>(dPsi) + s * h;
+                    if (ny >= uMax || ny <= 0.0) {
+                        // Linear in the last substep to the exact boundary
+                        double target = ny >= uMax ? uMax : 0.0;
+                        double frac = (target - y) / (ny - y);
+                        psiEnd[i]  = static_cast<float>(psi0 + frac * h);
+                        endType[i] = ny >= uMax ? END_CAPTURED : END_ESCAPED;
+                        ny = target;
+                        ended = true;
+                    }
+                    y = ny;
+                    v = nv;
+                }
+
+                U[j]  = static_cast<float>(y);
+                DU[j] = static_cast<float>(v);
+                if (ended) {
+                    // Freeze the tail at the end state
+                    for (int t = j + 1; t < npsi; ++t) { U[t] = U[j]; DU[t] = DU[j]; }
+                    break;
+                }
+            }
+
+            buildPsiInRow(i);
+        }
+    }
+
+    // Ingoing branch: u rises monotonically until periapsis (du <= 0) or
+    // capture; invert it on a uniform u grid.
+    void buildPsiInRow(int i) {
+        const float* U  = &u[static_cast<size_t>(i) * npsi];
+        const float* DU = &du[static_cast<size_t>(i) * npsi];
+        float* P = &psiIn[static_cast<size_t>(i) * nu];
+
+        int j = 1;
+        for (int k = 0; k < nu; ++k) {
+            float target = uMax * k / (nu - 1);
+            if (k == 0) { P[k] = 0.0f; continue; }
+
+            while (j < npsi && U[j] < target && DU[j - 1] > 0.0f && j * dPsi < psiEnd[i]) ++j;
+            if (j >= npsi || U[j] < target || DU[j - 1] <= 0.0f) break;   // past periapsis
+
+            float psiA = (j - 1) * dPsi;
+            float psiB = j * dPsi < psiEnd[i] ? j * dPsi : psiEnd[i];
+            float frac = (target - U[j - 1]) / (U[j] - U[j - 1]);
+            P[k] = psiA + frac * (psiB - psiA);
+        }
+    }
+
+    // ----------------------
+    // Lookups (linear in psi / u, linear in b unless the two rows
+    // disagree about how the orbit ends, then nearest row)
+    // ----------------------
+
+    // Returns false once the orbit has ended before psi; `end` says how
+    bool sampleRow(int i, float psi, float& outU, float& outDu, std::uint8_t& end) const {
+        if (psi >= psiEnd[i]) {
+            end = endType[i];
+            return false;
+        }
+        float fj = psi / dPsi;
+        int j = static_cast<int>(fj);
+        if (j >= npsi - 1) { end = END_WINDING; return false; }
+
+        const float* U  = &u[static_cast<size_t>(i) * npsi];
+        const float* DU = &du[static_cast<size_t>(i) * npsi];
+
+        // Last cell ends at psiEnd, not at the next grid point
+        float psiB = (j + 1) * dPsi;
+        float t = psiB > psiEnd[i] ? (psi - j * dPsi) / (psiEnd[i] - j * dPsi) : fj - j;
+
+        outU  = U[j]  + (U[j + 1]  - U[j])  * t;
+        outDu = DU[j] + (DU[j + 1] - DU[j]) * t;
+        return true;
+    }
+
+    bool sample(float b, float psi, float& outU, float& outDu, std::uint8_t& end) const {
+        float fb = b / bMax * nb - 0.5f;
+        fb = clampf(fb, 0.0f, static_cast<float>(nb - 1));
+        int i0 = static_cast<int>(fb);
+        int i1 = i0 + 1 < nb ? i0 + 1 : i0;
+        float t = fb - i0;
+
+        float u0 = 0, d0 = 0, u1 = 0, d1 = 0;
+        std::uint8_t e0 = 0, e1 = 0;
+        bool ok0 = sampleRow(i0, psi, u0, d0, e0);
+        bool ok1 = sampleRow(i1, psi, u1, d1, e1);
+
+        if (ok0 && ok1) {
+            outU  = u0 + (u1 - u0) * t;
+            outDu = d0 + (d1 - d0) * t;
+            return true;
+        }
+        bool nearest1 = t > 0.5f;
+        if (nearest1 ? ok1 : ok0) {
+            outU  = nearest1 ? u1 : u0;
+            outDu = nearest1 ? d1 : d0;
+            return true;
+        }
+        end = nearest1 ? e1 : e0;
+        return false;
+    }
+
+    float psiInRow(int i, float uq) const {
+        const float* P = &psiIn[static_cast<size_t>(i) * nu];
+        float fk = uq / uMax * (nu - 1);
+        int k = static_cast<int>(fk);
+        if (k >= nu - 1) return -1.0f;
+        if (P[k] < 0.0f || P[k + 1] < 0.0f) return P[k];   // at periapsis
+        return P[k] + (P[k + 1] - P[k]) * (fk - k);
+    }
+
+    bool ingoingPsi(float b, float uq, float& psi) const {
+        float fb = clampf(b / bMax * nb - 0.5f, 0.0f, static_cast<float>(nb - 1));
+        int i0 = static_cast<int>(fb);
+        int i1 = i0 + 1 < nb ? i0 + 1 : i0;
+        float t = fb - i0;
+
+        float p0 = psiInRow(i0, uq);
+        float p1 = psiInRow(i1, uq);
+        if (p0 < 0.0f && p1 < 0.0f) return false;
+        if (p0 < 0.0f) { psi = p1; return true; }
+        if (p1 < 0.0f) { psi = p0; return true; }
+        psi = p0 + (p1 - p0) * t;
+        return true;
+    }
+};
+
+// ----------------------
+// Table sized for the current scene (rebuild when M or range changes)
+// ----------------------
+inline float lutMassFor(const RayMarchParams& p) { return 0.5f * p.bhRadius; }
+
+inline float lutMaxImpactFor(const RayMarchParams& p) {
+    // b = r sin(alpha) / sqrt(1 - 2M/r) <= r / sqrt(1 - 2M/r)  (see makeLutRay)
+    float rc = length(p.camPos);
+    float g = std::fmax(1.0f - 2.0f * lutMassFor(p) / rc, 0.05f);
+    return rc / std::sqrt(g) * 1.02f;
+}
+
+inline void ensureLut(SchwarzschildLut& lut, const RayMarchParams& p) {
+    float M = lutMassFor(p);
+    float bMax = lutMaxImpactFor(p);
+    if (!lut.matches(M, bMax)) lut.build(M, bMax);
+}
+
+// ----------------------
+// Orbit-plane frame for one camera ray
+// ----------------------
+// The camera is a static observer: a ray leaving at angle alpha from the
+// radial direction has b = r sin(alpha) / sqrt(1 - 2M/r) and
+// du/dphi = -sqrt(1 - 2M/r) cos(alpha) / (r sin(alpha)).
+struct LutRay {
+    Vec3  e1, e2;      // e1 = radial at camera, e2 = direction of motion in plane
+    float b = 0.0f;
+    float uCam = 0.0f;
+    float duCam = 0.0f;   // du/dphi at the camera
+    bool  inward = true;
+    bool  radial = false;
+};
+
+inline LutRay makeLutRay(const RayMarchParams& p, Vec3 dir) {
+    LutRay lr;
+    float rc = length(p.camPos);
+    lr.e1 = p.camPos * (1.0f / rc);
+    lr.uCam = 1.0f / rc;
+
+    float vr = dot(dir, lr.e1);
+    Vec3 tang = dir - lr.e1 * vr;
+    float tl = length(tang);
+    float lapse = std::sqrt(std::fmax(1.0f - 2.0f * lutMassFor(p) * lr.uCam, 1e-6f));
+
+    lr.inward = vr < 0.0f;
+    lr.radial = tl < 1e-6f;
+    lr.b = rc * tl / lapse;
+    lr.duCam = lr.radial ? 0.0f : -lapse * vr / (rc * tl);
+    lr.e2 = lr.radial ? Vec3(0.0f, 0.0f, 0.0f) : tang * (1.0f / tl);
+    return lr;
+}
+
+// Position / direction after sweeping `delta` radians with inverse
+// radius u and du/dphi
+inline void lutHitPoint(const LutRay& lr, float delta, float uu, float dudphi,
+                        Vec3& pos, Vec3& dir) {
+    float r = 1.0f / uu;
+    float c = std::cos(delta), s = std::sin(delta);
+    Vec3 radialV = lr.e1 * c + lr.e2 * s;
+    Vec3 tangV   = lr.e1 * (-s) + lr.e2 * c;
+
+    float drdphi = -dudphi / (uu * uu);
+    pos = radialV * r;
+    dir = normalize(radialV * drdphi + tangV * r);
+}
+
+// First angle > 0 where the orbit plane crosses the disk plane
+inline float lutFirstCrossing(const LutRay& lr, Vec3 diskNormal) {
+    float a = dot(diskNormal, lr.e1);
+    float c = dot(diskNormal, lr.e2);
+    float d0 = std::atan2(-a, c);   // a cos d + c sin d = 0
+    while (d0 <= 1e-5f) d0 += LUT_PI;
+    while (d0 > LUT_PI)  d0 -= LUT_PI;
+    return d0;
+}
+
+// ----------------------
+// One pixel, O(1): a few crossings, each one table lookup
+// ----------------------
+inline RayResult traceRayLut(const RayMarchParams& p, const RayFrame& f,
+                             const SchwarzschildLut& lut, float fragX, float fragY) {
+    RayResult res;
+    Vec3 dir = makeRayDirection(p, f, fragX, fragY);
+    LutRay lr = makeLutRay(p, dir);
+
+    if (lr.radial) {
+        res.hit = lr.inward ? RAY_HORIZON : RAY_MISS;
+        return res;
+    }
+
+    float psiC = 0.0f;
+    if (!lut.ingoingPsi(lr.b, lr.uCam, psiC)) {
+        return res;   // camera inside the photon sphere: not tabulated
+    }
+
+    float delta0 = lutFirstCrossing(lr, f.diskNormal);
+
+    for (int k = 0; ; ++k) {
+        float delta = delta0 + k * LUT_PI;
+        float psi = lr.inward ? psiC + delta : psiC - delta;
+        res.steps = k + 1;
+
+        if (psi <= 0.0f) return res;          // outgoing ray reached infinity
+
+        float uu = 0.0f, du = 0.0f;
+        std::uint8_t end = 0;
+        if (!lut.sample(lr.b, psi, uu, du, end)) {
+            if (end == SchwarzschildLut::END_CAPTURED) res.hit = RAY_HORIZON;
+            return res;
+        }
+
+        float r = 1.0f / uu;
+        if (r > p.diskInner && r < p.diskOuter) {
+            Vec3 hp, hd;
+            lutHitPoint(lr, delta, uu, lr.inward ? du : -du, hp, hd);
+
+            res.hit    = RAY_DISK;
+            res.diskR  = r;
+            res.diskXc = dot(hp, f.diskX);
+            res.diskZc = dot(hp, f.diskZ);
+            res.dir    = hd;
+            return res;
+        }
+    }
+}
+
+// ----------------------
+// Direct (table-free) Binet integration of one ray, for checking the
+// table: same crossings, but RK4 in phi from the camera outwards
+// ----------------------
+inline RayResult traceRaySchwarzschildDirect(const RayMarchParams& p, const RayFrame& f,
+                                             float fragX, float fragY, float dPhi = 1e-3f) {
+    RayResult res;
+    Vec3 dir = makeRayDirection(p, f, fragX, fragY);
+    LutRay lr = makeLutRay(p, dir);
+    if (lr.radial) {
+        res.hit = lr.inward ? RAY_HORIZON : RAY_MISS;
+        return res;
+    }
+
+    const double M = lutMassFor(p);
+    const double uH = 1.0 / (2.0 * M);
+    double y = lr.uCam;
+    double v = lr.duCam;
+
+    float delta0 = lutFirstCrossing(lr, f.diskNormal);
+    double phi = 0.0;
+    const double h = dPhi;
+
+    for (int k = 0; k < 8; ++k) {
+        double target = delta0 + k * LUT_PI;
+        while (phi < target) {
+            double hh = std::fmin(h, target - phi);
+            double k1y = v,                k1v = 3 * M * y * y - y;
+            double y2 = y + 0.5 * hh * k1y, v2 = v + 0.5 * hh * k1v;
+            double k2y = v2,               k2v = 3 * M * y2 * y2 - y2;
+            double y3 = y + 0.5 * hh * k2y, v3 = v + 0.5 * hh * k2v;
+            double k3y = v3,               k3v = 3 * M * y3 * y3 - y3;
+            double y4 = y + hh * k3y,       v4 = v + hh * k3v;
+            double k4y = v4,               k4v = 3 * M * y4 * y4 - y4;
+            y += hh / 6.0 * (k1y + 2 * k2y + 2 * k3y + k4y);
+            v += hh / 6.0 * (k1v + 2 * k2v + 2 * k3v + k4v);
+            phi += hh;
+
+            if (y >= uH) { res.hit = RAY_HORIZON; return res; }
+            if (y <= 0.0) return res;
+        }
+
+        float r = static_cast<float>(1.0 / y);
+        res.steps = k + 1;
+        if (r > p.diskInner && r < p.diskOuter) {
+            Vec3 hp, hd;
+            lutHitPoint(lr, static_cast<float>(target), static_cast<float>(y),
+                        static_cast<float>(v), hp, hd);
+            res.hit    = RAY_DISK;
+            res.diskR  = r;
+            res.diskXc = dot(hp, f.diskX);
+            res.diskZc = dot(hp, f.diskZ);
+            res.dir    = hd;
+            return res;
+        }
+    }
+    return res;
+}
+
+// ----------------------
+// Tiled render with the table (work stealing, one shade per pixel)
+// ----------------------
+template <class ResultFn>
+inline void traceRectLut(const RayMarchParams& p, const RayFrame& f, const SchwarzschildLut& lut,
+                         int rx0, int ry0, int rx1, int ry1, ResultFn onResult) {
+    const int hgt = static_cast<int>(p.resolutionY);
+    for (int y = ry0; y < ry1; ++y) {
+        for (int x = rx0; x < rx1; ++x) {
+            onResult(x, y, traceRayLut(p, f, lut, x + 0.5f, hgt - y - 0.5f));
+        }
+    }
+}
+
+inline double renderTiledLut(const RayMarchParams& p, const SchwarzschildLut& lut,
+                             std::vector<float>& rgb, int tileSize, int threads,
+                             std::vector<TileWorkerStats>& stats) {
+    RayFrame f = makeRayFrame(p);
+    const int w = static_cast<int>(p.resolutionX);
+
+    std::vector<RenderTile> tiles = makeTileGrid(w, static_cast<int>(p.resolutionY), tileSize);
+    return runTilesWorkStealing(tiles, threads,
+        [&](const RenderTile& t, int) {
+            traceRectLut(p, f, lut, t.x0, t.y0, t.x1, t.y1,
+                [&](int x, int y, const RayResult& res) {
+                    Vec3 c = shadeRay(p, f, res);
+                    float* px = &rgb[(static_cast<size_t>(y) * w + x) * 3];
+                    px[0] = c.x; px[1] = c.y; px[2] = c.z;
+                });
+        },
+        stats);
+}
@@ -0,0 +1,140 @@
+// ============================================
+// Shader variants: #define specialization + compiled-variant cache
+// ============================================
+//
+// bh_raymarch.frag reads its step cap, escape distance, step mode, disk
+// and bending model and optional passes from preprocessor symbols
+// (BH_MAX_STEPS, BH_DISK_MODEL, ...) with #ifndef defaults that match
+// the old hard-coded behaviour. The host prepends a #define block at
+// load time, so a variant that pins e.g. BH_BENDING_MODEL = 0 gets the
+// Kerr path and its uniform tests folded away by the GLSL compiler.
+//
+// Variants are compiled once and cached by their define set. Switching
+// tiers or models is a map lookup after the first use.
+//
+// A model left at -1 stays a runtime uniform (one program covers both).
+// Uniforms a variant compiles out are dropped by the GL linker; SFML
+// reports each one once, the first time it is set on that program.
+//
+// No SFML here: ShaderVariantCache<Shader> works with anything that has
+// loadFromMemory(source, Shader::Fragment).
+
+#pragma once
+
+#include "bh_raymarch_cpu.hpp"   // QualityTier, QUALITY_TIERS
+
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+
+// ----------------------
+// Define sets
+// ----------------------
+// Ordered map, so the cache key is independent of insertion order
+using ShaderDefines = std::map<std::string, std::string>;
+
+inline std::string shaderVariantKey(const ShaderDefines& defines) {
+    std::string key;
+    for (const auto& d : defines) {
+        key += d.first;
+        key += '=';
+        key += d.second;
+        key += ';';
+    }
+    return key;
+}
+
+// Raymarch shader defines for a tier; models < 0 stay runtime uniforms
+inline ShaderDefines raymarchDefines(QualityTier tier, int diskModel, int bendingModel) {
+    const QualityTierSettings& t = QUALITY_TIERS[tier];
+    ShaderDefines d;
+    d["BH_MAX_STEPS"]     = std::to_string(t.maxSteps);
+    d["BH_MAX_DIST"]      = std::to_string(t.maxDist) + ".0";
+    d["BH_STEP_MODE"]     = std::to_string(t.stepMode);
+    d["BH_EDGE_AA"]       = t.edgeAA ? "1" : "0";
+    d["BH_DISK_MODEL"]    = std::to_string(diskModel);
+    d["BH_BENDING_MODEL"] = std::to_string(bendingModel);
+    return d;
+}
+
+// Insert the #define block after a leading #version line (which must
+// stay first), then reset line numbers so compile errors still point
+// at the right line of the file.
+//
+// "#line N" numbers the line after it N from GLSL 3.30 (and ES 3.00)
+// on, but N + 1 before that, and a shader without #version is GLSL
+// 1.10 (bh_raymarch.frag has none).
+inline std::string injectDefines(const std::string& source, const ShaderDefines& defines) {
+    size_t bodyStart = 0;
+    int    bodyLine  = 1;
+    bool   lineIsNext = false;   // #line N names the next line (3.30+)
+    size_t first = source.find_first_not_of(" \t\r\n");
+    if (first != std::string::npos && source.compare(first, 8, "#version") == 0) {
+        size_t eol = source.find('\n', first);
+        bodyStart = eol == std::string::npos ? source.size() : eol + 1;
+        bodyLine  = 2;
+        for (size_t i = 0; i < first; ++i) bodyLine += source[i] == '\n' ? 1 : 0;
+
+        std::istringstream version(source.substr(first + 8, bodyStart - first - 8));
+        int number = 0;
+        std::string profile;
+        version >> number >> profile;
+        lineIsNext = profile == "es" ? number >= 300 : number >= 330;
+    }
+
+    std::string out = source.substr(0, bodyStart);
+    for (const auto& d : defines) {
+        out += "#define " + d.first + " " + d.second + "\n";
+    }
+    out += "#line " + std::to_string(lineIsNext ? bodyLine : bodyLine - 1) + "\n";
+    out += source.substr(bodyStart);
+    return out;
+}
+
+inline bool readTextFile(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    out = ss.str();
+    return true;
+}
+
+// ----------------------
+// Compiled-variant cache
+// ----------------------
+template <class Shader>
+class ShaderVariantCache {
+public:
+    bool loadSource(const std::string& path) {
+        variants.clear();
+        return readTextFile(path, source);
+    }
+
+    // Compiled program for this define set, or nullptr if it fails to
+    // compile (failures are cached too, so they are reported once)
+    Shader* get(const ShaderDefines& defines) {
+        std::string key = shaderVariantKey(defines);
+        auto it = variants.find(key);
+        if (it != variants.end()) return it->second.get();
+
+        std::unique_ptr<Shader> shader(new Shader());
+        ++compiles;
+        if (!shader->loadFromMemory(injectDefines(source, defines), Shader::Fragment)) {
+            shader.reset();
+        }
+        Shader* result = shader.get();
+        variants[key] = std::move(shader);
+        return result;
+    }
+
+    size_t size() const { return variants.size(); }
+
+    int compiles = 0;
+
+private:
+    std::string source;
+    std::map<std::string, std::unique_ptr<Shader>> variants;
+};
@@ -0,0 +1,164 @@
+// ============================================
+// Work-stealing tile scheduler
+// ============================================
+//
+// Ray cost is very uneven: rays skimming the hole run every step while
+// rays that escape exit early, so a static row split leaves threads idle.
+// Tiles are sorted by an estimated cost and dealt round-robin into one
+// deque per thread. Each thread pops its own deque from the front (most
+// expensive first); when it runs dry it steals from the back of another
+// thread's deque (the cheap tail), which evens out the finish times.
+//
+// Generic: the caller supplies the tile list, the cost estimate and the
+// per-tile work function.
+
+#pragma once
+
+#include "frame_profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct RenderTile {
+    int   x0 = 0, y0 = 0;   // inclusive
+    int   x1 = 0, y1 = 0;   // exclusive
+    float cost = 1.0f;      // relative estimate, only the order matters
+};
+
+struct TileWorkerStats {
+    double busySeconds = 0.0;   // time spent inside the tile function
+    int    tiles  = 0;
+    int    steals = 0;
+};
+
+// ----------------------
+// One deque per worker. Tiles are coarse (thousands of rays each), so a
+// mutex per deque is cheap next to the work and keeps this simple.
+// ----------------------
+class TileDeque {
+public:
+    void push(const RenderTile& t) {
+        std::lock_guard<std::mutex> lock(m);
+        q.push_back(t);
+    }
+
+    bool popFront(RenderTile& out) {
+        std::lock_guard<std::mutex> lock(m);
+        if (q.empty()) return false;
+        out = q.front();
+        q.pop_front();
+        return true;
+    }
+
+    bool stealBack(RenderTile& out) {
+        std::lock_guard<std::mutex> lock(m);
+        if (q.empty()) return false;
+        out = q.back();
+        q.pop_back();
+        return true;
+    }
+
+private:
+    std::mutex m;
+    std::deque<RenderTile> q;
+};
+
+// ----------------------
+// Split a w x h image into tiles of tileSize x tileSize
+// ----------------------
+inline std::vector<RenderTile> makeTileGrid(int w, int h, int tileSize) {
+    std::vector<RenderTile> tiles;
+    for (int y = 0; y < h; y += tileSize) {
+        for (int x = 0; x < w; x += tileSize) {
+            RenderTile t;
+            t.x0 = x;
+            t.y0 = y;
+            t.x1 = std::min(x + tileSize, w);
+            t.y1 = std::min(y + tileSize, h);
+            tiles.push_back(t);
+        }
+    }
+    return tiles;
+}
+
+// ----------------------
+// Run fn(tile, threadIndex) over every tile on `threads` workers.
+// Returns wall time in seconds; stats gets one entry per worker.
+//
+// Exception-safe: if fn throws, the other workers stop taking tiles and
+// the first exception is rethrown here once every thread has joined. A
+// worker thread that can't be started is skipped; the ones running
+// (the caller included) steal its tiles.
+// ----------------------
+template <class TileFn>
+inline double runTilesWorkStealing(std::vector<RenderTile> tiles, int threads,
+                                   TileFn fn, std::vector<TileWorkerStats>& stats) {
+    using Clock = std::chrono::steady_clock;
+
+    if (threads < 1) threads = 1;
+    stats.assign(threads, TileWorkerStats());
+
+    std::stable_sort(tiles.begin(), tiles.end(),
+                     [](const RenderTile& a, const RenderTile& b) { return a.cost > b.cost; });
+
+    std::vector<TileDeque> queues(threads);
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        queues[i % threads].push(tiles[i]);
+    }
+
+    std::atomic<bool>  failed{false};
+    std::exception_ptr error;
+    std::mutex         errorLock;
+
+    auto worker = [&](int id) {
+        TileWorkerStats& st = stats[id];
+        RenderTile t;
+
+        try {
+            while (!failed.load(std::memory_order_relaxed)) {
+                bool got = queues[id].popFront(t);
+
+                // Own deque empty: steal from the others. No tiles are added
+                // after start, so finding every deque empty means we're done.
+                for (int k = 1; !got && k < threads; ++k) {
+                    got = queues[(id + k) % threads].stealBack(t);
+                    if (got) ++st.steals;
+                }
+                if (!got) break;
+
+                auto t0 = Clock::now();
+                PROFILE_SCOPE("tile");
+                fn(t, id);
+                st.busySeconds += std::chrono::duration<double>(Clock::now() - t0).count();
+                ++st.tiles;
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(errorLock);
+            if (!error) error = std::current_exception();
+            failed.store(true, std::memory_order_relaxed);
+        }
+    };
+
+    auto start = Clock::now();
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (int i = 1; i < threads; ++i) {
+        try {
+            pool.emplace_back(worker, i);
+        } catch (...) {
+            break;   // out of threads (or memory): run with the ones we have
+        }
+    }
+    worker(0);
+    for (std::thread& th : pool) th.join();
+
+    if (error) std::rethrow_exception(error);
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
@@ -0,0 +1,141 @@
+// ============================================
+// Out-of-core tiled renderer for poster-size stills
+// ============================================
+//
+// A 16K frame as floats is ~1.6 GB (8-bit RGB is still ~400 MB), so
+// poster renders never hold the image. The frame is cut into square
+// tiles and run through the work-stealing scheduler. Each worker
+// renders one tile into its own tileSize^2 buffer and writes the rows
+// straight to their offsets in a pre-sized binary PPM.
+//
+// Memory is threads * tileSize^2 * (12 + 3) bytes plus the tile list,
+// whatever the output resolution. The file on disk is an ordinary
+// scanline-ordered P6 that any viewer reads.
+
+#pragma once
+
+#include "bh_raymarch_cpu.hpp"
+#include "tile_scheduler.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+// 64-bit seek: 32K stills are past 2 GB
+inline int seekFile64(FILE* f, std::int64_t offset) {
+#if defined(_WIN32)
+    return _fseeki64(f, offset, SEEK_SET);
+#else
+    return fseeko(f, static_cast<off_t>(offset), SEEK_SET);
+#endif
+}
+
+struct StillStats {
+    double seconds     = 0.0;
+    int    tiles       = 0;
+    size_t bufferBytes = 0;   // all per-worker tile buffers together
+};
+
+// ----------------------
+// Pre-sized binary PPM that takes tiles in any order
+// ----------------------
+struct StillFile {
+    FILE* file = nullptr;
+    int   width = 0, height = 0;
+    std::int64_t header = 0;
+
+    // Header, then size the file by writing its last byte
+    bool open(const char* path, int w, int h) {
+        file = std::fopen(path, "wb");
+        if (!file) return false;
+        width  = w;
+        height = h;
+        header = std::fprintf(file, "P6\n%d %d\n255\n", w, h);
+        std::int64_t size = header + static_cast<std::int64_t>(w) * 3 * h;
+        return header > 0 && seekFile64(file, size - 1) == 0 && std::fputc(0, file) != EOF;
+    }
+
+    // rgb8 holds the tile's rows back to back
+    bool writeTile(const RenderTile& t, const unsigned char* rgb8) {
+        const int tw = t.x1 - t.x0;
+        for (int y = t.y0; y < t.y1; ++y) {
+            std::int64_t at = header + (static_cast<std::int64_t>(y) * width + t.x0) * 3;
+            if (seekFile64(file, at) != 0 ||
+                std::fwrite(rgb8 + static_cast<size_t>(y - t.y0) * tw * 3, 1, tw * 3, file) !=
+                    static_cast<size_t>(tw) * 3) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool close() {
+        bool ok = file && std::fclose(file) == 0;
+        file = nullptr;
+        return ok;
+    }
+};
+
+// Trace + shade one tile into rgb (float scratch) and rgb8 (its rows
+// back to back, quantized like writePPM). packetWidth 8 or 16; lanes
+// don't interact, so the pixels are the same either way
+inline void renderTileRGB8(const RayMarchParams& p, const RayFrame& f, const RenderTile& t,
+                           float* rgb, unsigned char* rgb8, int packetWidth = 8) {
+    const int tw = t.x1 - t.x0;
+    const int th = t.y1 - t.y0;
+
+    auto store = [&](int x, int y, const RayResult& res) {
+        Vec3 c = shadeRay(p, f, res);
+        float* px = &rgb[(static_cast<size_t>(y - t.y0) * tw + (x - t.x0)) * 3];
+        px[0] = c.x; px[1] = c.y; px[2] = c.z;
+    };
+    if (packetWidth == 16) traceRectPacket<16>(p, f, t.x0, t.y0, t.x1, t.y1, store);
+    else                   traceRectPacket<8>(p, f, t.x0, t.y0, t.x1, t.y1, store);
+
+    for (size_t i = 0; i < static_cast<size_t>(tw) * th * 3; ++i) {
+        float v = clampf(rgb[i], 0.0f, 1.0f);
+        rgb8[i] = static_cast<unsigned char>(v * 255.0f + 0.5f);
+    }
+}
+
+// Render p (any resolution) to a binary PPM at path, tile by tile.
+// Pixel-identical to renderTiledPacket<8> + a whole-frame write.
+inline bool renderStillPPM(const RayMarchParams& p, const char* path,
+                           int tileSize, int threads,
+                           std::vector<TileWorkerStats>& workers, StillStats& out,
+                           int packetWidth = 8) {
+    const int w = static_cast<int>(p.resolutionX);
+    const int h = static_cast<int>(p.resolutionY);
+    if (threads < 1) threads = 1;
+
+    StillFile file;
+    bool ok = file.open(path, w, h);
+
+    RayFrame f = makeRayFrame(p);
+    std::vector<RenderTile> tiles = makeTileGrid(w, h, tileSize);
+    estimateRayMarchTileCosts(p, f, tiles);
+
+    const size_t tilePixels = static_cast<size_t>(tileSize) * tileSize;
+    std::vector<std::vector<float>> rgb(threads, std::vector<float>(tilePixels * 3));
+    std::vector<std::vector<unsigned char>> bytes(threads, std::vector<unsigned char>(tilePixels * 3));
+    std::mutex fileMutex;
+
+    out = StillStats();
+    out.tiles       = static_cast<int>(tiles.size());
+    out.bufferBytes = threads * tilePixels * 3 * (sizeof(float) + 1);
+
+    if (ok) {
+        out.seconds = runTilesWorkStealing(tiles, threads,
+            [&](const RenderTile& t, int id) {
+                renderTileRGB8(p, f, t, rgb[id].data(), bytes[id].data(), packetWidth);
+
+                std::lock_guard<std::mutex> lock(fileMutex);
+                if (!file.writeTile(t, bytes[id].data())) ok = false;
+            },
+            workers);
+    }
+
+    if (!file.close()) ok = false;
+    return ok;
+}